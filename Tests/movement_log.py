@@ -0,0 +1,111 @@
+"""Dumps and diffs the binary movement logs written by spt_tas_log_start.
+
+python movement_log.py dump <file.mvlog>
+python movement_log.py diff <a.mvlog> <b.mvlog> [--eps EPS] [--all]
+
+diff walks both logs in order and prints the first record where they differ (or all of them with --all).
+Records are matched up by their position in the log, so both runs should start logging at the same point.
+"""
+
+import argparse
+import struct
+import sys
+
+LOG_ID = b'sptmvlg\0'
+LOG_VERSION = 1
+HEADER = struct.Struct('<8sII')
+RECORD = struct.Struct('<IiIi3f3f3f3f')
+FLAG_POST = 1
+
+FIELDS = ['origin', 'velocity', 'view_angles', 'move']
+
+
+class Record:
+    def __init__(self, values):
+        self.seq, self.tick, self.flags, self.buttons = values[:4]
+        self.origin = values[4:7]
+        self.velocity = values[7:10]
+        self.view_angles = values[10:13]
+        self.move = values[13:16]
+
+    def phase(self):
+        return 'POST' if self.flags & FLAG_POST else 'PRE '
+
+    def __str__(self):
+        def vec(v):
+            return ' '.join('%.8f' % x for x in v)
+        return '[%6d] tick %6d %s buttons: %08x; origin: %s; velocity: %s; angles: %s; move: %s' % (
+            self.seq, self.tick, self.phase(), self.buttons & 0xffffffff, vec(self.origin), vec(self.velocity),
+            vec(self.view_angles), vec(self.move))
+
+
+def read_log(path):
+    with open(path, 'rb') as f:
+        data = f.read()
+    if len(data) < HEADER.size:
+        sys.exit('%s: not a movement log' % path)
+    log_id, version, record_size = HEADER.unpack_from(data)
+    if log_id != LOG_ID:
+        sys.exit('%s: not a movement log' % path)
+    if version != LOG_VERSION or record_size != RECORD.size:
+        sys.exit('%s: unsupported version %d (record size %d)' % (path, version, record_size))
+    body = memoryview(data)[HEADER.size:]
+    n = len(body) // RECORD.size
+    if len(body) % RECORD.size:
+        print('%s: ignoring a partial record at the end' % path, file=sys.stderr)
+    records = [Record(v) for v in RECORD.iter_unpack(body[:n * RECORD.size])]
+    gaps = sum(1 for a, b in zip(records, records[1:]) if b.seq != a.seq + 1)
+    if gaps:
+        print('%s: records were dropped in %d places' % (path, gaps), file=sys.stderr)
+    return records
+
+
+def differs(a, b, eps):
+    if a.flags != b.flags or a.buttons != b.buttons:
+        return True
+    for field in FIELDS:
+        if any(abs(x - y) > eps for x, y in zip(getattr(a, field), getattr(b, field))):
+            return True
+    return False
+
+
+def dump(args):
+    for record in read_log(args.file):
+        print(record)
+
+
+def diff(args):
+    a = read_log(args.a)
+    b = read_log(args.b)
+    n_diffs = 0
+    for ra, rb in zip(a, b):
+        if differs(ra, rb, args.eps):
+            n_diffs += 1
+            print('a: %s\nb: %s\n' % (ra, rb))
+            if not args.all:
+                break
+    if len(a) != len(b):
+        print('logs have different lengths: %d and %d records' % (len(a), len(b)))
+    if n_diffs == 0 and len(a) == len(b):
+        print('logs match (%d records)' % len(a))
+    return 1 if n_diffs or len(a) != len(b) else 0
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    sub = parser.add_subparsers(dest='cmd', required=True)
+    p = sub.add_parser('dump')
+    p.add_argument('file')
+    p.set_defaults(func=dump)
+    p = sub.add_parser('diff')
+    p.add_argument('a')
+    p.add_argument('b')
+    p.add_argument('--eps', type=float, default=0.0, help='largest difference between floats that still counts as equal')
+    p.add_argument('--all', action='store_true', help='print every differing record instead of only the first one')
+    p.set_defaults(func=diff)
+    args = parser.parse_args()
+    sys.exit(args.func(args))
+
+
+if __name__ == '__main__':
+    main()
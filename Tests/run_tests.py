@@ -1,11 +1,18 @@
+import argparse
+import math
 import os
+import queue
 import re
 import shutil
 import time
 import subprocess
+import threading
 
 TEST_GAMEBUILDS = []
-TEST_FILE = 'testoutput.log'
+TEST_LINE = re.compile(r'^\[TEST\] (.*?) : (.*)$')
+# games are started one at a time, each one releases hl2_singleton_mutex before it opens its log file
+LAUNCH_LOCK = threading.Lock()
+LAUNCH_TIMEOUT = 120
 
 def parse_args(filepath):
     args = {
@@ -42,8 +49,6 @@ class GameBuild:
         self.build = build
         self.path = None
         self.game_path = None
-        self.test_output = None
-        self.output_filename = None
         self.executable = None
         self.spt_path = None
         self.spt_name = None
@@ -52,11 +57,13 @@ class GameBuild:
     def __str__(self):
         return "%s - %s - %s - %s" % (self.game, self.build, self.path, self.test_path)
 
-    def start_game(self):
-        """Start the game."""
+    def start_game(self, list_file, output_file):
+        """Start the game, validating the tests in list_file."""
         exec_path = os.path.join(self.path, self.executable)
-        cmd = "%s -game \"%s\" -w 640 -h 480 -window -novid -console +volume 0 +plugin_load %s +tas_test_automated_validate \"test %s\"" % (exec_path, self.game, self.spt_name, self.output_filename)
-        subprocess.run(cmd)
+        cmd = [exec_path, "-game", self.game, "-w", "640", "-h", "480", "-window", "-novid", "-nosound", "-console",
+               "+volume", "0", "+plugin_load", self.spt_name, "+y_spt_release_mutex",
+               "+tas_test_automated_validate_list", list_file, output_file]
+        return subprocess.Popen(cmd, cwd=self.path)
 
     def set_path(self, path, executable, spt_path, spt_name):
         """Set path and some other info."""
@@ -64,8 +71,6 @@ class GameBuild:
         if os.path.isdir(game_dir): # Check if game is installed
             self.game_path = game_dir
             self.path = path
-            self.output_filename = self.game.replace(' ', '_') + "-" + TEST_FILE
-            self.test_output = os.path.join(self.path, self.output_filename)
             self.executable = executable
             self.spt_path = spt_path
             self.spt_out = os.path.join(game_dir, spt_name + ".dll")
@@ -76,22 +81,76 @@ class GameBuild:
         copy_all(self.test_path, self.game_path)
         shutil.copyfile(self.spt_path, self.spt_out)
 
-    def print_test_output(self):
-        """Print the test output"""
-        print("[TEST] Game: %s, build %s" % (self.game, self.build))
-        if not os.path.isfile(self.test_output):
-            print("[TEST] Output file %s does not exist. Game likely crashed." % self.test_output)
-        else:
-            with open(self.test_output) as fp:
-                for line in fp:
-                    print(line, end='')
+    def find_test_names(self):
+        """Test names relative to the game folder, for every script that has test data."""
+        names = []
+        test_dir = os.path.join(self.test_path, "test")
+        for root, _, files in os.walk(test_dir):
+            for file in sorted(files):
+                name, ext = os.path.splitext(file)
+                if ext != ".srctas":
+                    continue
+                if not any(os.path.isfile(os.path.join(root, name + data_ext)) for data_ext in (".td", ".tdb")):
+                    continue
+                rel = os.path.relpath(os.path.join(root, name), self.test_path)
+                names.append(rel.replace('/', '\\'))
+        return names
 
-    def run_test(self):
-        """Run test"""
-        self.copy_files()
-        if os.path.isfile(self.test_output):
-            os.remove(self.test_output)
-        self.start_game()
+    def run_job(self, job_id, tests, timeout):
+        """Runs some of the tests in one game, returns a (passed, details) pair per test."""
+        list_file = os.path.join(self.path, "spt-test-list-%d.txt" % job_id)
+        output_file = os.path.join(self.path, "spt-test-output-%d.log" % job_id)
+        with open(list_file, 'w') as fp:
+            fp.write('\n'.join(tests) + '\n')
+        if os.path.isfile(output_file):
+            os.remove(output_file)
+
+        with LAUNCH_LOCK:
+            game = self.start_game(list_file, output_file)
+            start = time.time()
+            while not os.path.isfile(output_file) and game.poll() is None and time.time() - start < LAUNCH_TIMEOUT:
+                time.sleep(0.5)
+        try:
+            game.wait(timeout)
+        except subprocess.TimeoutExpired:
+            game.kill()
+            game.wait()
+
+        passed = {}
+        details = {test: [] for test in tests}
+        # messages that aren't about any one test, e.g. when the list file couldn't be opened
+        job_errors = []
+        if os.path.isfile(output_file):
+            with open(output_file) as fp:
+                for line in fp:
+                    match = TEST_LINE.match(line.rstrip())
+                    if not match:
+                        continue
+                    if not match.group(1):
+                        job_errors.append(match.group(2))
+                        continue
+                    if match.group(1) not in details:
+                        continue
+                    test, msg = match.groups()
+                    if msg == "Test ran successfully":
+                        passed[test] = True
+                    elif msg.startswith("Test was unsuccessful"):
+                        passed[test] = False
+                        if msg != "Test was unsuccessful":
+                            details[test].append(msg)
+                    else:
+                        details[test].append(msg)
+            os.remove(output_file)
+        results = {}
+        for test in tests:
+            if test in passed:
+                results[test] = (passed[test], details[test])
+            elif job_errors:
+                results[test] = (False, details[test] + job_errors)
+            else:
+                results[test] = (False, details[test] + ["No result, game likely crashed or timed out."])
+        os.remove(list_file)
+        return results
 
 def get_game(name):
     """Get gamebuild given the folder name or arg name"""
@@ -135,22 +194,71 @@ def get_2013_spt():
     releases = os.path.abspath(os.path.join(os.path.dirname(__file__), '..', 'Release 2013\\spt-2013.dll'))
     return releases
 
-def run_tests():
-    """Run all tests for games that are installed and configured."""
+def run_tests(num_jobs, chunk_size, timeout):
+    """Shards the tests of every installed build into jobs and runs them in parallel games."""
+    jobs = queue.Queue()
+    job_count = 0
     for build in TEST_GAMEBUILDS:
-        if build.path:
-            print("Running test for game %s, build %s" % (build.game, build.build))
-            build.run_test()
-        else:
+        if not build.path:
             print("Skipping test for game %s, build %s" % (build.game, build.build))
-   
-def collect_test_results():
-    """Collects test results from all the output files and prints them."""
+            continue
+        build.copy_files()
+        tests = build.find_test_names()
+        print("Found %d tests for game %s, build %s" % (len(tests), build.game, build.build))
+        size = chunk_size or max(1, math.ceil(len(tests) / num_jobs))
+        for i in range(0, len(tests), size):
+            jobs.put((job_count, build, tests[i:i + size]))
+            job_count += 1
+
+    results = []
+    results_lock = threading.Lock()
+    finished_jobs = [0]
+
+    def worker():
+        while True:
+            try:
+                job_id, build, tests = jobs.get_nowait()
+            except queue.Empty:
+                return
+            job_results = build.run_job(job_id, tests, timeout)
+            with results_lock:
+                for test in tests:
+                    results.append((build, test) + job_results[test])
+                finished_jobs[0] += 1
+                print("Finished %d / %d games" % (finished_jobs[0], job_count))
+
+    threads = [threading.Thread(target=worker) for _ in range(min(num_jobs, job_count))]
+    for thread in threads:
+        thread.start()
+    for thread in threads:
+        thread.join()
+    return results
+
+def print_test_results(results):
+    """Prints a summary per build and the details of every failed test, returns whether everything passed."""
+    all_passed = True
     for build in TEST_GAMEBUILDS:
-        if build.path:
-            build.print_test_output()
+        build_results = sorted((r for r in results if r[0] is build), key=lambda r: r[1])
+        if not build_results:
+            continue
+        passed = sum(1 for r in build_results if r[2])
+        print("[TEST] Game: %s, build %s: %d / %d tests ran successfully" % (build.game, build.build, passed, len(build_results)))
+        for _, test, ok, details in build_results:
+            if ok:
+                continue
+            all_passed = False
+            print("[TEST] %s : Test was unsuccessful" % test)
+            for line in details:
+                print("    %s" % line)
+    return all_passed
+
+parser = argparse.ArgumentParser(description="Runs the TAS tests of every configured game build.")
+parser.add_argument("-j", "--jobs", type=int, default=os.cpu_count(), help="number of games to run at the same time")
+parser.add_argument("--chunk-size", type=int, default=0, help="tests per game, by default the tests of a build are split evenly between the jobs")
+parser.add_argument("--timeout", type=float, default=3600, help="seconds before a game is killed")
+args = parser.parse_args()
 
 find_tests()
 find_paths()
-run_tests()
-collect_test_results()
+results = run_tests(max(1, args.jobs), args.chunk_size, args.timeout)
+exit(0 if print_test_results(results) else 1)
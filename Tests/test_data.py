@@ -0,0 +1,134 @@
+"""Dumps and converts test data between the text (.td) and binary (.tdb) formats.
+
+python test_data.py dump <file>
+python test_data.py convert <in file> <out file>
+python test_data.py tolerance <file.tdb> <tracker no> <tolerance>
+
+Tracker numbers are 0 for velocity, 1 for position and 2 for angles. A tolerance of 0 means the tracker's own
+(1e-9), text files don't have tolerances so they always use that.
+"""
+
+import argparse
+import struct
+import sys
+
+DATA_ID = b'spttdb\0\0'
+DATA_VERSION = 1
+HEADER = struct.Struct('<8sII')
+COLUMN_HEADER = struct.Struct('<ifI')
+TRACKER_NAMES = {0: 'velocity', 1: 'position', 2: 'angle'}
+
+
+class Column:
+    def __init__(self, tracker_no, tolerance):
+        self.tracker_no = tracker_no
+        self.tolerance = tolerance
+        self.ticks = []
+        self.values = []
+
+
+def read_text(path):
+    columns = {}
+    with open(path) as f:
+        for line in f:
+            line = line.strip()
+            if not line:
+                continue
+            tick, tracker_no, value = line.split(' ', 2)
+            column = columns.setdefault(int(tracker_no), Column(int(tracker_no), 0.0))
+            column.ticks.append(int(tick))
+            column.values.append(tuple(float(x) for x in value.split('|')))
+    return list(columns.values())
+
+
+def read_binary(path):
+    with open(path, 'rb') as f:
+        data = f.read()
+    data_id, version, num_columns = HEADER.unpack_from(data)
+    if data_id != DATA_ID:
+        sys.exit('%s: not a binary test data file' % path)
+    if version != DATA_VERSION:
+        sys.exit('%s: unsupported version %d' % (path, version))
+    offset = HEADER.size
+    columns = []
+    for _ in range(num_columns):
+        tracker_no, tolerance, count = COLUMN_HEADER.unpack_from(data, offset)
+        offset += COLUMN_HEADER.size
+        column = Column(tracker_no, tolerance)
+        column.ticks = list(struct.unpack_from('<%di' % count, data, offset))
+        offset += 4 * count
+        values = struct.unpack_from('<%df' % (3 * count), data, offset)
+        offset += 12 * count
+        column.values = [values[i:i + 3] for i in range(0, len(values), 3)]
+        columns.append(column)
+    return columns
+
+
+def read(path):
+    return read_binary(path) if path.endswith('.tdb') else read_text(path)
+
+
+def write(path, columns):
+    if path.endswith('.tdb'):
+        with open(path, 'wb') as f:
+            f.write(HEADER.pack(DATA_ID, DATA_VERSION, len(columns)))
+            for column in columns:
+                count = len(column.ticks)
+                f.write(COLUMN_HEADER.pack(column.tracker_no, column.tolerance, count))
+                f.write(struct.pack('<%di' % count, *column.ticks))
+                f.write(struct.pack('<%df' % (3 * count), *(x for v in column.values for x in v)))
+    else:
+        rows = sorted(((tick, column.tracker_no, value) for column in columns
+                       for tick, value in zip(column.ticks, column.values)), key=lambda row: row[0])
+        with open(path, 'w') as f:
+            for tick, tracker_no, value in rows:
+                f.write('%d %d %s\n' % (tick, tracker_no, '|'.join('%.9f' % x for x in value)))
+
+
+def dump(args):
+    for column in read(args.file):
+        name = TRACKER_NAMES.get(column.tracker_no, 'unknown')
+        print('tracker %d (%s), tolerance %g, %d ticks' % (column.tracker_no, name, column.tolerance,
+                                                          len(column.ticks)))
+        for tick, value in zip(column.ticks, column.values):
+            print('  %6d %s' % (tick, ' '.join('%.9f' % x for x in value)))
+
+
+def convert(args):
+    write(args.output, read(args.input))
+
+
+def tolerance(args):
+    if not args.file.endswith('.tdb'):
+        sys.exit('only binary test data has tolerances')
+    columns = read(args.file)
+    for column in columns:
+        if column.tracker_no == args.tracker_no:
+            column.tolerance = args.tolerance
+            break
+    else:
+        sys.exit('%s has no column for tracker %d' % (args.file, args.tracker_no))
+    write(args.file, columns)
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    sub = parser.add_subparsers(dest='cmd', required=True)
+    p = sub.add_parser('dump')
+    p.add_argument('file')
+    p.set_defaults(func=dump)
+    p = sub.add_parser('convert')
+    p.add_argument('input')
+    p.add_argument('output')
+    p.set_defaults(func=convert)
+    p = sub.add_parser('tolerance')
+    p.add_argument('file')
+    p.add_argument('tracker_no', type=int)
+    p.add_argument('tolerance', type=float)
+    p.set_defaults(func=tolerance)
+    args = parser.parse_args()
+    args.func(args)
+
+
+if __name__ == '__main__':
+    main()
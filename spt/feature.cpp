@@ -1,5 +1,4 @@
 #include "stdafx.hpp"
-#include <future>
 #include "convar.hpp"
 #include "feature.hpp"
 #include "interfaces.hpp"
@@ -10,6 +9,9 @@
 #include "SPTLib\Windows\detoursutils.hpp"
 #include "SPTLib\Hooks.hpp"
 #include "cvars.hpp"
+#include "utils\pattern_cache.hpp"
+#include "utils\pattern_scanner.hpp"
+#include "thirdparty\md5.hpp"
 
 static std::unordered_map<std::string, ModuleHookData> moduleHookData;
 static std::unordered_map<uintptr_t, int> patternIndices;
@@ -127,6 +129,7 @@ void Feature::InitModules()
 	{
 		pair.second.InitModule(Convert(pair.first + ".dll"));
 	}
+	utils::GetPatternCache().Save();
 }
 
 void Feature::Hook()
@@ -239,6 +242,213 @@ void ModuleHookData::UnhookModule(const std::wstring& moduleName)
 		MemUtils::HookVTable(vft_hook.vftable, vft_hook.index, *vft_hook.origPtr);
 }
 
+using PatternResult = utils::PatternCache::Found;
+
+static uint32_t AddPatternToScanner(utils::PatternScanner& scanner, const patterns::PatternWrapper& pattern)
+{
+	// SPTLib patterns use an 'x' in the mask for bytes that must match and '?' for wildcards
+	std::vector<uint8_t> mask(pattern.length());
+	for (size_t i = 0; i < mask.size(); i++)
+		mask[i] = pattern.mask()[i] == 'x';
+	return scanner.AddPattern({pattern.bytes(), pattern.length()}, mask);
+}
+
+static bool PatternMatchesAt(const patterns::PatternWrapper& pattern,
+                             void* moduleStart,
+                             size_t moduleSize,
+                             uint32_t offset)
+{
+	if ((uint64_t)offset + pattern.length() > moduleSize)
+		return false;
+	auto p = reinterpret_cast<const uint8_t*>(moduleStart) + offset;
+	for (size_t i = 0; i < pattern.length(); i++)
+		if (pattern.mask()[i] == 'x' && p[i] != pattern.bytes()[i])
+			return false;
+	return true;
+}
+
+/*
+* Every pattern of every hook in this module goes into one scanner so that the module is only swept once
+* instead of once per pattern. With onlyMissingHooks, only the hooks that don't have a result yet are scanned
+* for and the match all results are left alone.
+*/
+static void ScanModule(const ModuleHookData& mhd,
+                       void* moduleStart,
+                       size_t moduleSize,
+                       const std::wstring& moduleName,
+                       std::vector<PatternResult>& hookResults,
+                       std::vector<std::vector<PatternResult>>& matchAllResults,
+                       bool onlyMissingHooks = false)
+{
+	if (!onlyMissingHooks)
+	{
+		hookResults.assign(mhd.patternHooks.size(), PatternResult{-1, 0});
+		matchAllResults.clear();
+	}
+
+	utils::PatternScanner scanner;
+	std::unordered_map<const patterns::PatternWrapper*, uint32_t> scannerIdxs;
+	auto addPatterns = [&](const patterns::PatternWrapper* patternArr, size_t size)
+	{
+		for (size_t i = 0; i < size; i++)
+			if (!scannerIdxs.contains(&patternArr[i]))
+				scannerIdxs[&patternArr[i]] = AddPatternToScanner(scanner, patternArr[i]);
+	};
+	if (!onlyMissingHooks)
+	{
+		for (auto& mpattern : mhd.matchAllPatterns)
+			addPatterns(mpattern.patternArr, mpattern.size);
+	}
+	for (size_t i = 0; i < mhd.patternHooks.size(); i++)
+		if (hookResults[i].ptnIndex == -1)
+			addPatterns(mhd.patternHooks[i].patternArr, mhd.patternHooks[i].size);
+
+	if (scanner.GetPatternCount() == 0)
+		return;
+
+	auto matches = scanner.Scan({reinterpret_cast<const uint8_t*>(moduleStart), moduleSize});
+
+	// the matches are sorted by pattern, split them up
+	std::vector<std::span<const utils::PatternScanner::Match>> matchesByPattern(scanner.GetPatternCount());
+	for (size_t i = 0; i < matches.size();)
+	{
+		size_t end = i;
+		while (end < matches.size() && matches[end].patternIdx == matches[i].patternIdx)
+			end++;
+		matchesByPattern[matches[i].patternIdx] = std::span{matches}.subspan(i, end - i);
+		i = end;
+	}
+	auto getMatches = [&](const patterns::PatternWrapper& pattern)
+	{
+		uint32_t idx = scannerIdxs[&pattern];
+		return idx < matchesByPattern.size() ? matchesByPattern[idx] : std::span<const utils::PatternScanner::Match>{};
+	};
+
+	if (!onlyMissingHooks)
+	{
+		for (auto& modulePattern : mhd.matchAllPatterns)
+		{
+			auto& results = matchAllResults.emplace_back();
+			for (size_t i = 0; i < modulePattern.size; i++)
+				for (auto& match : getMatches(modulePattern.patternArr[i]))
+					results.push_back({(int)i, (uint32_t)match.offset});
+		}
+	}
+
+	for (size_t h = 0; h < mhd.patternHooks.size(); h++)
+	{
+		auto& modulePattern = mhd.patternHooks[h];
+		PatternResult& result = hookResults[h];
+		if (result.ptnIndex != -1)
+			continue;
+		// use the first pattern that matches exactly once
+		for (size_t i = 0; i < modulePattern.size && result.ptnIndex == -1; i++)
+		{
+			auto ptnMatches = getMatches(modulePattern.patternArr[i]);
+			if (ptnMatches.size() == 1)
+			{
+				result = {(int)i, (uint32_t)ptnMatches[0].offset};
+			}
+			else if (ptnMatches.size() > 1)
+			{
+				DevMsg("[%s] Skipping the %s pattern for %s, it has %u matches.\n",
+				       Convert(moduleName).c_str(),
+				       modulePattern.patternArr[i].name(),
+				       modulePattern.patternName,
+				       ptnMatches.size());
+			}
+		}
+	}
+}
+
+/*
+* Hashes every pattern that this module is scanned for. It goes into the cache key so that changing, adding or
+* removing a pattern in a new SPT build doesn't reuse results that were found with the old patterns.
+*/
+static std::string GetPatternsDigest(const ModuleHookData& mhd)
+{
+	MD5 md5;
+	auto addString = [&](const char* str) { md5.update(str, (MD5::size_type)strlen(str) + 1); };
+	auto addPatterns = [&](const char* patternName, const patterns::PatternWrapper* patternArr, size_t size)
+	{
+		addString(patternName);
+		for (size_t i = 0; i < size; i++)
+		{
+			addString(patternArr[i].name());
+			md5.update(patternArr[i].bytes(), (MD5::size_type)patternArr[i].length());
+			md5.update(patternArr[i].mask(), (MD5::size_type)patternArr[i].length());
+		}
+	};
+	// hooks and match alls are hashed separately so that moving a pattern between them changes the digest
+	for (auto& modulePattern : mhd.patternHooks)
+		addPatterns(modulePattern.patternName, modulePattern.patternArr, modulePattern.size);
+	addString("");
+	for (auto& modulePattern : mhd.matchAllPatterns)
+		addPatterns(modulePattern.patternName, modulePattern.patternArr, modulePattern.size);
+	return md5.finalize().hexdigest();
+}
+
+static utils::PatternCache::ModuleEntry MakeCacheEntry(const ModuleHookData& mhd,
+                                                       const std::wstring& moduleName,
+                                                       size_t moduleSize,
+                                                       const std::vector<PatternResult>& hookResults,
+                                                       const std::vector<std::vector<PatternResult>>& matchAllResults)
+{
+	utils::PatternCache::ModuleEntry entry{
+	    .moduleName = Convert(moduleName),
+	    .moduleSize = (uint32_t)moduleSize,
+	};
+	for (size_t i = 0; i < mhd.patternHooks.size(); i++)
+		entry.hooks[mhd.patternHooks[i].patternName] = hookResults[i];
+	for (size_t i = 0; i < mhd.matchAllPatterns.size(); i++)
+		entry.matchAlls[mhd.matchAllPatterns[i].patternName] = matchAllResults[i];
+	return entry;
+}
+
+// fills the results from the cache entry, returns false if the entry doesn't have everything or doesn't match
+static bool GetCachedResults(const ModuleHookData& mhd,
+                             const utils::PatternCache::ModuleEntry& entry,
+                             void* moduleStart,
+                             size_t moduleSize,
+                             std::vector<PatternResult>& hookResults,
+                             std::vector<std::vector<PatternResult>>& matchAllResults)
+{
+	if (entry.moduleSize != moduleSize)
+		return false;
+
+	for (auto& modulePattern : mhd.matchAllPatterns)
+	{
+		auto it = entry.matchAlls.find(modulePattern.patternName);
+		if (it == entry.matchAlls.end())
+			return false;
+		for (auto& found : it->second)
+		{
+			if (found.ptnIndex < 0 || (size_t)found.ptnIndex >= modulePattern.size
+			    || !PatternMatchesAt(modulePattern.patternArr[found.ptnIndex], moduleStart, moduleSize, found.offset))
+			{
+				return false;
+			}
+		}
+		matchAllResults.push_back(it->second);
+	}
+
+	for (auto& modulePattern : mhd.patternHooks)
+	{
+		auto it = entry.hooks.find(modulePattern.patternName);
+		if (it == entry.hooks.end())
+			return false;
+		const PatternResult& found = it->second;
+		if (found.ptnIndex >= (int)modulePattern.size
+		    || (found.ptnIndex >= 0
+		        && !PatternMatchesAt(modulePattern.patternArr[found.ptnIndex], moduleStart, moduleSize, found.offset)))
+		{
+			return false;
+		}
+		hookResults.push_back(found);
+	}
+	return true;
+}
+
 void ModuleHookData::InitModule(const std::wstring& moduleName)
 {
 	void* handle;
@@ -255,47 +465,77 @@ void ModuleHookData::InitModule(const std::wstring& moduleName)
 		return;
 	}
 
-	std::vector<std::future<patterns::PatternWrapper*>> hooks;
-	std::vector<std::future<std::vector<patterns::MatchedPattern>>> mhooks;
-	hooks.reserve(patternHooks.size());
+	// where each pattern hook & match all pattern was found, either from the cache or from a scan
+	std::vector<PatternResult> hookResults;
+	std::vector<std::vector<PatternResult>> matchAllResults;
 
-	for (auto& mpattern : matchAllPatterns)
+	auto& cache = utils::GetPatternCache();
+	// hashing the module isn't free, don't bother if there's nothing to look up
+	std::string digest;
+	if (!patternHooks.empty() || !matchAllPatterns.empty())
 	{
-		mhooks.emplace_back(MemUtils::find_all_sequences_async(moduleStart,
-		                                                       moduleSize,
-		                                                       mpattern.patternArr,
-		                                                       mpattern.patternArr + mpattern.size));
+		digest = utils::PatternCache::GetModuleDigest(handle);
+		if (!digest.empty())
+			digest += GetPatternsDigest(*this);
 	}
+	const utils::PatternCache::ModuleEntry* cached = digest.empty() ? nullptr : cache.Find(digest);
+
+	if (cached && GetCachedResults(*this, *cached, moduleStart, moduleSize, hookResults, matchAllResults))
+	{
+		DevMsg("[%s] Using cached pattern offsets.\n", Convert(moduleName).c_str());
 
-	for (auto& pattern : patternHooks)
+		// whatever wasn't found last time is always looked for again, the module might have changed in memory
+		auto isMissing = [](const PatternResult& r) { return r.ptnIndex == -1; };
+		size_t nMissing = std::ranges::count_if(hookResults, isMissing);
+		if (nMissing > 0)
+		{
+			ScanModule(*this, moduleStart, moduleSize, moduleName, hookResults, matchAllResults, true);
+			if ((size_t)std::ranges::count_if(hookResults, isMissing) != nMissing)
+				cache.Store(digest, MakeCacheEntry(*this, moduleName, moduleSize, hookResults, matchAllResults));
+		}
+	}
+	else
 	{
-		hooks.emplace_back(MemUtils::find_unique_sequence_async(*pattern.origPtr,
-		                                                        moduleStart,
-		                                                        moduleSize,
-		                                                        pattern.patternArr,
-		                                                        pattern.patternArr + pattern.size));
+		if (cached)
+		{
+			DevMsg("[%s] Pattern cache is out of date, scanning.\n", Convert(moduleName).c_str());
+			cache.Invalidate(digest);
+		}
+		hookResults.clear();
+		matchAllResults.clear();
+		ScanModule(*this, moduleStart, moduleSize, moduleName, hookResults, matchAllResults);
+
+		if (!digest.empty())
+			cache.Store(digest, MakeCacheEntry(*this, moduleName, moduleSize, hookResults, matchAllResults));
 	}
 
 	funcPairs.reserve(funcPairs.size() + patternHooks.size());
 	hookedFunctions.reserve(hookedFunctions.size() + patternHooks.size());
 
-	for (std::size_t i = 0; i < mhooks.size(); ++i)
+	for (size_t i = 0; i < matchAllPatterns.size(); i++)
 	{
-		auto modulePattern = matchAllPatterns[i];
-		*modulePattern.foundVec = std::move(mhooks[i].get());
+		auto& modulePattern = matchAllPatterns[i];
+		modulePattern.foundVec->clear();
+		for (auto& result : matchAllResults[i])
+		{
+			patterns::MatchedPattern& found = modulePattern.foundVec->emplace_back();
+			found.ptr = reinterpret_cast<uintptr_t>(moduleStart) + result.offset;
+			found.ptnIndex = result.ptnIndex;
+		}
 		DevMsg("[%s] Found %u instances of pattern %s\n",
 		       Convert(moduleName).c_str(),
 		       modulePattern.foundVec->size(),
 		       modulePattern.patternName);
 	}
 
-	for (std::size_t i = 0; i < hooks.size(); ++i)
+	for (size_t i = 0; i < patternHooks.size(); i++)
 	{
-		auto foundPattern = hooks[i].get();
-		auto modulePattern = patternHooks[i];
+		auto& modulePattern = patternHooks[i];
+		const PatternResult& result = hookResults[i];
 
-		if (*modulePattern.origPtr)
+		if (result.ptnIndex >= 0)
 		{
+			*modulePattern.origPtr = reinterpret_cast<char*>(moduleStart) + result.offset;
 			if (modulePattern.functionHook)
 			{
 				funcPairs.emplace_back(modulePattern.origPtr, modulePattern.functionHook);
@@ -306,12 +546,12 @@ void ModuleHookData::InitModule(const std::wstring& moduleName)
 			       Convert(moduleName).c_str(),
 			       modulePattern.patternName,
 			       *modulePattern.origPtr,
-			       foundPattern->name());
-			patternIndices[reinterpret_cast<uintptr_t>(modulePattern.origPtr)] =
-			    foundPattern - modulePattern.patternArr;
+			       modulePattern.patternArr[result.ptnIndex].name());
+			patternIndices[reinterpret_cast<uintptr_t>(modulePattern.origPtr)] = result.ptnIndex;
 		}
 		else
 		{
+			*modulePattern.origPtr = nullptr;
 			DevWarning("[%s] Could not find %s.\n", Convert(moduleName).c_str(), modulePattern.patternName);
 		}
 	}
@@ -5,10 +5,12 @@
 #include "..\cvars.hpp"
 #include "signals.hpp"
 #include "dbg.h"
+#include "..\utils\timer_wheel.hpp"
 #include <sstream>
 
 AfterframesFeature spt_afterframes;
-static std::vector<afterframes_entry_t> afterframesQueue;
+static utils::TimerWheel<std::string> afterframesQueue;
+static std::vector<utils::TimerWheel<std::string>::Due> dueCommands;
 static bool afterframesPaused = false;
 static int afterframesDelay = 0;
 
@@ -20,7 +22,7 @@ ConVar _y_spt_afterframes_reset_on_server_activate("_y_spt_afterframes_reset_on_
 
 void AfterframesFeature::AddAfterFramesEntry(afterframes_entry_t entry)
 {
-	afterframesQueue.push_back(entry);
+	afterframesQueue.Add(entry.framesLeft, std::move(entry.command));
 }
 
 void AfterframesFeature::DelayAfterframesQueue(int delay)
@@ -30,7 +32,7 @@ void AfterframesFeature::DelayAfterframesQueue(int delay)
 
 void AfterframesFeature::ResetAfterframesQueue()
 {
-	afterframesQueue.clear();
+	afterframesQueue.Clear();
 }
 
 void AfterframesFeature::PauseAfterframesQueue()
@@ -71,17 +73,10 @@ void AfterframesFeature::OnFrame()
 		return;
 	}
 
-	for (auto it = afterframesQueue.begin(); it != afterframesQueue.end();)
-	{
-		it->framesLeft--;
-		if (it->framesLeft <= 0)
-		{
-			EngineConCmd(it->command.c_str());
-			it = afterframesQueue.erase(it);
-		}
-		else
-			++it;
-	}
+	dueCommands.clear();
+	afterframesQueue.Advance(1, dueCommands);
+	for (auto& due : dueCommands)
+		EngineConCmd(due.value.c_str());
 
 	AfterFramesSignal();
 }
@@ -5,10 +5,12 @@
 #include "..\cvars.hpp"
 #include "signals.hpp"
 #include "dbg.h"
+#include "..\utils\timer_wheel.hpp"
 #include <sstream>
 
 AfterticksFeature spt_afterticks;
-static std::vector<afterticks_entry_t> afterticksQueue;
+static utils::TimerWheel<std::string> afterticksQueue;
+static std::vector<utils::TimerWheel<std::string>::Due> dueCommands;
 static bool afterticksPaused = false;
 static int afterticksDelay = 0;
 
@@ -34,12 +36,12 @@ namespace patterns
 
 void AfterticksFeature::AddAfterticksEntry(afterticks_entry_t entry)
 {
-	afterticksQueue.push_back(entry);
+	afterticksQueue.Add(entry.ticksLeft, std::move(entry.command));
 }
 
 void AfterticksFeature::ResetAfterticksQueue()
 {
-	afterticksQueue.clear();
+	afterticksQueue.Clear();
 }
 
 void AfterticksFeature::PauseAfterticksQueue()
@@ -90,21 +92,13 @@ void AfterticksFeature::OnFrame()
 		return;
 	}
 
-	for (auto it = afterticksQueue.begin(); it != afterticksQueue.end();)
+	dueCommands.clear();
+	afterticksQueue.Advance(diff, dueCommands);
+	for (auto& due : dueCommands)
 	{
-		it->ticksLeft -= diff;
-		if (it->ticksLeft <= 0)
-		{
-			EngineConCmd(it->command.c_str());
-			if (it->ticksLeft < 0)
-				DevWarning("afterticks: command \"%s\" fired late by %i tick(s)\n",
-					it->command.c_str(), 
-					it->ticksLeft * -1);
-
-			it = afterticksQueue.erase(it);
-		}
-		else
-			++it;
+		EngineConCmd(due.value.c_str());
+		if (due.lateBy > 0)
+			DevWarning("afterticks: command \"%s\" fired late by %i tick(s)\n", due.value.c_str(), (int)due.lateBy);
 	}
 }
 
@@ -61,6 +61,7 @@ void EntProps::UnloadFeature()
 {
 	for (auto* map : wrappers)
 		delete map;
+	fieldTable.Clear();
 }
 
 void EntProps::WalkDatamap(std::string key)
@@ -106,18 +107,19 @@ int EntProps::GetPlayerOffset(const std::string& key, bool server)
 		return playermap->GetClientOffset(key);
 }
 
-int EntProps::GetFieldOffset(const std::string& mapKey, const std::string& key, bool server)
+utils::FieldHandle EntProps::GetFieldHandle(utils::FieldKey key)
 {
-	auto map = GetDatamapWrapper(mapKey);
-	if (!map)
-	{
-		return utils::INVALID_DATAMAP_OFFSET;
-	}
+	return fieldTable.Find(key);
+}
 
-	if (server)
-		return map->GetServerOffset(key);
-	else
-		return map->GetClientOffset(key);
+int EntProps::GetFieldOffset(utils::FieldHandle handle, bool server)
+{
+	return handle.Valid() ? fieldTable.GetOffset(handle, server) : utils::INVALID_DATAMAP_OFFSET;
+}
+
+int EntProps::GetFieldOffset(std::string_view mapKey, std::string_view key, bool server)
+{
+	return GetFieldOffset(GetFieldHandle({mapKey, key}), server);
 }
 
 _InternalPlayerField EntProps::_GetPlayerField(const std::string& key, PropMode mode)
@@ -364,9 +366,23 @@ void EntProps::ProcessTablesLazy()
 
 	clientPatterns.clear();
 	serverPatterns.clear();
+	BuildFieldTable();
 	tablesProcessed = true;
 }
 
+void EntProps::BuildFieldTable()
+{
+	fieldTable.Clear();
+	for (auto& [name, wrapper] : nameToMapWrapper)
+	{
+		for (bool server : {true, false})
+			for (auto& [field, offset] : wrapper->GetOffsets(server))
+				fieldTable.AddField({name, field}, offset, server);
+	}
+	fieldTable.Build();
+	DevMsg("Built datamap field table with %u fields\n", fieldTable.GetFieldCount());
+}
+
 CON_COMMAND(y_spt_canjb, "Tests if player can jumpbug on a given height, with the current position and speed.")
 {
 	if (args.ArgC() < 2)
@@ -703,6 +719,34 @@ void** _InternalPlayerField::GetClientPtr() const
 		return nullptr;
 }
 
+static void** GetFieldPtr(void* ent, int offset)
+{
+	if (!ent || offset == utils::INVALID_DATAMAP_OFFSET)
+		return nullptr;
+	return reinterpret_cast<void**>(reinterpret_cast<uint32_t>(ent) + offset);
+}
+
+void** _InternalPlayerField::GetPtr(PropMode mode) const
+{
+	switch (mode)
+	{
+	case PropMode::Server:
+		return GetFieldPtr(utils::spt_serverEntList.GetPlayer(), serverOffset);
+	case PropMode::Client:
+		return GetFieldPtr(utils::spt_clientEntList.GetPlayer(), clientOffset);
+	case PropMode::PreferServer:
+		if (auto svplayer = utils::spt_serverEntList.GetPlayer())
+			return GetFieldPtr(svplayer, serverOffset);
+		return GetFieldPtr(utils::spt_clientEntList.GetPlayer(), clientOffset);
+	case PropMode::PreferClient:
+		if (auto clplayer = utils::spt_clientEntList.GetPlayer())
+			return GetFieldPtr(clplayer, clientOffset);
+		return GetFieldPtr(utils::spt_serverEntList.GetPlayer(), serverOffset);
+	default:
+		return nullptr;
+	}
+}
+
 bool _InternalPlayerField::ClientOffsetFound() const
 {
 	return clientOffset != utils::INVALID_DATAMAP_OFFSET;
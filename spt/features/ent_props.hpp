@@ -3,6 +3,7 @@
 #include "..\feature.hpp"
 #include "datamap_wrapper.hpp"
 #include "spt\utils\ent_list.hpp"
+#include "spt\utils\field_table.hpp"
 
 enum class PropMode
 {
@@ -20,6 +21,8 @@ struct _InternalPlayerField
 
 	void** GetServerPtr() const;
 	void** GetClientPtr() const;
+	// same as resolving the mode first, but only looks up each player once
+	void** GetPtr(PropMode mode) const;
 
 	bool ClientOffsetFound() const;
 	bool ServerOffsetFound() const;
@@ -61,7 +64,10 @@ public:
 	virtual void PreHook() override;
 	virtual void UnloadFeature() override;
 
-	int GetFieldOffset(const std::string& mapKey, const std::string& key, bool server);
+	// handles stay valid until the plugin is unloaded, the offsets are a plain array lookup
+	utils::FieldHandle GetFieldHandle(utils::FieldKey key);
+	int GetFieldOffset(utils::FieldHandle handle, bool server);
+	int GetFieldOffset(std::string_view mapKey, std::string_view key, bool server);
 	int GetPlayerOffset(const std::string& key, bool server);
 	template<typename T>
 	PlayerField<T> GetPlayerField(const std::string& key, PropMode mode = PropMode::PreferServer);
@@ -79,10 +85,12 @@ protected:
 	utils::DatamapWrapper* GetDatamapWrapper(const std::string& key);
 	utils::DatamapWrapper* GetPlayerDatamapWrapper();
 	void ProcessTablesLazy();
+	void BuildFieldTable();
 	std::vector<patterns::MatchedPattern> serverPatterns;
 	std::vector<patterns::MatchedPattern> clientPatterns;
 	std::vector<utils::DatamapWrapper*> wrappers;
 	std::unordered_map<std::string, utils::DatamapWrapper*> nameToMapWrapper;
+	utils::FieldTable fieldTable;
 
 	static void ImGuiEntInfoCvarCallback(ConVar& var);
 };
@@ -112,13 +120,7 @@ inline T PlayerField<T>::GetValue() const
 template<typename T>
 inline T* PlayerField<T>::GetPtr() const
 {
-	auto resolved = spt_entprops.ResolveMode(mode);
-	if (resolved == PropMode::Server)
-		return reinterpret_cast<T*>(field.GetServerPtr());
-	else if (resolved == PropMode::Client)
-		return reinterpret_cast<T*>(field.GetClientPtr());
-	else
-		return nullptr;
+	return reinterpret_cast<T*>(field.GetPtr(mode));
 }
 
 namespace utils
@@ -135,7 +137,7 @@ namespace utils
 	};
 
 	/*
-	* A small wrapper of spt_entprops.GetFieldOffset() that caches the offset.
+	* A small wrapper of spt_entprops.GetFieldOffset() that caches the offset. The key is hashed at compile time.
 	* AdditionalOffset can be used when the exact field you're looking for does not exist;
 	* you can instead reference a nearby field and add an offset from that in bytes.
 	*/
@@ -148,7 +150,8 @@ namespace utils
 		{
 			if (_off != INVALID_DATAMAP_OFFSET)
 				return _off + additionalOffset;
-			_off = spt_entprops.GetFieldOffset(map.val, field.val, server);
+			static constexpr FieldKey key{map.val, field.val};
+			_off = spt_entprops.GetFieldOffset(spt_entprops.GetFieldHandle(key), server);
 			return _off == INVALID_DATAMAP_OFFSET ? INVALID_DATAMAP_OFFSET : _off + additionalOffset;
 		}
 
@@ -164,6 +167,12 @@ namespace utils
 			return reinterpret_cast<T*>(reinterpret_cast<uint32_t>(ent) + _off + additionalOffset);
 		}
 
+		// for when Exists() was already checked, e.g. before looping over entities
+		T* GetPtrUnchecked(const void* ent)
+		{
+			return reinterpret_cast<T*>(reinterpret_cast<uint32_t>(ent) + _off + additionalOffset);
+		}
+
 		T& GetValueOrDefault(const void* ent, T def = T{})
 		{
 			T* ptr = GetPtr(ent);
@@ -169,7 +169,7 @@ CON_COMMAND_F_COMPLETION(spt_hud_group,
 				Msg("%s is not a HUD element.\n", element.c_str());
 				return false;
 			}
-			group.callbacks.push_back({element, argc == 5 ? args.Arg(4) : ""});
+			group.callbacks.push_back({element, argc == 5 ? args.Arg(4) : "", &spt_hud_feat.hudCallbacks[element]});
 		}
 		else if (param == "remove")
 		{
@@ -205,7 +205,7 @@ CON_COMMAND_F_COMPLETION(spt_hud_group,
 				Msg("%s is not a HUD element.\n", element.c_str());
 				return false;
 			}
-			group.callbacks[index] = {element, argc == 6 ? args.Arg(5) : ""};
+			group.callbacks[index] = {element, argc == 6 ? args.Arg(5) : "", &spt_hud_feat.hudCallbacks[element]};
 		}
 		else if (param == "show")
 		{
@@ -485,37 +485,100 @@ bool HUDFeature::AddHudDefaultGroup(HudCallback callback)
 
 void HUDFeature::vDrawTopHudElement(Color color, const wchar* format, va_list args)
 {
+	if (!curLayout)
+	{
+		AssertMsg(0, "spt: HUD elements can only be drawn from HUD callbacks");
+		return;
+	}
+
 	const wchar* text = FormatTempString(format, args);
 
-	if (!drawText)
+	if (curLayout->nLines == curLayout->lines.size())
+		curLayout->lines.emplace_back();
+	HudTextLayout::Line& line = curLayout->lines[curLayout->nLines++];
+	line.color = color;
+	if (line.text != text)
 	{
+		line.text = text;
+		line.measured = false;
+		curLayout->dirty = true;
+	}
+}
+
+void HUDFeature::BeginLayout(HudTextLayout& layout, vgui::HFont layoutFont)
+{
+	if (layout.font != layoutFont)
+	{
+		for (auto& line : layout.lines)
+			line.measured = false;
+		layout.font = layoutFont;
+		layout.dirty = true;
+	}
+	layout.nLines = 0;
+	curLayout = &layout;
+}
+
+void HUDFeature::DrawLayout(HudTextLayout& layout, Color background)
+{
+	curLayout = nullptr;
+
 #ifndef BMS
-		int tw, th;
-		interfaces::surface->GetTextSize(font, text, tw, th);
-		if (tw > textWidth)
-			textWidth = tw;
-		textHeight += th + 2;
+	if (background.a())
+	{
+		if (layout.dirty || layout.nLines != layout.nMeasuredLines)
+		{
+			layout.width = layout.height = 0;
+			for (size_t i = 0; i < layout.nLines; i++)
+			{
+				auto& line = layout.lines[i];
+				if (!line.measured)
+				{
+					interfaces::surface->GetTextSize(layout.font, line.text.c_str(), line.width, line.height);
+					line.measured = true;
+				}
+				layout.width = MAX(layout.width, line.width);
+				layout.height += line.height + 2;
+			}
+			layout.nMeasuredLines = layout.nLines;
+			layout.dirty = false;
+		}
+
+		interfaces::surface->DrawSetColor(background.r(), background.g(), background.b(), background.a());
+		interfaces::surface->DrawFilledRect(topX - 2, topY, topX + layout.width + 2, topY + layout.height);
+	}
 #endif
+
+	if (layout.nLines == 0)
 		return;
-	}
 
-	CALL(DrawSetTextFont, font);
-	CALL(DrawSetTextColor, color.r(), color.g(), color.b(), color.a());
+	CALL(DrawSetTextFont, layout.font);
 	CALL(DrawSetTexture, 0);
-	CALL(DrawSetTextPos, topX, 2 + topY + (topFontTall + 2) * topVertIndex);
+	Color lastColor = layout.lines[0].color;
+	CALL(DrawSetTextColor, lastColor.r(), lastColor.g(), lastColor.b(), lastColor.a());
 
-#ifdef BMS
-	if (isLatest)
+	for (size_t i = 0; i < layout.nLines; i++)
 	{
-		CALL(DrawPrintText_BMSLatest, text, wcslen(text), vgui::FONT_DRAW_DEFAULT, 0x0);
-	}
-	else
+		auto& line = layout.lines[i];
+		if (line.color != lastColor)
+		{
+			lastColor = line.color;
+			CALL(DrawSetTextColor, lastColor.r(), lastColor.g(), lastColor.b(), lastColor.a());
+		}
+		CALL(DrawSetTextPos, topX, 2 + topY + (topFontTall + 2) * topVertIndex);
+
+#ifdef BMS
+		if (isLatest)
+		{
+			CALL(DrawPrintText_BMSLatest, line.text.c_str(), line.text.size(), vgui::FONT_DRAW_DEFAULT, 0x0);
+		}
+		else
 #endif
-	{
-		CALL(DrawPrintText, text, wcslen(text), vgui::FONT_DRAW_DEFAULT);
-	}
+		{
+			CALL(DrawPrintText, line.text.c_str(), line.text.size(), vgui::FONT_DRAW_DEFAULT);
+		}
 
-	++topVertIndex;
+		++topVertIndex;
+	}
 }
 
 void HUDFeature::DrawTopHudElement(const wchar* format, ...)
@@ -663,7 +726,6 @@ void HUDFeature::DrawDefaultHUD()
 	try
 	{
 		// Reset top HUD stuff
-		drawText = true;
 		hudTextColor = Color(255, 255, 255, 255);
 		topVertIndex = 0;
 		topFontTall = CALL(GetFontTall, font);
@@ -682,15 +744,18 @@ void HUDFeature::DrawDefaultHUD()
 
 		topY = 0;
 
+		BeginLayout(defaultLayout, font);
 		for (auto& kv : hudCallbacks)
 		{
 			auto& callback = kv.second;
 			if (callback.shouldDraw())
 				callback.draw("");
 		}
+		DrawLayout(defaultLayout, Color(0, 0, 0, 0));
 	}
 	catch (const std::exception& e)
 	{
+		curLayout = nullptr;
 		Msg("Error drawing HUD: %s\n", e.what());
 	}
 }
@@ -721,9 +786,9 @@ void HUDFeature::DrawHUD(bool overlay)
 		if (!overlay)
 		{
 			// Draw user groups
-			for (const auto& kv : hudUserGroups)
+			for (auto& kv : hudUserGroups)
 			{
-				const auto& group = kv.second;
+				auto& group = kv.second;
 				if (!group.shouldDraw)
 					continue;
 
@@ -735,40 +800,17 @@ void HUDFeature::DrawHUD(bool overlay)
 				topFontTall = CALL(GetFontTall, group.font);
 				font = group.font;
 
-#ifndef BMS
-				// Getting the text width
-				if (group.background.a())
-				{
-					textWidth = 0;
-					textHeight = 0;
-					drawText = false;
-					for (const auto& callback : group.callbacks)
-					{
-						hudCallbacks[callback.name].draw(callback.args);
-					}
-
-					interfaces::surface->DrawSetColor(group.background.r(),
-					                                  group.background.g(),
-					                                  group.background.b(),
-					                                  group.background.a());
-					interfaces::surface->DrawFilledRect(topX - 2,
-					                                    topY,
-					                                    topX + textWidth + 2,
-					                                    topY + textHeight);
-				}
-#endif
-
-				// Draw HUD
-				drawText = true;
+				// the callbacks only add lines to the layout, the background & text are drawn after
+				BeginLayout(group.layout, group.font);
 				for (const auto& callback : group.callbacks)
-				{
-					hudCallbacks[callback.name].draw(callback.args);
-				}
+					callback.callback->draw(callback.args);
+				DrawLayout(group.layout, group.background);
 			}
 		}
 	}
 	catch (const std::exception& e)
 	{
+		curLayout = nullptr;
 		Msg("Error drawing HUD: %s\n", e.what());
 	}
 
@@ -3,6 +3,7 @@
 #define SPT_HUD_ENABLED
 
 #include <functional>
+#include <string>
 #include <vector>
 #include <unordered_map>
 #include "..\feature.hpp"
@@ -37,6 +38,29 @@ struct HudCallback
 	std::function<bool()> shouldDraw;
 };
 
+/*
+* The text lines a group drew last frame. Callbacks still run every frame, but their lines are kept around so
+* that a line only has to be measured again if its text (or the group's font) changed, and the callbacks don't
+* have to run twice to measure the background.
+*/
+struct HudTextLayout
+{
+	struct Line
+	{
+		Color color;
+		std::wstring text;
+		int width = 0, height = 0;
+		bool measured = false;
+	};
+
+	std::vector<Line> lines;
+	size_t nLines = 0;         // lines drawn this frame, the ones past this keep their buffers for later
+	size_t nMeasuredLines = 0; // nLines when width & height were last calculated
+	vgui::HFont font = 0;
+	int width = 0, height = 0;
+	bool dirty = true;
+};
+
 struct HudUserGroup
 {
 	HudUserGroup();
@@ -51,8 +75,10 @@ struct HudUserGroup
 	{
 		std::string name;
 		std::string args;
+		HudCallback* callback; // resolved when added, points into hudCallbacks
 	};
 	std::vector<GruopCallback> callbacks;
+	HudTextLayout layout;
 };
 
 // HUD stuff
@@ -93,9 +119,9 @@ private:
 	int topVertIndex = 0;
 	int topFontTall = 0;
 
-	int textWidth = 0;
-	int textHeight = 0;
-	bool drawText = false;
+	// the layout that DrawTopHudElement() adds lines to, only set while running the callbacks
+	HudTextLayout* curLayout = nullptr;
+	HudTextLayout defaultLayout;
 
 	Color hudTextColor;
 	vgui::HFont font = 0;
@@ -139,6 +165,8 @@ private:
 #endif
 
 	void DrawHUD(bool overlay);
+	void BeginLayout(HudTextLayout& layout, vgui::HFont layoutFont);
+	void DrawLayout(HudTextLayout& layout, Color background);
 	void DrawDefaultHUD();
 	void vDrawTopHudElement(Color color, const wchar* format, va_list args);
 };
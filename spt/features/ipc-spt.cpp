@@ -1,13 +1,17 @@
 #include "stdafx.hpp"
 #include "..\feature.hpp"
+
 #include "convar.hpp"
 #include "file.hpp"
 #include "thirdparty\json.hpp"
 #include "ent_utils.hpp"
+#include "ent_props.hpp"
 #include "property_getter.hpp"
 #include "signals.hpp"
 #include "..\scripts\srctas_reader.hpp"
+#include "..\scripts\parallel_search.hpp"
 #include "..\ipc\ipc.hpp"
+#include "..\ipc\ipc_stream.hpp"
 #include "..\sptlib-wrapper.hpp"
 
 namespace ipc
@@ -17,6 +21,10 @@ namespace ipc
 	void Loop();
 	void ShutdownIPC();
 	void Send(const nlohmann::json& msg);
+	void SubscribeCallback(const nlohmann::json& msg);
+	void UnsubscribeCallback(const nlohmann::json& msg);
+	void StreamSubscriptions(bool simulating);
+	void StopStreaming();
 
 	class IPCFeature : public FeatureWrapper<IPCFeature>
 	{
@@ -56,6 +64,7 @@ namespace ipc
 	{
 		if (ipc::Winsock_Initialized())
 		{
+			StopStreaming();
 			server.CloseConnections();
 			ipc::Shutdown_IPC();
 		}
@@ -78,6 +87,37 @@ namespace ipc
 		}
 	}
 
+	// Runs one candidate of a tas_script_search_parallel started in another game
+	void SearchRunCallback(const nlohmann::json& msg)
+	{
+		if (msg.find("id") == msg.end() || msg.find("script") == msg.end())
+		{
+			Msg("search_run message is missing the id or script field!\n");
+			return;
+		}
+
+		int id = msg["id"];
+		std::string script = msg["script"];
+		std::map<std::string, int> assignment;
+		if (msg.find("assignment") != msg.end())
+		{
+			for (auto& item : msg["assignment"].items())
+				assignment[item.key()] = item.value().get<int>();
+		}
+
+		scripts::g_TASReader.ExecuteSearchCandidate(script,
+		                                            assignment,
+		                                            [id](scripts::SearchResult result, int tick)
+		                                            {
+			                                            nlohmann::json resultMsg;
+			                                            resultMsg["type"] = "search_result";
+			                                            resultMsg["id"] = id;
+			                                            resultMsg["result"] = scripts::GetSearchResultName(result);
+			                                            resultMsg["tick"] = tick;
+			                                            ipc::Send(resultMsg);
+		                                            });
+	}
+
 	void MsgWrapper(const char* msg)
 	{
 		Msg(msg);
@@ -91,6 +131,9 @@ namespace ipc
 			StartIPC();
 		}
 		server.AddCallback("cmd", CmdCallback, false);
+		server.AddCallback("search_run", SearchRunCallback, false);
+		server.AddCallback("subscribe", SubscribeCallback, false);
+		server.AddCallback("unsubscribe", UnsubscribeCallback, false);
 	}
 
 	bool IsActive()
@@ -191,6 +234,417 @@ namespace ipc
 		MapEntToJson(table, ent, json);
 	}
 
+	/*
+	* The binary version of MapEntToJson: the RecvTable walk is done once per class and flattened into a list of
+	* props in the same order. Consecutive props that also sit next to each other in the entity are merged into
+	* runs, so sending an entity is mostly a handful of memcpys from the entity into the server's send buffer.
+	*/
+	struct EntSchema
+	{
+		struct Field
+		{
+			const char* name;
+			IPCPropType type;
+			int offset;
+		};
+
+		struct Run
+		{
+			int offset;
+			uint32_t size; // 0 for strings
+		};
+
+		uint32_t id;
+		const char* className;
+		std::vector<Field> fields;
+		std::vector<Run> runs;
+	};
+
+	static std::unordered_map<RecvTable*, EntSchema> entSchemas;
+
+	static void CollectSchemaFields(RecvTable* table, std::vector<EntSchema::Field>& fields)
+	{
+		for (int i = 0; i < table->m_nProps; ++i)
+		{
+			auto prop = table->GetProp(i);
+
+			if (strcmp(prop->GetName(), "baseclass") == 0)
+			{
+				RecvTable* base = prop->GetDataTable();
+
+				if (base)
+					CollectSchemaFields(base, fields);
+				continue;
+			}
+			else if (prop->GetOffset() == 0)
+			{
+				continue;
+			}
+
+			switch (prop->m_RecvType)
+			{
+			case DPT_Int:
+				fields.push_back({prop->GetName(), IPC_PROP_INT, prop->GetOffset()});
+				break;
+			case DPT_Float:
+				fields.push_back({prop->GetName(), IPC_PROP_FLOAT, prop->GetOffset()});
+				break;
+			case DPT_Vector:
+				fields.push_back({prop->GetName(), IPC_PROP_VECTOR, prop->GetOffset()});
+				break;
+#ifdef SSDK2007
+			case DPT_String:
+				fields.push_back({prop->GetName(), IPC_PROP_STRING, prop->GetOffset()});
+				break;
+#endif
+			default:
+				break;
+			}
+		}
+	}
+
+	static uint32_t GetPropSize(IPCPropType type)
+	{
+		switch (type)
+		{
+		case IPC_PROP_INT:
+			return sizeof(int);
+		case IPC_PROP_FLOAT:
+			return sizeof(float);
+		case IPC_PROP_VECTOR:
+			return sizeof(Vector);
+		default:
+			return 0;
+		}
+	}
+
+	static const EntSchema& GetEntSchema(ClientClass* clientClass)
+	{
+		auto table = clientClass->m_pRecvTable;
+		auto it = entSchemas.find(table);
+		if (it != entSchemas.end())
+			return it->second;
+
+		EntSchema& schema = entSchemas[table];
+		schema.id = entSchemas.size() - 1;
+		schema.className = clientClass->GetName();
+		CollectSchemaFields(table, schema.fields);
+
+		for (auto& field : schema.fields)
+		{
+			uint32_t size = GetPropSize(field.type);
+			if (size > 0 && !schema.runs.empty() && schema.runs.back().size > 0
+			    && schema.runs.back().offset + (int)schema.runs.back().size == field.offset)
+			{
+				schema.runs.back().size += size;
+			}
+			else
+			{
+				schema.runs.push_back({field.offset, size});
+			}
+		}
+		return schema;
+	}
+
+	template<typename T>
+	static void AppendValue(std::vector<char>& buf, T value)
+	{
+		const char* p = reinterpret_cast<const char*>(&value);
+		buf.insert(buf.end(), p, p + sizeof(T));
+	}
+
+	static void AppendString(std::vector<char>& buf, const char* str)
+	{
+		uint16_t len = str ? (uint16_t)strnlen(str, UINT16_MAX) : 0;
+		AppendValue(buf, len);
+		buf.insert(buf.end(), str, str + len);
+	}
+
+	static void SendEntSchema(IPCServer& srv, const EntSchema& schema)
+	{
+		auto& buf = srv.BeginFrame(IPC_FRAME_ENT_SCHEMA);
+		AppendValue(buf, schema.id);
+		AppendString(buf, schema.className);
+		AppendValue(buf, (uint16_t)schema.fields.size());
+		for (auto& field : schema.fields)
+		{
+			AppendValue(buf, field.type);
+			AppendString(buf, field.name);
+		}
+		srv.EndFrame();
+	}
+
+	// Sends the entity as a binary frame, ent can be null if the entity doesn't exist
+	void SendEntBinary(IPCServer& srv, int index, IClientEntity* ent)
+	{
+		const EntSchema* schema = ent ? &GetEntSchema(ent->GetClientClass()) : nullptr;
+		if (schema && srv.MarkSchemaSent(schema->id))
+			SendEntSchema(srv, *schema);
+
+		auto& buf = srv.BeginFrame(IPC_FRAME_ENT);
+		AppendValue(buf, (uint32_t)index);
+		AppendValue(buf, schema ? schema->id : IPC_NO_SCHEMA);
+		if (schema)
+		{
+			auto base = reinterpret_cast<const char*>(ent);
+			for (auto& run : schema->runs)
+			{
+				if (run.size > 0)
+					buf.insert(buf.end(), base + run.offset, base + run.offset + run.size);
+				else
+					AppendString(buf, *reinterpret_cast<const char* const*>(base + run.offset));
+			}
+		}
+		srv.EndFrame();
+	}
+
+	/*
+	* Subscriptions push datamap fields of a set of entities every tick, see ipc_stream.hpp for the format. The
+	* offsets are resolved once when subscribing and the last sent values are kept around so that only the
+	* changes go out. The frames are handed to a separate thread which does the sending.
+	*/
+	struct StreamField
+	{
+		int offset;
+		uint32_t size;
+	};
+
+	struct Subscription
+	{
+		uint32_t id;
+		bool serverEnts;
+		std::vector<int> entIndices;
+		std::vector<StreamField> fields;
+		uint32_t rowSize = 0;         // size of all the fields of one entity
+		std::vector<char> lastValues; // what the client has, rowSize bytes per entity
+		std::vector<bool> synced;     // false if the client doesn't have the values of the entity
+		bool resync = false;
+	};
+
+	static std::vector<Subscription> subscriptions;
+	static IPCStreamSender streamSender(1 << 22);
+	static uint32_t streamConnectionId;
+	static uint32_t streamTick;
+	static std::vector<char> streamBuffer;
+
+	static uint32_t GetStreamFieldSize(const std::string& type)
+	{
+		if (type == "int" || type == "float")
+			return 4;
+		else if (type == "bool")
+			return 1;
+		else if (type == "vector")
+			return sizeof(Vector);
+		return 0;
+	}
+
+	static void SendSubscribeError(nlohmann::json& reply, const std::string& error)
+	{
+		reply["error"] = error;
+		ipc::Send(reply);
+	}
+
+	void SubscribeCallback(const nlohmann::json& msg)
+	{
+		nlohmann::json reply;
+		reply["type"] = "subscribed";
+
+		if (!server.BinaryMode())
+		{
+			SendSubscribeError(reply, "subscribing requires binary mode");
+			return;
+		}
+		else if (!TickSignal.Works)
+		{
+			SendSubscribeError(reply, "streaming is not supported in this game");
+			return;
+		}
+
+		Subscription sub;
+		try
+		{
+			sub.id = msg.at("id").get<uint32_t>();
+			reply["id"] = sub.id;
+			sub.serverEnts = msg.value("server", true);
+			sub.entIndices = msg.at("entities").get<std::vector<int>>();
+
+			for (auto& jField : msg.at("fields"))
+			{
+				std::string map = jField.at("map");
+				std::string name = jField.at("field");
+				std::string type = jField.at("type");
+
+				uint32_t size = GetStreamFieldSize(type);
+				int offset = spt_entprops.GetFieldOffset(map, name, sub.serverEnts);
+				if (size == 0)
+				{
+					SendSubscribeError(reply, "unknown field type " + type);
+					return;
+				}
+				else if (offset == utils::INVALID_DATAMAP_OFFSET)
+				{
+					SendSubscribeError(reply, "unknown field " + map + "::" + name);
+					return;
+				}
+				sub.fields.push_back({offset, size});
+				sub.rowSize += size;
+			}
+		}
+		catch (const nlohmann::json::exception& ex)
+		{
+			SendSubscribeError(reply, ex.what());
+			return;
+		}
+
+		if (sub.entIndices.size() >= IPC_STREAM_ENT_GONE || sub.fields.size() >= IPC_STREAM_ENT_GONE)
+		{
+			SendSubscribeError(reply, "too many entities or fields");
+			return;
+		}
+		else if (std::ranges::any_of(sub.entIndices, [](int i) { return i < 0 || i >= MAX_EDICTS; }))
+		{
+			SendSubscribeError(reply, "invalid entity index");
+			return;
+		}
+
+		/*
+		* A frame that doesn't fit into the sender's ring can never be queued, the subscription would resync
+		* forever without sending anything. The biggest frame has every field (or a gone marker) of every entity.
+		*/
+		uint64_t maxEntSize = std::max<uint64_t>(sub.rowSize + sub.fields.size() * sizeof(uint16_t) * 2,
+		                                         sizeof(uint16_t) * 2);
+		uint64_t maxFrameSize = sizeof(uint32_t) * 3 + sizeof(uint8_t) + sub.entIndices.size() * maxEntSize;
+		if (maxFrameSize > streamSender.GetMaxPayloadSize())
+		{
+			DevWarning("SPT: Rejected IPC subscription %u, its frames can be up to %llu bytes which is more than "
+			           "the stream buffer can hold (%u bytes).\n",
+			           sub.id,
+			           maxFrameSize,
+			           streamSender.GetMaxPayloadSize());
+			SendSubscribeError(reply, "too much data per tick, subscribe to fewer entities or fields");
+			return;
+		}
+
+		sub.lastValues.resize(sub.entIndices.size() * sub.rowSize);
+		sub.synced.assign(sub.entIndices.size(), false);
+
+		// subscriptions of a previous client
+		if (server.GetConnectionId() != streamConnectionId)
+		{
+			subscriptions.clear();
+			streamConnectionId = server.GetConnectionId();
+		}
+		std::erase_if(subscriptions, [&](const Subscription& other) { return other.id == sub.id; });
+		subscriptions.push_back(std::move(sub));
+		streamSender.Start(server);
+
+		reply["entities"] = subscriptions.back().entIndices.size();
+		reply["fields"] = subscriptions.back().fields.size();
+		ipc::Send(reply);
+	}
+
+	void UnsubscribeCallback(const nlohmann::json& msg)
+	{
+		nlohmann::json reply;
+		reply["type"] = "unsubscribed";
+
+		auto id = msg.find("id");
+		if (id == msg.end() || !id->is_number_unsigned())
+		{
+			reply["error"] = "missing id";
+		}
+		else
+		{
+			reply["id"] = *id;
+			size_t nErased = std::erase_if(subscriptions,
+			                               [&](const Subscription& sub) { return sub.id == id->get<uint32_t>(); });
+			if (nErased == 0)
+				reply["error"] = "no such subscription";
+		}
+		ipc::Send(reply);
+	}
+
+	static void StreamSubscription(Subscription& sub)
+	{
+		streamBuffer.clear();
+		AppendValue(streamBuffer, sub.id);
+		AppendValue(streamBuffer, streamTick);
+		AppendValue(streamBuffer, (uint8_t)(sub.resync ? IPC_STREAM_RESYNC : 0));
+		size_t countPos = streamBuffer.size();
+		uint32_t nChanges = 0;
+		AppendValue(streamBuffer, nChanges);
+
+		for (uint16_t slot = 0; slot < sub.entIndices.size(); slot++)
+		{
+			int index = sub.entIndices[slot];
+			auto ent = sub.serverEnts ? (const char*)utils::spt_serverEntList.GetEnt(index)
+			                          : (const char*)utils::spt_clientEntList.GetEnt(index);
+			if (!ent)
+			{
+				if (sub.synced[slot])
+				{
+					AppendValue(streamBuffer, slot);
+					AppendValue(streamBuffer, IPC_STREAM_ENT_GONE);
+					nChanges++;
+					sub.synced[slot] = false;
+				}
+				continue;
+			}
+
+			char* last = sub.lastValues.data() + slot * sub.rowSize;
+			for (uint16_t fieldIdx = 0; fieldIdx < sub.fields.size(); fieldIdx++)
+			{
+				auto& field = sub.fields[fieldIdx];
+				const char* value = ent + field.offset;
+				if (!sub.synced[slot] || memcmp(value, last, field.size))
+				{
+					AppendValue(streamBuffer, slot);
+					AppendValue(streamBuffer, fieldIdx);
+					streamBuffer.insert(streamBuffer.end(), value, value + field.size);
+					memcpy(last, value, field.size);
+					nChanges++;
+				}
+				last += field.size;
+			}
+			sub.synced[slot] = true;
+		}
+
+		if (nChanges == 0 && !sub.resync)
+			return;
+		memcpy(streamBuffer.data() + countPos, &nChanges, sizeof nChanges);
+
+		if (streamSender.Push(streamConnectionId, IPC_FRAME_STREAM, streamBuffer))
+		{
+			sub.resync = false;
+		}
+		else
+		{
+			// the client is too slow, start over once there's room again
+			sub.resync = true;
+			sub.synced.assign(sub.synced.size(), false);
+		}
+	}
+
+	void StreamSubscriptions(bool simulating)
+	{
+		if (subscriptions.empty())
+			return;
+		if (!server.BinaryMode() || server.GetConnectionId() != streamConnectionId)
+		{
+			subscriptions.clear();
+			return;
+		}
+
+		streamTick++;
+		for (auto& sub : subscriptions)
+			StreamSubscription(sub);
+	}
+
+	void StopStreaming()
+	{
+		streamSender.Stop();
+		subscriptions.clear();
+	}
 } // namespace ipc
 
 #if !defined(OE)
@@ -207,11 +661,18 @@ CON_COMMAND(y_spt_ipc_ent, "Outputs entity data to IPC client.\n")
 		return;
 	}
 
-	nlohmann::json msg;
-	msg["type"] = "ent";
 	int index = std::atoi(args.Arg(1));
 	auto ent = utils::spt_clientEntList.GetEnt(index);
 
+	if (ipc::server.BinaryMode())
+	{
+		ipc::SendEntBinary(ipc::server, index, ent);
+		return;
+	}
+
+	nlohmann::json msg;
+	msg["type"] = "ent";
+
 	if (!ent)
 	{
 		msg["exists"] = false;
@@ -350,6 +811,8 @@ void ipc::IPCFeature::LoadFeature()
 	{
 		Init();
 		FrameSignal.Connect(Loop);
+		if (TickSignal.Works)
+			TickSignal.Connect(StreamSubscriptions);
 #ifndef OE
 		InitCommand(y_spt_ipc_ent);
 		InitCommand(y_spt_ipc_properties);
@@ -0,0 +1,216 @@
+#include "stdafx.hpp"
+#include "..\feature.hpp"
+
+#include <chrono>
+#include <memory>
+
+#include "interfaces.hpp"
+#include "playerio.hpp"
+#include "tas.hpp"
+#include "ent_utils.hpp"
+#include "file.hpp"
+#include "thread_pool.hpp"
+#include "..\strafe\strafe_sim.hpp"
+
+#undef min
+#undef max
+
+// Runs strafe parameter searches against a box world without playing anything back in the game
+class StrafeOfflineFeature : public FeatureWrapper<StrafeOfflineFeature>
+{
+public:
+	std::unique_ptr<Strafe::TraceBackend> world;
+	std::string worldName;
+	Vector goal;
+	float goalRadius = 0;
+
+protected:
+	virtual void LoadFeature() override;
+	virtual void UnloadFeature() override;
+};
+
+static StrafeOfflineFeature spt_strafe_offline;
+
+static Strafe::MovementVars GetDefaultMovementVars()
+{
+	// portal defaults, only used when there's no player to get these from
+	Strafe::MovementVars vars = {};
+	vars.Accelerate = 10;
+	vars.Airaccelerate = 15;
+	vars.EntFriction = 1;
+	vars.Frametime = 0.015f;
+	vars.Friction = 4;
+	vars.Maxspeed = 175;
+	vars.Stopspeed = 100;
+	vars.WishspeedCap = 30;
+	vars.EntGravity = 1;
+	vars.Maxvelocity = 3500;
+	vars.Gravity = 600;
+	vars.Stepsize = 18;
+	return vars;
+}
+
+CON_COMMAND(spt_strafe_sim_load,
+            "Loads the world for offline strafe simulation. Usage: spt_strafe_sim_load plane [height] | <map name>")
+{
+	if (args.ArgC() < 2)
+	{
+		Msg("Usage: spt_strafe_sim_load plane [height] | <map name>\n");
+		return;
+	}
+
+	if (!strcmp(args.Arg(1), "plane"))
+	{
+		float z = args.ArgC() > 2 ? (float)atof(args.Arg(2)) : 0.f;
+		spt_strafe_offline.world = std::make_unique<Strafe::PlaneWorld>(z);
+		spt_strafe_offline.worldName = "plane";
+		Msg("Loaded flat plane at z = %g\n", z);
+		return;
+	}
+
+	auto brushWorld = std::make_unique<Strafe::BrushWorld>();
+	const char* err = nullptr;
+	if (!brushWorld->LoadFromBsp(GetGameDir() + "\\maps\\" + args.Arg(1) + ".bsp", &err))
+	{
+		Warning("Could not load map: %s\n", err);
+		return;
+	}
+	brushWorld->Build();
+	Msg("Loaded %u boxes from %s\n", brushWorld->GetBoxCount(), args.Arg(1));
+	spt_strafe_offline.world = std::move(brushWorld);
+	spt_strafe_offline.worldName = args.Arg(1);
+}
+
+CON_COMMAND(spt_strafe_sim_goal,
+            "Sets the goal for offline strafe simulation. Usage: spt_strafe_sim_goal <x> <y> <z> <radius> | off")
+{
+	if (args.ArgC() == 5)
+	{
+		spt_strafe_offline.goal.Init(atof(args.Arg(1)), atof(args.Arg(2)), atof(args.Arg(3)));
+		spt_strafe_offline.goalRadius = (float)atof(args.Arg(4));
+	}
+	else if (args.ArgC() == 2 && !strcmp(args.Arg(1), "off"))
+	{
+		spt_strafe_offline.goalRadius = 0;
+	}
+	else
+	{
+		Msg("Usage: spt_strafe_sim_goal <x> <y> <z> <radius> | off\n");
+	}
+}
+
+CON_COMMAND(
+    spt_strafe_sim,
+    "Sweeps tas_strafe_yaw for max accel and max angle strafing in the loaded world, starting from the current player state. Usage: spt_strafe_sim <ticks> [yaw steps]")
+{
+	using namespace std::chrono;
+
+	if (!spt_strafe_offline.world)
+	{
+		Msg("No world loaded, use spt_strafe_sim_load first\n");
+		return;
+	}
+	if (args.ArgC() < 2)
+	{
+		Msg("Usage: spt_strafe_sim <ticks> [yaw steps]\n");
+		return;
+	}
+
+	int ticks = std::max(atoi(args.Arg(1)), 1);
+	int steps = args.ArgC() > 2 ? std::max(atoi(args.Arg(2)), 1) : 360;
+
+	Strafe::SimSetup setup;
+	setup.world = spt_strafe_offline.world.get();
+	setup.goal = spt_strafe_offline.goal;
+	setup.goalRadius = spt_strafe_offline.goalRadius;
+	if (spt_playerio.PlayerIOAddressesFound() && utils::spt_serverEntList.GetPlayer())
+	{
+		setup.start = spt_playerio.GetPlayerData();
+		setup.vars = spt_playerio.GetMovementVars();
+		QAngle va;
+		interfaces::engine->GetViewAngles(va);
+		setup.startYaw = va[YAW];
+	}
+	else
+	{
+		memset(&setup.start, 0, sizeof setup.start);
+		setup.vars = GetDefaultMovementVars();
+	}
+
+	Strafe::StrafeInput input;
+	input.TargetYaw = 0;
+	input.VectorialOffset = 0;
+	input.AngleSpeed = 0;
+	input.Scale = 1;
+	input.AFH = false;
+	input.Vectorial = false;
+	input.JumpOverride = false;
+	input.Strafe = true;
+	input.Version = tas_strafe_version.GetInt();
+
+	std::vector<Strafe::SimParams> params;
+	for (auto type : {Strafe::StrafeType::MAXACCEL, Strafe::StrafeType::MAXANGLE})
+	{
+		for (int i = 0; i < steps; ++i)
+		{
+			Strafe::SimParams p;
+			p.input = input;
+			p.input.TargetYaw = -180.0 + 360.0 * i / steps;
+			p.type = type;
+			p.ticks = ticks;
+			params.push_back(p);
+		}
+	}
+
+	std::vector<Strafe::SimResult> results;
+	auto start = steady_clock::now();
+	Strafe::SimulateMany(setup, params, results);
+	double ms = duration<double, std::milli>(steady_clock::now() - start).count();
+
+	size_t totalTicks = 0;
+	size_t best = 0;
+	auto score = [&](size_t i)
+	{
+		// reaching the goal beats everything else, then sooner is better, otherwise go as far as possible
+		if (results[i].goalTick >= 0)
+			return 1e9 - results[i].goalTick;
+		return (double)(results[i].end.UnduckedOrigin - setup.start.UnduckedOrigin).Length2D();
+	};
+	for (size_t i = 0; i < results.size(); ++i)
+	{
+		totalTicks += results[i].goalTick >= 0 ? results[i].goalTick : params[i].ticks;
+		if (score(i) > score(best))
+			best = i;
+	}
+
+	Msg("Simulated %u parameter sets (%u ticks) in %.1f ms on %u threads, %.0f ticks/s\n",
+	    params.size(),
+	    totalTicks,
+	    ms,
+	    utils::GetThreadPool().GetThreadCount() + 1,
+	    totalTicks / (ms / 1000.0));
+
+	const auto& r = results[best];
+	Msg("Best: tas_strafe_type %d, tas_strafe_yaw %.3f\n", (int)params[best].type, params[best].input.TargetYaw);
+	if (r.goalTick >= 0)
+		Msg("  reached the goal on tick %d\n", r.goalTick);
+	Msg("  end pos: %.3f %.3f %.3f, end speed: %.3f, max speed: %.3f, ground ticks: %d\n",
+	    r.end.UnduckedOrigin.x,
+	    r.end.UnduckedOrigin.y,
+	    r.end.UnduckedOrigin.z,
+	    r.end.Velocity.Length2D(),
+	    r.maxSpeed,
+	    r.groundTicks);
+}
+
+void StrafeOfflineFeature::LoadFeature()
+{
+	InitCommand(spt_strafe_sim_load);
+	InitCommand(spt_strafe_sim_goal);
+	InitCommand(spt_strafe_sim);
+}
+
+void StrafeOfflineFeature::UnloadFeature()
+{
+	world.reset();
+}
@@ -11,6 +11,7 @@
 #include "game_detection.hpp"
 #include "math.hpp"
 #include "signals.hpp"
+#include "..\strafe\strafe_batch.hpp"
 #include "visualizations\imgui\imgui_interface.hpp"
 
 #ifdef OE
@@ -41,6 +42,7 @@ protected:
 private:
 	Vector wishDir;
 	std::vector<float> accels;
+	Strafe::AccelBatch accelBatch;
 
 	struct Line
 	{
@@ -207,14 +209,15 @@ static inline __m128 GetMaxAccels(const Strafe::PlayerData player,
 	                  GetMaxSpeeds(player, vars, wishDirX, wishDirY, true));
 }
 
-static void GetAccelAfterMove(const Strafe::PlayerData player,
-                              const Strafe::MovementVars& vars,
-                              float sinPlayerYaw,
-                              float cosPlayerYaw,
-                              const Vector& oldVel,
-                              float oldVelLength2D,
-                              const float* yaws,
-                              float* outAccel)
+// Fills 4 lanes of the acceleration batch starting at index i, the acceleration itself is done by the batch kernel.
+static void FillAccelLanes(const Strafe::PlayerData player,
+                           const Strafe::MovementVars& vars,
+                           float sinPlayerYaw,
+                           float cosPlayerYaw,
+                           const Vector& oldVel,
+                           const float* yaws,
+                           Strafe::AccelBatch& batch,
+                           size_t i)
 {
 	const __m128 vecYaws = _mm_loadu_ps(yaws);
 	const __m128 forwardmoves = _mm_cos_ps(vecYaws);
@@ -230,27 +233,18 @@ static void GetAccelAfterMove(const Strafe::PlayerData player,
 	const __m128 maxSpeeds = GetMaxSpeeds(player, vars, wishDirX, wishDirY, false);
 	const __m128 maxAccels = GetMaxAccels(player, vars, wishDirX, wishDirY);
 
-	const __m128 velX = _mm_set1_ps(oldVel.x);
-	const __m128 velY = _mm_set1_ps(oldVel.y);
-
-	wishDirX = _mm_div_ps(wishDirX, wishDirLengths);
-	wishDirY = _mm_div_ps(wishDirY, wishDirLengths);
-
-	const __m128 dotProducts = _mm_add_ps(_mm_mul_ps(velX, wishDirX), _mm_mul_ps(velY, wishDirY));
-	const __m128 accelDiff = _mm_sub_ps(maxSpeeds, dotProducts);
-	const __m128 accelMask = _mm_cmple_ps(accelDiff, _mm_set1_ps(0.0f));
-
-	const __m128 accelForce = _mm_min_ps(maxAccels, accelDiff);
-
-	const __m128 newVelX = _mm_add_ps(velX, _mm_mul_ps(wishDirX, accelForce));
-	const __m128 newVelY = _mm_add_ps(velY, _mm_mul_ps(wishDirY, accelForce));
-	const __m128 newVelLen = _mm_sqrt_ps(_mm_add_ps(_mm_mul_ps(newVelX, newVelX), _mm_mul_ps(newVelY, newVelY)));
-
-	const __m128 accel = _mm_sub_ps(newVelLen, _mm_set1_ps(oldVelLength2D));
-
-	const __m128 result = _mm_blendv_ps(accel, _mm_set1_ps(0.0f), _mm_or_ps(zeroMask, accelMask));
-
-	_mm_storeu_ps(outAccel, result);
+	// a zero wish dir doesn't accelerate the player, avoid dividing by zero
+	wishDirX = _mm_blendv_ps(_mm_div_ps(wishDirX, wishDirLengths), _mm_set1_ps(0.0f), zeroMask);
+	wishDirY = _mm_blendv_ps(_mm_div_ps(wishDirY, wishDirLengths), _mm_set1_ps(0.0f), zeroMask);
+
+	_mm_storeu_ps(&batch.velX[i], _mm_set1_ps(oldVel.x));
+	_mm_storeu_ps(&batch.velY[i], _mm_set1_ps(oldVel.y));
+	_mm_storeu_ps(&batch.dirX[i], wishDirX);
+	_mm_storeu_ps(&batch.dirY[i], wishDirY);
+	_mm_storeu_pd(&batch.wishspeedCapped[i], _mm_cvtps_pd(maxSpeeds));
+	_mm_storeu_pd(&batch.wishspeedCapped[i + 2], _mm_cvtps_pd(_mm_movehl_ps(maxSpeeds, maxSpeeds)));
+	_mm_storeu_pd(&batch.accelspeed[i], _mm_cvtps_pd(maxAccels));
+	_mm_storeu_pd(&batch.accelspeed[i + 2], _mm_cvtps_pd(_mm_movehl_ps(maxAccels, maxAccels)));
 }
 
 void StrafeHUD::SetData(uintptr_t pCmd)
@@ -304,7 +298,8 @@ void StrafeHUD::SetData(uintptr_t pCmd)
 
 	int detail = spt_strafehud_size.GetInt() * spt_strafehud_detail_scale.GetFloat();
 	detail = ((detail + 3) / 4) * 4; // round up to multiple of 4
-	accels.reserve(detail);
+	accels.resize(detail);
+	accelBatch.Resize(detail);
 
 	const Vector oldVel = GetGroundFrictionVelocity(player, vars);
 
@@ -319,16 +314,17 @@ void StrafeHUD::SetData(uintptr_t pCmd)
 			ang[j] = ((i + j) / (float)detail) * 2.0f * M_PI + relAng;
 		}
 
-		std::array<float, 4> accel{};
-		GetAccelAfterMove(player,
-		                  vars,
-		                  sinPlayerYaw,
-		                  cosPlayerYaw,
-		                  oldVel,
-		                  oldVel.Length2D(),
-		                  ang.data(),
-		                  accel.data());
-		accels.insert(accels.end(), accel.begin(), accel.end());
+		FillAccelLanes(player, vars, sinPlayerYaw, cosPlayerYaw, oldVel, ang.data(), accelBatch, i);
+	}
+
+	accelBatch.Run();
+
+	const float oldVelLength2D = std::sqrtf(oldVel.x * oldVel.x + oldVel.y * oldVel.y);
+	for (int i = 0; i < detail; i++)
+	{
+		const float x = accelBatch.outVelX[i];
+		const float y = accelBatch.outVelY[i];
+		accels[i] = std::sqrtf(x * x + y * y) - oldVelLength2D;
 	}
 
 	auto [minIt, maxIt] = std::minmax_element(accels.begin(), accels.end());
@@ -4,6 +4,7 @@
 #include "..\sptlib-wrapper.hpp"
 #include "..\strafe\strafestuff.hpp"
 #include "..\scripts\srctas_reader.hpp"
+#include "..\scripts\parallel_search.hpp"
 #include "aim.hpp"
 #include "generic.hpp"
 #include "hud.hpp"
@@ -277,6 +278,29 @@ CON_COMMAND_AUTOCOMPLETEFILE(tas_script_search, "Starts a variable search for an
 		Msg("Usage: spt_tas_load_search [script]\n");
 }
 
+CON_COMMAND_AUTOCOMPLETEFILE(
+    tas_script_search_parallel,
+    "Starts a variable search for an .srctas script, running candidates on this game and on the SPT instances listening on the given IPC ports. Usage: tas_script_search_parallel <script> [port ...]",
+    0,
+    "",
+    ".srctas")
+{
+	if (args.ArgC() > 1)
+	{
+		std::vector<std::string> ports;
+		for (int i = 2; i < args.ArgC(); ++i)
+			ports.push_back(args.Arg(i));
+		scripts::g_ParallelSearch.Start(args.Arg(1), ports);
+	}
+	else
+		Msg("Usage: tas_script_search_parallel <script> [port ...]\n");
+}
+
+CON_COMMAND(tas_script_search_parallel_stop, "Stops a parallel variable search.")
+{
+	scripts::g_ParallelSearch.Stop();
+}
+
 CON_COMMAND(tas_script_result_success, "Signals a successful result in a variable search.")
 {
 	scripts::g_TASReader.SearchResult(scripts::SearchResult::Success);
@@ -298,6 +322,8 @@ void TASFeature::LoadFeature()
 	{
 		InitCommand(tas_script_load);
 		InitCommand(tas_script_search);
+		InitCommand(tas_script_search_parallel);
+		InitCommand(tas_script_search_parallel_stop);
 		InitCommand(tas_script_result_success);
 		InitCommand(tas_script_result_fail);
 		InitCommand(tas_script_result_stop);
@@ -307,6 +333,8 @@ void TASFeature::LoadFeature()
 		InitConcommandBase(tas_script_onsuccess);
 
 		AfterFramesSignal.Connect(&scripts::g_TASReader, &scripts::SourceTASReader::OnAfterFrames);
+		if (FrameSignal.Works)
+			FrameSignal.Connect(&scripts::g_ParallelSearch, &scripts::ParallelSearch::Poll);
 #ifdef SPT_HUD_ENABLED
 		bool hudEnabled = AddHudCallback(
 		    "script_progress",
@@ -1,28 +1,107 @@
 #include "stdafx.hpp"
 #include "..\feature.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <thread>
+
 #include "cmodel.h"
 #include "SDK\hl_movedata.h"
 #include "convar.hpp"
 #include "interfaces.hpp"
 #include "signals.hpp"
+#include "file.hpp"
+#include "spsc_ring.hpp"
 
 ConVar tas_log("tas_log", "0", 0, "If enabled, dumps a whole bunch of different stuff into the console.");
 
+/*
+* One ProcessMovement call in a binary movement log. The file is a MovementLogHeader followed by these back to
+* back, Tests\movement_log.py can dump and diff them. seq counts every call while logging, so a gap means records
+* were dropped because the writer thread fell behind.
+*/
+struct MovementLogRecord
+{
+	uint32_t seq;
+	int32_t tick;
+	uint32_t flags;
+	int32_t buttons;
+	float origin[3];
+	float velocity[3];
+	float viewAngles[3];
+	float forwardMove;
+	float sideMove;
+	float upMove;
+};
+static_assert(sizeof(MovementLogRecord) == 64);
+
+enum MovementLogFlags : uint32_t
+{
+	MLF_POST = 1, // after the movement code ran
+};
+
+constexpr char MOVEMENT_LOG_ID[8] = "sptmvlg";
+constexpr uint32_t MOVEMENT_LOG_VERSION = 1;
+
+struct MovementLogHeader
+{
+	char id[sizeof MOVEMENT_LOG_ID];
+	uint32_t version;
+	uint32_t recordSize;
+};
+
 // Some logging stuff that can be turned on with tas_log 1
 class TASLogging : public FeatureWrapper<TASLogging>
 {
 public:
+	bool StartMovementLog(const std::string& path);
+	void StopMovementLog();
+
 protected:
 	virtual bool ShouldLoadFeature() override;
 	virtual void LoadFeature() override;
+	virtual void UnloadFeature() override;
 
 private:
+	// 512 KiB, a couple of seconds of movement even if the disk stalls completely
+	using Ring = utils::SpscRing<MovementLogRecord, 8192>;
+
 	static void ProcessMovementPre(void* pPlayer, void* pMove);
 	static void ProcessMovementPost(void* pPlayer, void* pMove);
+	void LogMovement(const CHLMoveData* mv, uint32_t flags);
+	void WriterThread();
+
+	std::unique_ptr<Ring> ring;
+	std::ofstream ofs;
+	std::thread thread;
+	std::atomic_bool stopping = false;
+	std::atomic_bool failed = false;
+	uint32_t nextSeq = 0;
+	uint32_t nDropped = 0;
 };
 
 static TASLogging spt_taslogging;
 
+CON_COMMAND(spt_tas_log_start,
+            "Starts writing the player's movement on every ProcessMovement call to a binary log. Usage: "
+            "spt_tas_log_start <file name>")
+{
+	if (args.ArgC() != 2)
+	{
+		Msg("Usage: spt_tas_log_start <file name>\n");
+		return;
+	}
+	std::string path = GetGameDir() + "\\" + args.Arg(1) + ".mvlog";
+	if (spt_taslogging.StartMovementLog(path))
+		Msg("Logging movement to %s\n", path.c_str());
+}
+
+CON_COMMAND(spt_tas_log_stop, "Stops the binary movement log")
+{
+	spt_taslogging.StopMovementLog();
+}
+
 bool TASLogging::ShouldLoadFeature()
 {
 	return true;
@@ -33,14 +112,112 @@ void TASLogging::LoadFeature()
 	if (ProcessMovementPre_Signal.Works && ProcessMovementPost_Signal.Works)
 	{
 		ProcessMovementPre_Signal.Connect(ProcessMovementPre);
-		ProcessMovementPost_Signal.Connect(ProcessMovementPre);
+		ProcessMovementPost_Signal.Connect(ProcessMovementPost);
 		InitConcommandBase(tas_log);
+		InitCommand(spt_tas_log_start);
+		InitCommand(spt_tas_log_stop);
 	}
 }
 
+void TASLogging::UnloadFeature()
+{
+	StopMovementLog();
+	ring.reset();
+}
+
+bool TASLogging::StartMovementLog(const std::string& path)
+{
+	StopMovementLog();
+
+	ofs.open(path, std::ios::binary | std::ios::trunc);
+	if (!ofs.is_open())
+	{
+		Warning("Could not create %s\n", path.c_str());
+		return false;
+	}
+	MovementLogHeader header{.version = MOVEMENT_LOG_VERSION, .recordSize = sizeof(MovementLogRecord)};
+	memcpy(header.id, MOVEMENT_LOG_ID, sizeof header.id);
+	if (!ofs.write((const char*)&header, sizeof header).good())
+	{
+		Warning("Could not write to %s\n", path.c_str());
+		ofs.close();
+		return false;
+	}
+
+	if (!ring)
+		ring = std::make_unique<Ring>();
+	ring->Reset();
+	nextSeq = 0;
+	nDropped = 0;
+	stopping = false;
+	failed = false;
+	thread = std::thread{&TASLogging::WriterThread, this};
+	return true;
+}
+
+void TASLogging::StopMovementLog()
+{
+	if (!thread.joinable())
+		return;
+	stopping = true;
+	thread.join();
+	ofs.close();
+	if (failed)
+		Warning("Failed to write the movement log, it is incomplete\n");
+	else if (nDropped > 0)
+		Warning("Movement log stopped, %u of %u records were dropped\n", nDropped, nextSeq);
+	else
+		Msg("Movement log stopped, wrote %u records\n", nextSeq);
+}
+
+void TASLogging::WriterThread()
+{
+	MovementLogRecord batch[512];
+	while (true)
+	{
+		// check before popping so that nothing pushed before the stop gets left behind
+		bool stop = stopping;
+		size_t n = ring->PopMany(batch, ARRAYSIZE(batch));
+		if (n > 0)
+		{
+			if (!failed && !ofs.write((const char*)batch, n * sizeof(MovementLogRecord)).good())
+				failed = true;
+			continue;
+		}
+		if (stop)
+			break;
+		std::this_thread::sleep_for(std::chrono::milliseconds(2));
+	}
+	ofs.flush();
+	if (!ofs.good())
+		failed = true;
+}
+
+void TASLogging::LogMovement(const CHLMoveData* mv, uint32_t flags)
+{
+	const Vector& origin = mv->GetAbsOrigin();
+	MovementLogRecord record{
+	    .seq = nextSeq++,
+	    .tick = interfaces::engine_tool ? interfaces::engine_tool->HostTick() : -1,
+	    .flags = flags,
+	    .buttons = mv->m_nButtons,
+	    .origin = {origin.x, origin.y, origin.z},
+	    .velocity = {mv->m_vecVelocity.x, mv->m_vecVelocity.y, mv->m_vecVelocity.z},
+	    .viewAngles = {mv->m_vecViewAngles.x, mv->m_vecViewAngles.y, mv->m_vecViewAngles.z},
+	    .forwardMove = mv->m_flForwardMove,
+	    .sideMove = mv->m_flSideMove,
+	    .upMove = mv->m_flUpMove,
+	};
+	// never wait for the disk here, the gap in seq shows up in the dump instead
+	if (!ring->TryPush(record))
+		nDropped++;
+}
+
 void TASLogging::ProcessMovementPre(void* pPlayer, void* pMove)
 {
 	CHLMoveData* mv = reinterpret_cast<CHLMoveData*>(pMove);
+	if (spt_taslogging.thread.joinable())
+		spt_taslogging.LogMovement(mv, 0);
 	if (tas_log.GetBool())
 		DevMsg("[ProcessMovement PRE ] origin: %.8f %.8f %.8f; velocity: %.8f %.8f %.8f\n",
 		       mv->GetAbsOrigin().x,
@@ -54,6 +231,8 @@ void TASLogging::ProcessMovementPre(void* pPlayer, void* pMove)
 void TASLogging::ProcessMovementPost(void* pPlayer, void* pMove)
 {
 	CHLMoveData* mv = reinterpret_cast<CHLMoveData*>(pMove);
+	if (spt_taslogging.thread.joinable())
+		spt_taslogging.LogMovement(mv, MLF_POST);
 	if (tas_log.GetBool())
 		DevMsg("[ProcessMovement POST] origin: %.8f %.8f %.8f; velocity: %.8f %.8f %.8f\n",
 		       mv->GetAbsOrigin().x,
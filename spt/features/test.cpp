@@ -51,6 +51,15 @@ CON_COMMAND(tas_test_automated_validate, "Validates a test, produces a log file
 	}
 }
 
+CON_COMMAND(tas_test_automated_validate_list,
+            "Validates the tests listed in a file (one per line), produces a log file and exits the game.")
+{
+	if (args.ArgC() > 2)
+	{
+		scripts::g_Tester.RunAutomatedTestList(args.Arg(1), args.Arg(2));
+	}
+}
+
 void TestFeature::LoadFeature()
 {
 	if (AfterFramesSignal.Works && AdjustAngles.Works)
@@ -61,5 +70,6 @@ void TestFeature::LoadFeature()
 		InitCommand(tas_test_generate);
 		InitCommand(tas_test_validate);
 		InitCommand(tas_test_automated_validate);
+		InitCommand(tas_test_automated_validate_list);
 	}
 }
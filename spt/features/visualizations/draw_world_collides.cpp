@@ -6,6 +6,7 @@
 #include "spt\utils\ent_utils.hpp"
 #include "spt\utils\interfaces.hpp"
 #include "spt\utils\portal_utils.hpp"
+#include "spt\utils\signals.hpp"
 #include "spt\features\tracing.hpp"
 #include "spt\features\generic.hpp"
 #include "spt\features\create_collide.hpp"
@@ -13,6 +14,10 @@
 #include "renderer\mesh_renderer.hpp"
 #include "imgui\imgui_interface.hpp"
 
+#include <chrono>
+#include <stack>
+#include <unordered_map>
+
 #ifdef SPT_MESH_RENDERING_ENABLED
 
 ConVar spt_draw_world_collides(
@@ -32,6 +37,24 @@ ConVar spt_draw_world_collides_mask("spt_draw_world_collides_mask",
                                     FCVAR_CHEAT | FCVAR_DONTRECORD | FCVAR_HIDDEN,
                                     "The tracing mask used by spt_draw_world_collides.");
 
+ConVar spt_draw_world_collides_radius(
+    "spt_draw_world_collides_radius",
+    "0",
+    FCVAR_CHEAT | FCVAR_DONTRECORD,
+    "If not 0, spt_draw_world_collides also draws all world brushes within this distance of the player. The brushes are grouped into chunks which are built over several frames.");
+
+ConVar spt_draw_world_collides_ms_per_frame(
+    "spt_draw_world_collides_ms_per_frame",
+    "3",
+    FCVAR_DONTRECORD,
+    "How many milliseconds to spend per frame building chunks for spt_draw_world_collides_radius. Larger values fill in the map faster but make the game laggier.");
+
+ConVar spt_draw_world_collides_max_chunks(
+    "spt_draw_world_collides_max_chunks",
+    "256",
+    FCVAR_DONTRECORD,
+    "How many chunks spt_draw_world_collides_radius keeps around, the ones that haven't been drawn for the longest get thrown away first.");
+
 #define _ZTEST (spt_draw_world_collides.GetInt() < 2)
 
 #define SC_BOX_BRUSH (ShapeColor{C_OUTLINE(0, 255, 255, 60), _ZTEST, _ZTEST})
@@ -39,8 +62,94 @@ ConVar spt_draw_world_collides_mask("spt_draw_world_collides_mask",
 #define SC_STATIC_PROP (ShapeColor{C_OUTLINE(200, 50, 50, 40), _ZTEST, _ZTEST})
 #define SC_DISPLACEMENT (ShapeColor{C_OUTLINE(255, 255, 255, 40), _ZTEST, _ZTEST})
 
+// the size of the cells that brushes are grouped into for spt_draw_world_collides_radius
+#define WORLD_CHUNK_SIZE 1024.f
+
 extern class DrawWorldCollideFeature spt_DrawWorldCollides_feat;
 
+static CPolyhedron* CreateBrushPolyhedron(const CCollisionBSPData* bspData, const cbrush_t* brush)
+{
+	static std::vector<VPlane> planes;
+	planes.clear();
+	planes.reserve(brush->numsides);
+	for (int i = 0; i < brush->numsides; i++)
+	{
+		const cbrushside_t* side = &bspData->map_brushsides[brush->firstbrushside + i];
+		if (side->bBevel)
+			continue;
+		planes.emplace_back(side->plane->normal, side->plane->dist);
+	}
+	return GeneratePolyhedronFromPlanes((float*)planes.data(), planes.size(), 0.001, true);
+}
+
+// returns false if the mesh is full
+static bool AddBrush(MeshBuilderDelegate& mb, const CCollisionBSPData* bspData, const cbrush_t* brush)
+{
+	if (brush->IsBox())
+	{
+		const cboxbrush_t* box = &bspData->map_boxbrushes[brush->GetBox()];
+		return mb.AddBox({0, 0, 0}, box->mins, box->maxs, {0, 0, 0}, SC_BOX_BRUSH);
+	}
+	CPolyhedron* poly = CreateBrushPolyhedron(bspData, brush);
+	if (!poly)
+		return true;
+	bool ret = mb.AddCPolyhedron(poly, SC_COMPLEX_BRUSH);
+	poly->Release();
+	return ret;
+}
+
+static bool GetBrushBounds(const CCollisionBSPData* bspData, const cbrush_t* brush, Vector& mins, Vector& maxs)
+{
+	if (brush->IsBox())
+	{
+		const cboxbrush_t* box = &bspData->map_boxbrushes[brush->GetBox()];
+		mins = box->mins;
+		maxs = box->maxs;
+		return true;
+	}
+
+	// vbsp gives every brush axial bevel planes, so the bounds can almost always be read off of those
+	int sidesFound = 0;
+	for (int i = 0; i < brush->numsides; i++)
+	{
+		const cplane_t* plane = bspData->map_brushsides[brush->firstbrushside + i].plane;
+		if (plane->type > PLANE_Z)
+			continue;
+		if (plane->normal[plane->type] > 0)
+		{
+			maxs[plane->type] = plane->dist;
+			sidesFound |= 1 << (plane->type * 2);
+		}
+		else
+		{
+			mins[plane->type] = -plane->dist;
+			sidesFound |= 1 << (plane->type * 2 + 1);
+		}
+	}
+	if (sidesFound == 0x3f)
+		return true;
+
+	CPolyhedron* poly = CreateBrushPolyhedron(bspData, brush);
+	if (!poly)
+		return false;
+	ClearBounds(mins, maxs);
+	for (int i = 0; i < poly->iVertexCount; i++)
+		AddPointToBounds(poly->pVertices[i], mins, maxs);
+	poly->Release();
+	return true;
+}
+
+// the world brushes in one cell of the map, the meshes are only built once the chunk gets close enough
+struct WorldChunk
+{
+	Vector mins, maxs;
+	// indices into map_brushes, the engine reallocates the brushes when a map is loaded (even the same one)
+	std::vector<int> brushIdxs;
+	std::vector<StaticMesh> meshes;
+	bool built = false;
+	uint32_t lastDrawn = 0;
+};
+
 // draws brushes and static props
 class DrawWorldCollideFeature : public FeatureWrapper<DrawWorldCollideFeature>
 {
@@ -50,10 +159,16 @@ protected:
 		if (!spt_meshRenderer.signal.Works)
 			return;
 		spt_meshRenderer.signal.Connect(this, &DrawWorldCollideFeature::OnMeshRenderSignal);
+		if (LevelInitSignal.Works)
+			LevelInitSignal.Connect(this, &DrawWorldCollideFeature::OnLevelInit);
 		cache.Clear();
+		chunks.Clear();
 
 		InitConcommandBase(spt_draw_world_collides);
 		InitConcommandBase(spt_draw_world_collides_mask);
+		InitConcommandBase(spt_draw_world_collides_radius);
+		InitConcommandBase(spt_draw_world_collides_ms_per_frame);
+		InitConcommandBase(spt_draw_world_collides_max_chunks);
 
 		spt_draw_world_collides.InstallChangeCallback(
 		    [](IConVar* var, const char* pOldValue, auto)
@@ -69,6 +184,7 @@ protected:
 	virtual void UnloadFeature() override
 	{
 		cache.Clear();
+		chunks.Clear();
 	};
 
 	struct
@@ -85,7 +201,48 @@ protected:
 		}
 	} cache;
 
+	/*
+	* For spt_draw_world_collides_radius. The world brushes are grouped into cells by their center, each cell
+	* gets its own meshes which are built when the player gets close to it. Only a few milliseconds per frame
+	* are spent building, the closest chunks first, so drawing the whole map doesn't hitch. The number of built
+	* chunks is capped and the ones that weren't drawn for the longest get destroyed to make room.
+	*/
+	struct
+	{
+		// seen by the last trace that hit the world, the engine keeps this around between maps
+		const CCollisionBSPData* bspData;
+		// what the chunk list was built from, if any of these change it's rebuilt
+		std::string mapName;
+		const cbrush_t* mapBrushes;
+		int numBrushes;
+		int mask;
+		bool zTest;
+		std::vector<WorldChunk> list;
+		size_t nBuilt;
+		uint32_t drawCount;
+		std::vector<std::pair<float, size_t>> nearby;
+
+		void Clear()
+		{
+			bspData = nullptr;
+			mapName.clear();
+			mapBrushes = nullptr;
+			numBrushes = 0;
+			list.clear();
+			nBuilt = 0;
+			drawCount = 0;
+		}
+	} chunks;
+
 private:
+	void OnLevelInit(const char*)
+	{
+		// the old brushes are gone, keep the bsp data pointer so the new map gets chunked on the next draw
+		const CCollisionBSPData* bspData = chunks.bspData;
+		chunks.Clear();
+		chunks.bspData = bspData;
+	}
+
 	static void ImGuiCallback()
 	{
 		// copied from the draw world collides callback
@@ -122,6 +279,7 @@ private:
 			return;
 
 		DoTrace(mr); // fills cache
+		DrawChunks(mr);
 
 		if (cache.mesh.Valid())
 		{
@@ -201,6 +359,9 @@ private:
 				    mb.AddCross(tr.endpos, 7, {_COLOR(255, 0, 0, 255)});
 		    }));
 
+		if (hitInfo.bspData)
+			chunks.bspData = hitInfo.bspData;
+
 		if (!memcmp(&cache.lastHitInfo, &hitInfo, sizeof WorldHitInfo) && cache.mesh.Valid())
 			return; // cache is valid
 
@@ -219,36 +380,153 @@ private:
 	{
 		auto bspData = cache.lastHitInfo.bspData;
 		auto brush = cache.lastHitInfo.brush;
+		cache.mesh = spt_meshBuilder.CreateStaticMesh([=](MeshBuilderDelegate& mb) { AddBrush(mb, bspData, brush); });
+	}
 
-		if (brush->IsBox())
-		{
-			cache.mesh = spt_meshBuilder.CreateStaticMesh(
-			    [=](MeshBuilderDelegate& mb)
-			    {
-				    const cboxbrush_t* box = &bspData->map_boxbrushes[brush->GetBox()];
-				    mb.AddBox({0, 0, 0}, box->mins, box->maxs, {0, 0, 0}, SC_BOX_BRUSH);
-			    });
-		}
-		else
+	void BuildChunkList(int mask)
+	{
+		const CCollisionBSPData* bspData = chunks.bspData;
+		chunks.Clear();
+		chunks.bspData = bspData;
+		chunks.mapName = bspData->map_name;
+		chunks.mapBrushes = bspData->map_brushes;
+		chunks.numBrushes = bspData->numbrushes;
+		chunks.mask = mask;
+		chunks.zTest = _ZTEST;
+
+		std::unordered_map<uint64_t, size_t> cellToChunk;
+		std::vector<bool> seen(bspData->numbrushes);
+
+		// only walk the tree of the world model, brush entities have their brushes in their own space
+		std::stack<int, std::vector<int>> s;
+		s.push(bspData->map_cmodels[0].headnode);
+		while (!s.empty())
 		{
-			static std::vector<VPlane> planes;
-			planes.clear();
-			planes.reserve(brush->numsides);
-			for (int i = 0; i < brush->numsides; i++)
+			int curr = s.top();
+			s.pop();
+			if (curr >= 0)
+			{
+				s.push(bspData->map_nodes[curr].children[0]);
+				s.push(bspData->map_nodes[curr].children[1]);
+				continue;
+			}
+
+			const cleaf_t& leaf = bspData->map_leafs[-1 - curr];
+			for (int i = 0; i < leaf.numleafbrushes; i++)
 			{
-				const cbrushside_t* side = &bspData->map_brushsides[brush->firstbrushside + i];
-				if (side->bBevel)
+				unsigned short brushIdx = bspData->map_leafbrushes[leaf.firstleafbrush + i];
+				if (seen[brushIdx])
 					continue;
-				planes.emplace_back(side->plane->normal, side->plane->dist);
+				seen[brushIdx] = true;
+
+				const cbrush_t* brush = &bspData->map_brushes[brushIdx];
+				Vector mins, maxs;
+				if (!(brush->contents & mask) || !GetBrushBounds(bspData, brush, mins, maxs))
+					continue;
+
+				Vector center = (mins + maxs) * 0.5f;
+				uint64_t key = 0;
+				for (int j = 0; j < 3; j++)
+					key = (key << 16) | (uint16_t)(int)floorf(center[j] / WORLD_CHUNK_SIZE);
+
+				auto [it, inserted] = cellToChunk.try_emplace(key, chunks.list.size());
+				if (inserted)
+				{
+					WorldChunk& chunk = chunks.list.emplace_back();
+					chunk.mins = mins;
+					chunk.maxs = maxs;
+				}
+				WorldChunk& chunk = chunks.list[it->second];
+				AddPointToBounds(mins, chunk.mins, chunk.maxs);
+				AddPointToBounds(maxs, chunk.mins, chunk.maxs);
+				chunk.brushIdxs.push_back(brushIdx);
 			}
+		}
+	}
+
+	// destroys the chunk that wasn't drawn for the longest if there are too many, false if none can go
+	bool MakeRoomForChunk()
+	{
+		if (chunks.nBuilt < (size_t)spt_draw_world_collides_max_chunks.GetInt())
+			return true;
+		WorldChunk* oldest = nullptr;
+		for (auto& chunk : chunks.list)
+			if (chunk.built && chunk.lastDrawn != chunks.drawCount && (!oldest || chunk.lastDrawn < oldest->lastDrawn))
+				oldest = &chunk;
+		if (!oldest)
+			return false;
+		oldest->meshes.clear();
+		oldest->built = false;
+		chunks.nBuilt--;
+		return true;
+	}
+
+	void BuildChunk(WorldChunk& chunk)
+	{
+		auto bspData = chunks.bspData;
+		chunk.meshes.clear();
+		spt_meshBuilder.CreateMultipleMeshes<StaticMesh>(
+		    std::back_inserter(chunk.meshes),
+		    chunk.brushIdxs.cbegin(),
+		    chunk.brushIdxs.cend(),
+		    [=](MeshBuilderDelegate& mb, auto idxIt) { return AddBrush(mb, bspData, &bspData->map_brushes[*idxIt]); });
+		chunk.built = true;
+		chunks.nBuilt++;
+	}
 
-			CPolyhedron* poly =
-			    GeneratePolyhedronFromPlanes((float*)planes.data(), planes.size(), 0.001, true);
+	void DrawChunks(MeshRendererDelegate& mr)
+	{
+		using namespace std::chrono;
+
+		float radius = spt_draw_world_collides_radius.GetFloat();
+		if (radius <= 0 || !chunks.bspData)
+			return;
 
-			cache.mesh = spt_meshBuilder.CreateStaticMesh([=](MeshBuilderDelegate& mb)
-			                                              { mb.AddCPolyhedron(poly, SC_COMPLEX_BRUSH); });
+		int mask = strtol(spt_draw_world_collides_mask.GetString(), nullptr, 0);
+		if (chunks.mapName != chunks.bspData->map_name || chunks.mapBrushes != chunks.bspData->map_brushes
+		    || chunks.numBrushes != chunks.bspData->numbrushes || chunks.mask != mask || chunks.zTest != _ZTEST)
+		{
+			BuildChunkList(mask);
+		}
 
-			poly->Release();
+		Vector eyePos = utils::GetPlayerEyePosition();
+		chunks.nearby.clear();
+		for (size_t i = 0; i < chunks.list.size(); i++)
+		{
+			float distSqr = CalcSqrDistanceToAABB(chunks.list[i].mins, chunks.list[i].maxs, eyePos);
+			if (distSqr <= radius * radius)
+				chunks.nearby.emplace_back(distSqr, i);
+		}
+		std::ranges::sort(chunks.nearby);
+
+		auto startTime = high_resolution_clock::now();
+		bool outOfTime = false;
+		chunks.drawCount++;
+		for (auto& [distSqr, i] : chunks.nearby)
+		{
+			WorldChunk& chunk = chunks.list[i];
+			if (chunk.built && !StaticMesh::AllValid(chunk.meshes))
+			{
+				chunk.meshes.clear();
+				chunk.built = false;
+				chunks.nBuilt--;
+			}
+			if (!chunk.built)
+			{
+				// always build at least one chunk per frame
+				if (outOfTime || !MakeRoomForChunk())
+					continue;
+				BuildChunk(chunk);
+				outOfTime = duration_cast<microseconds>(high_resolution_clock::now() - startTime).count() / 1000.f
+				            > spt_draw_world_collides_ms_per_frame.GetFloat();
+			}
+			chunk.lastDrawn = chunks.drawCount;
+			for (const auto& mesh : chunk.meshes)
+			{
+				mr.DrawMesh(mesh,
+				            [](const CallbackInfoIn& infoIn, CallbackInfoOut& infoOut)
+				            { RenderCallbackZFightFix(infoIn, infoOut); });
+			}
 		}
 	}
 
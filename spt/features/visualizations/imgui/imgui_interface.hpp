@@ -186,6 +186,7 @@ namespace SptImGuiGroup
 	inline Tab Draw_Misc{"Misc.", &Draw};
 	inline Section Draw_Misc_OobEnts{"OOB entities", &Draw_Misc};
 	inline Section Draw_Misc_Seams{"Seamshots", &Draw_Misc};
+	inline Section Draw_Misc_SeamFinder{"Seamshot finder", &Draw_Misc};
 	inline Section Draw_Misc_LeafVis{"Leaf vis", &Draw_Misc};
 
 	// quality of life and/or purely visual stuff
@@ -8,17 +8,43 @@
 #include "spt\utils\game_detection.hpp"
 #include "spt\utils\file.hpp"
 #include "spt\utils\map_utils.hpp"
+#include "spt\utils\bsp_file.hpp"
+#include "spt\utils\thread_pool.hpp"
 #include "imgui\imgui_interface.hpp"
 #include "thirdparty\imgui\imgui_internal.h"
 
-#include "bspfile.h"
-
-#include <stack>
+#include <filesystem>
 #include <mutex>
 
 #define SC_BOX_BRUSH ShapeColor(C_OUTLINE(0, 255, 255, 20))
 #define SC_COMPLEX_BRUSH ShapeColor(C_OUTLINE(255, 0, 255, 20))
 
+// how many maps keep their brushes around after being drawn
+#define MAX_CACHED_MAPS 4
+
+// The solid world brushes of a map, clipped into polyhedra
+struct BspBrushes
+{
+	struct Brush
+	{
+		CPolyhedron* poly;
+		bool isBox;
+	};
+
+	std::filesystem::file_time_type writeTime;
+	uintmax_t fileSize = 0;
+	utils::SptLandmarkList landmarks;
+	std::vector<Brush> brushes;
+
+	BspBrushes() = default;
+	BspBrushes(const BspBrushes&) = delete;
+	~BspBrushes()
+	{
+		for (auto& brush : brushes)
+			brush.poly->Release();
+	}
+};
+
 // Draw the brushes from another map
 class MapOverlay : public FeatureWrapper<MapOverlay>
 {
@@ -43,6 +69,7 @@ protected:
 private:
 	void OnMeshRenderSignal(MeshRendererDelegate& mr);
 	void ImGuiCallback();
+	const BspBrushes* GetBrushes(const std::string& path, const char** err);
 
 	std::vector<StaticMesh> meshes;
 	utils::SptLandmarkList bspLandmarks;
@@ -50,6 +77,8 @@ private:
 	std::string landmarkOffsetCachedFrom;
 	// gotta use a pointer since std::mutex is not moveable
 	std::unique_ptr<std::mutex> mapLoadLock;
+	// most recently drawn last, so that drawing the same map again doesn't have to touch the bsp
+	std::vector<std::pair<std::string, std::unique_ptr<BspBrushes>>> brushCache;
 };
 
 static MapOverlay spt_map_overlay;
@@ -95,101 +124,16 @@ CON_COMMAND_AUTOCOMPLETEFILE(spt_draw_map_overlay, "Draw the brushes from anothe
 	}
 }
 
-bool MapOverlay::LoadMapFile(std::string filename, bool ztest, const char** err)
+// find landmarks in the most jank way possible
+static bool ParseLandmarks(std::span<const char> entLump, utils::SptLandmarkList& out, const char** err)
 {
-	if (filename == lastLoadedFile && ztest == createdWithZTestMaterial && !meshes.empty())
-		return true; // no need to reload
-
-	std::scoped_lock lock{*mapLoadLock};
-
-	landmarkOffsetCachedFrom.clear();
-	bspLandmarks.clear();
-
-#define READ_BYTES(f, buffer, bytes) \
-	{ \
-		f.read((buffer), (bytes)); \
-		if (f.gcount() != (bytes)) \
-		{ \
-			*err = "Unexpected EOF."; \
-			return false; \
-		} \
-	} \
-	while (0)
-
-#define SEEK_TO_BYTE(f, offset) \
-	{ \
-		f.seekg((offset), std::ios::beg); \
-		if (!f) \
-		{ \
-			*err = "Unexpected EOF."; \
-			return false; \
-		} \
-	} \
-	while (0)
-
-	std::ifstream mapFile(GetGameDir() + "\\maps\\" + filename + ".bsp", std::ios::binary);
-	if (!mapFile.is_open())
-	{
-		*err = "Cannot open file.";
-		return false;
-	}
-
-	dheader_t header;
-	READ_BYTES(mapFile, (char*)&header, sizeof(dheader_t));
-	if (header.ident != IDBSPHEADER)
-	{
-		*err = "Not a bsp file.";
-		return false;
-	}
-
-	if (header.version != 20 && header.version != 19
-	    && !(utils::DoesGameLookLikeDMoMM() && (header.version >> 16) != 20))
-	{
-		*err = "Unsupported bsp version.";
-		return false;
-	}
-
-	SEEK_TO_BYTE(mapFile, header.lumps[LUMP_PLANES].fileofs);
-	std::vector<dplane_t> planes(header.lumps[LUMP_PLANES].filelen / sizeof(dplane_t));
-	READ_BYTES(mapFile, (char*)planes.data(), header.lumps[LUMP_PLANES].filelen);
-
-	SEEK_TO_BYTE(mapFile, header.lumps[LUMP_NODES].fileofs);
-	std::vector<dnode_t> nodes(header.lumps[LUMP_NODES].filelen / sizeof(dnode_t));
-	READ_BYTES(mapFile, (char*)nodes.data(), header.lumps[LUMP_NODES].filelen);
-
-	SEEK_TO_BYTE(mapFile, header.lumps[LUMP_LEAFS].fileofs);
-	std::vector<dleaf_version_0_t> leaves_v0;
-	std::vector<dleaf_t> leaves;
-	if (header.version < 20)
-	{
-		leaves_v0.resize(header.lumps[LUMP_LEAFS].filelen / sizeof(dleaf_version_0_t));
-		READ_BYTES(mapFile, (char*)leaves_v0.data(), header.lumps[LUMP_LEAFS].filelen);
-	}
-	else
-	{
-		leaves.resize(header.lumps[LUMP_LEAFS].filelen / sizeof(dleaf_t));
-		READ_BYTES(mapFile, (char*)leaves.data(), header.lumps[LUMP_LEAFS].filelen);
-	}
-
-	SEEK_TO_BYTE(mapFile, header.lumps[LUMP_LEAFBRUSHES].fileofs);
-	std::vector<uint16_t> leafbrushes(header.lumps[LUMP_LEAFBRUSHES].filelen / sizeof(uint16_t));
-	READ_BYTES(mapFile, (char*)leafbrushes.data(), header.lumps[LUMP_LEAFBRUSHES].filelen);
-
-	SEEK_TO_BYTE(mapFile, header.lumps[LUMP_BRUSHES].fileofs);
-	std::vector<dbrush_t> brushes(header.lumps[LUMP_BRUSHES].filelen / sizeof(dbrush_t));
-	READ_BYTES(mapFile, (char*)brushes.data(), header.lumps[LUMP_BRUSHES].filelen);
-
-	SEEK_TO_BYTE(mapFile, header.lumps[LUMP_BRUSHSIDES].fileofs);
-	std::vector<dbrushside_t> brushsides(header.lumps[LUMP_BRUSHSIDES].filelen / sizeof(dbrushside_t));
-	READ_BYTES(mapFile, (char*)brushsides.data(), header.lumps[LUMP_BRUSHSIDES].filelen);
+	// the lump is used with str functions, make sure those don't run off into the rest of the file
+	std::vector<char> ents(entLump.begin(), entLump.end());
+	if (ents.empty() || ents.back() != '\0')
+		ents.push_back('\0');
 
-	SEEK_TO_BYTE(mapFile, header.lumps[LUMP_ENTITIES].fileofs);
-	std::vector<char> ents(header.lumps[LUMP_ENTITIES].filelen);
-	READ_BYTES(mapFile, ents.data(), header.lumps[LUMP_ENTITIES].filelen);
-
-	// find landmarks in the most jank way possible
 	const char* landmarkEntPtr = ents.data();
-	for (; !ents.empty();)
+	for (;;)
 	{
 		// find a landmark entity, but we may land somewhere in the middle of it!
 		landmarkEntPtr = strstr(landmarkEntPtr, "\"classname\" \"info_landmark\"");
@@ -248,78 +192,141 @@ bool MapOverlay::LoadMapFile(std::string filename, bool ztest, const char** err)
 			startSearch = nextNl + 1;
 		} while (!posFound || !nameFound);
 		if (nameFound)
-			bspLandmarks.emplace_back(landmarkName, pos);
+			out.emplace_back(landmarkName, pos);
 
 		landmarkEntPtr = endSearch + 2;
 		if (landmarkEntPtr >= &*--ents.cend())
 			break;
 	}
+	return true;
+}
 
-	// Traverse the tree
-	std::set<uint16_t> mapBrushesIndex;
-	std::stack<uint16_t, std::vector<uint16_t>> s;
-	int curr = 0;
-	while (curr >= 0 || !s.empty())
+/*
+* Clipping the brush planes into polyhedra is by far the slowest part of loading a map, so it's done on the
+* thread pool. The polyhedra are allocated with new instead of the shared temporary memory since that's a
+* single static buffer.
+*/
+static bool LoadBspBrushes(const std::string& path, BspBrushes& out, const char** err)
+{
+	utils::BspFile bsp;
+	std::span<const dplane_t> planes;
+	std::span<const dbrush_t> brushes;
+	std::span<const dbrushside_t> brushsides;
+	std::span<const char> ents;
+	if (!bsp.Open(path, err) || !bsp.GetLump(LUMP_PLANES, planes, err) || !bsp.GetLump(LUMP_BRUSHES, brushes, err)
+	    || !bsp.GetLump(LUMP_BRUSHSIDES, brushsides, err) || !bsp.GetLump(LUMP_ENTITIES, ents, err))
 	{
-		while (curr >= 0)
+		return false;
+	}
+
+	if (!ParseLandmarks(ents, out.landmarks, err))
+		return false;
+
+	std::vector<bool> worldBrush;
+	if (!bsp.GetWorldBrushes(worldBrush, err))
+		return false;
+
+	std::vector<uint32_t> solidBrushes;
+	for (uint32_t i = 0; i < brushes.size(); i++)
+		if (worldBrush[i] && (brushes[i].contents & CONTENTS_SOLID))
+			solidBrushes.push_back(i);
+
+	std::vector<BspBrushes::Brush> clipped(solidBrushes.size());
+	auto clipBrush = [&](size_t i)
+	{
+		const dbrush_t& brush = brushes[solidBrushes[i]];
+		bool isBox = (brush.numsides == 6);
+
+		thread_local std::vector<VPlane> vplanes;
+		vplanes.clear();
+		for (int j = 0; j < brush.numsides; j++)
 		{
-			s.push(curr);
-			curr = nodes[curr].children[0];
+			size_t sideIndex = brush.firstside + j;
+			if (sideIndex >= brushsides.size() || brushsides[sideIndex].planenum >= planes.size())
+				return;
+			const dbrushside_t& brushside = brushsides[sideIndex];
+			if (brushside.bevel)
+				continue;
+			const dplane_t& plane = planes[brushside.planenum];
+			if (isBox && plane.type > 2)
+				isBox = false;
+			vplanes.emplace_back(plane.normal, plane.dist);
 		}
 
-		int leafIndex = -1 - curr;
-		int firstleafbrush =
-		    (header.version < 20) ? leaves_v0[leafIndex].firstleafbrush : leaves[leafIndex].firstleafbrush;
-		int numleafbrushes =
-		    (header.version < 20) ? leaves_v0[leafIndex].numleafbrushes : leaves[leafIndex].numleafbrushes;
-		for (int i = 0; i < numleafbrushes; i++)
+		clipped[i].poly = GeneratePolyhedronFromPlanes((float*)vplanes.data(), vplanes.size(), 0.0001f, false);
+		clipped[i].isBox = isBox;
+	};
+
+	utils::GetThreadPool().ParallelFor(clipped.size(), clipBrush, 16);
+
+	out.brushes.reserve(clipped.size());
+	for (auto& brush : clipped)
+		if (brush.poly)
+			out.brushes.push_back(brush);
+	return true;
+}
+
+const BspBrushes* MapOverlay::GetBrushes(const std::string& path, const char** err)
+{
+	std::error_code ec;
+	auto writeTime = std::filesystem::last_write_time(path, ec);
+	uintmax_t fileSize = ec ? 0 : std::filesystem::file_size(path, ec);
+	if (ec)
+	{
+		*err = "Cannot open file.";
+		return nullptr;
+	}
+
+	auto it = std::ranges::find(brushCache, path, [](auto& pair) -> auto& { return pair.first; });
+	if (it != brushCache.end())
+	{
+		if (it->second->writeTime == writeTime && it->second->fileSize == fileSize)
 		{
-			mapBrushesIndex.insert(leafbrushes[firstleafbrush + i]);
+			std::rotate(it, it + 1, brushCache.end());
+			return brushCache.back().second.get();
 		}
-
-		curr = s.top();
-		s.pop();
-		curr = nodes[curr].children[1];
+		brushCache.erase(it);
 	}
 
+	auto brushes = std::make_unique<BspBrushes>();
+	if (!LoadBspBrushes(path, *brushes, err))
+		return nullptr;
+	brushes->writeTime = writeTime;
+	brushes->fileSize = fileSize;
+
+	if (brushCache.size() >= MAX_CACHED_MAPS)
+		brushCache.erase(brushCache.begin());
+	brushCache.emplace_back(path, std::move(brushes));
+	return brushCache.back().second.get();
+}
+
+bool MapOverlay::LoadMapFile(std::string filename, bool ztest, const char** err)
+{
+	if (filename == lastLoadedFile && ztest == createdWithZTestMaterial && !meshes.empty())
+		return true; // no need to reload
+
+	std::scoped_lock lock{*mapLoadLock};
+
+	landmarkOffsetCachedFrom.clear();
+	bspLandmarks.clear();
+
+	const BspBrushes* bspBrushes = GetBrushes(GetGameDir() + "\\maps\\" + filename + ".bsp", err);
+	if (!bspBrushes)
+		return false;
+	bspLandmarks = bspBrushes->landmarks;
+
 	// Build meshes
 	meshes.clear();
 
 	spt_meshBuilder.CreateMultipleMeshes<StaticMesh>(
 	    std::back_inserter(meshes),
-	    mapBrushesIndex.begin(),
-	    mapBrushesIndex.cend(),
-	    [&](MeshBuilderDelegate& mb, decltype(mapBrushesIndex)::iterator brushIndexIter)
+	    bspBrushes->brushes.cbegin(),
+	    bspBrushes->brushes.cend(),
+	    [&](MeshBuilderDelegate& mb, decltype(bspBrushes->brushes)::const_iterator brushIter)
 	    {
-		    dbrush_t brush = brushes[*brushIndexIter];
-		    bool isBox = (brush.numsides == 6);
-
-		    if ((brush.contents & CONTENTS_SOLID) == 0)
-			    return true;
-
-		    static std::vector<VPlane> vplanes;
-		    vplanes.clear();
-		    for (int i = 0; i < brush.numsides; i++)
-		    {
-			    dbrushside_t brushside = brushsides[brush.firstside + i];
-			    if (brushside.bevel)
-				    continue;
-			    dplane_t plane = planes[brushside.planenum];
-			    if (isBox && plane.type > 2)
-				    isBox = false;
-			    vplanes.emplace_back(plane.normal, plane.dist);
-		    }
-
-		    CPolyhedron* poly =
-		        GeneratePolyhedronFromPlanes((float*)vplanes.data(), vplanes.size(), 0.0001f, true);
-		    if (!poly)
-			    return true;
-
-		    ShapeColor color = isBox ? SC_BOX_BRUSH : SC_COMPLEX_BRUSH;
+		    ShapeColor color = brushIter->isBox ? SC_BOX_BRUSH : SC_COMPLEX_BRUSH;
 		    color.zTestFaces = ztest;
-		    bool ret = mb.AddCPolyhedron(poly, color);
-		    poly->Release();
-		    return ret;
+		    return mb.AddCPolyhedron(brushIter->poly, color);
 	    });
 
 	lastLoadedFile = std::move(filename);
@@ -463,6 +470,7 @@ void MapOverlay::LoadFeature()
 
 void MapOverlay::UnloadFeature()
 {
+	brushCache.clear();
 	mapLoadLock.release();
 }
 
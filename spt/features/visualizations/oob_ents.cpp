@@ -1,6 +1,8 @@
 #include "stdafx.hpp"
 #include "..\feature.hpp"
 
+#include <unordered_map>
+
 #ifndef OE
 
 #define GAME_DLL
@@ -8,6 +10,7 @@
 
 #include "spt\utils\interfaces.hpp"
 #include "spt\utils\signals.hpp"
+#include "spt\utils\ent_list.hpp"
 #include "spt\features\ent_props.hpp"
 #include "spt\features\hud.hpp"
 #include "renderer\mesh_renderer.hpp"
@@ -19,27 +22,65 @@ private:
 	struct EntInfo
 	{
 		CBaseHandle handle;
-		// index into string pool (null terminated)
-		int strIdx;
 		Vector pos; // this is the OBB center, *not* the origin
 		QAngle ang;
 	};
 
-	std::string stringPool;
+	/*
+	* What was found out about the ent in each edict slot the last time it was looked at. Most ents don't
+	* move on most ticks, so the oob check (which is a couple of traces) is only done again if the center
+	* moved. The name is only rebuilt if one of the name strings changed.
+	*/
+	struct TrackedEnt
+	{
+		CBaseHandle handle;
+		Vector pos;
+		bool oob;
+		const char* name;
+		const char* className;
+		const char* globalName;
+		int classId;
+		std::string displayName;
+	};
+
 	std::vector<EntInfo> oobEnts;
 	std::vector<EntInfo> nonOobEnts;
+	std::vector<TrackedEnt> trackedEnts;
+	// class names are pooled strings, so the pointer is enough to tell them apart until the level changes
+	std::unordered_map<const char*, int> classIds;
+	std::vector<bool> ignoredClassIds;
 
 protected:
 	virtual void LoadFeature() override;
 	virtual void UnloadFeature() override
 	{
-		oobEnts.clear();
-		nonOobEnts.clear();
+		ResetTracking();
 	}
 
 private:
 	// collect all ents every tick instead of every frame
 	void OnTickSignal(bool simulating);
+	void OnLevelInit(const char* mapName)
+	{
+		ResetTracking();
+	}
+	// the ent lists point into trackedEnts, so they go too
+	void ResetTracking()
+	{
+		oobEnts.clear();
+		nonOobEnts.clear();
+		trackedEnts.clear();
+		classIds.clear();
+		ignoredClassIds.clear();
+	}
+	int GetClassId(const char* className);
+	const char* GetDisplayName(const EntInfo& info) const
+	{
+		size_t idx = info.handle.GetEntryIndex();
+		if (idx >= trackedEnts.size() || trackedEnts[idx].handle != info.handle)
+			return "<unknown>";
+		return trackedEnts[idx].displayName.c_str();
+	}
 
 public:
 	void PrintEntsCon();
@@ -71,6 +112,8 @@ void HudOobEntsFeature::LoadFeature()
 	if (!TickSignal.Works)
 		return;
 	TickSignal.Connect(this, &HudOobEntsFeature::OnTickSignal);
+	if (LevelInitSignal.Works)
+		LevelInitSignal.Connect(this, &HudOobEntsFeature::OnLevelInit);
 	bool hudEnabled = AddHudCallback(
 	    "hud oob ents", [this](std::string) { PrintEntsHud(); }, spt_hud_oob_ents);
 	if (hudEnabled)
@@ -98,35 +141,11 @@ void HudOobEntsFeature::LoadFeature()
 #endif
 }
 
-void HudOobEntsFeature::OnTickSignal(bool simulating)
+int HudOobEntsFeature::GetClassId(const char* className)
 {
-	if (!simulating)
-		return;
-
-	using namespace utils;
-
-	oobEnts.clear();
-	nonOobEnts.clear();
-	stringPool.clear();
-
-	if (!interfaces::engine_server->PEntityOfEntIndex(0))
-		return;
-
-	// loop through all ents and save them to the appropriate list
-	for (int i = 2; i < MAX_EDICTS; i++)
+	auto [it, inserted] = classIds.try_emplace(className, (int)classIds.size());
+	if (inserted)
 	{
-		edict_t* ed = interfaces::engine_server->PEntityOfEntIndex(i);
-		if (!ed || !ed->GetIServerEntity())
-			continue;
-		CBaseEntity* ent = ed->GetIServerEntity()->GetBaseEntity();
-
-		static CachedField<string_t, "CBaseEntity", "m_iName", true> nf;
-		static CachedField<string_t, "CBaseEntity", "m_iClassname", true> cnf;
-		static CachedField<string_t, "CBaseEntity", "m_iGlobalname", true> gnf;
-		const char* name = nf.GetPtr(ent)->ToCStr();
-		const char* className = cnf.GetPtr(ent)->ToCStr();
-		const char* globalName = gnf.GetPtr(ent)->ToCStr();
-
 		// this list is probably nowhere near complete, should this be a whitelist instead?
 		static const char* const ignoreClasses[] = {
 		    "physicsshadowclone",
@@ -144,45 +163,100 @@ void HudOobEntsFeature::OnTickSignal(bool simulating)
 		    "func_rot_button",
 		    "func_button",
 		};
-		if (std::any_of(ignoreClasses,
-		                ignoreClasses + ARRAYSIZE(ignoreClasses),
-		                [className](const char* cmp) { return !strcmp(className, cmp); }))
-		{
+		ignoredClassIds.push_back(std::any_of(ignoreClasses,
+		                                      ignoreClasses + ARRAYSIZE(ignoreClasses),
+		                                      [className](const char* cmp) { return !strcmp(className, cmp); }));
+	}
+	return it->second;
+}
+
+void HudOobEntsFeature::OnTickSignal(bool simulating)
+{
+	if (!simulating)
+		return;
+
+	using namespace utils;
+
+	oobEnts.clear();
+	nonOobEnts.clear();
+
+	if (!interfaces::engine_server->PEntityOfEntIndex(0))
+		return;
+
+	static CachedField<string_t, "CBaseEntity", "m_iName", true> nf;
+	static CachedField<string_t, "CBaseEntity", "m_iClassname", true> cnf;
+	static CachedField<string_t, "CBaseEntity", "m_iGlobalname", true> gnf;
+	// m_Collision is not in datamap, use field before it
+	static CachedField<CCollisionProperty, "CBaseEntity", "m_hMovePeer", true, sizeof EHANDLE> cf;
+	static CachedField<QAngle, "CBaseEntity", "m_angAbsRotation", true> rotField;
+	static CachedFields fields{nf, cnf, gnf, cf, rotField};
+	if (!fields.HasAll())
+		return;
+
+	if (trackedEnts.empty())
+		trackedEnts.resize(MAX_EDICTS);
+
+	// go through all ents and save them to the appropriate list
+	for (IServerEntity* serverEnt : spt_serverEntList.GetEntList())
+	{
+		const CBaseHandle& handle = serverEnt->GetRefEHandle();
+		if (handle.GetEntryIndex() < 2)
 			continue;
+		CBaseEntity* ent = serverEnt->GetBaseEntity();
+		TrackedEnt& tracked = trackedEnts[handle.GetEntryIndex()];
+		bool newEnt = tracked.handle != handle;
+		if (newEnt)
+		{
+			tracked.handle = handle;
+			tracked.name = tracked.className = tracked.globalName = nullptr;
 		}
 
-		// m_Collision is not in datamap, use field before it
-		static CachedField<CCollisionProperty, "CBaseEntity", "m_hMovePeer", true, sizeof EHANDLE> cf;
-		static CachedField<QAngle, "CBaseEntity", "m_angAbsRotation", true> rotField;
-		const CCollisionProperty* colProp = cf.GetPtr(ent);
+		const char* name = nf.GetPtrUnchecked(ent)->ToCStr();
+		const char* className = cnf.GetPtrUnchecked(ent)->ToCStr();
+		const char* globalName = gnf.GetPtrUnchecked(ent)->ToCStr();
+		assert(className);
+
+		if (className != tracked.className || name != tracked.name || globalName != tracked.globalName)
+		{
+			tracked.classId = GetClassId(className);
+			tracked.name = name;
+			tracked.className = className;
+			tracked.globalName = globalName;
+			// determine a good name for this ent
+			if (name && *name)
+				tracked.displayName = std::format("{} ({})", name, className);
+			else if (globalName && *globalName)
+				tracked.displayName = std::format("{} ({})", globalName, className);
+			else
+				tracked.displayName = className;
+		}
+		if (ignoredClassIds[tracked.classId])
+			continue;
+
+		const CCollisionProperty* colProp = cf.GetPtrUnchecked(ent);
 		// arbitary decision: we don't care about things being oob that aren't solid according to this function
 		if (!colProp->IsSolid())
 			continue;
 		Vector pos = colProp->WorldSpaceCenter();
-		const QAngle* ang = rotField.GetPtr(ent);
-		// check if ent is oob
-		bool oob = interfaces::engineTraceServer->PointOutsideWorld(pos);
-		if (oob)
+		const QAngle* ang = rotField.GetPtrUnchecked(ent);
+		// the world doesn't change, so only ents that moved can have become oob (or stopped being oob)
+		if (newEnt || pos != tracked.pos)
 		{
-			trace_t tr;
-			Ray_t ray;
-			ray.Init(pos, pos + Vector{1, 1, 1});
-			// arbtirarily chosen filter for world only & no ents or static props, same mask as hud_oob
-			CTraceFilterWorldOnly filter{};
-			interfaces::engineTraceServer->TraceRay(ray, MASK_PLAYERSOLID_BRUSHONLY, &filter, &tr);
-			oob = !tr.startsolid;
+			tracked.pos = pos;
+			tracked.oob = interfaces::engineTraceServer->PointOutsideWorld(pos);
+			if (tracked.oob)
+			{
+				trace_t tr;
+				Ray_t ray;
+				ray.Init(pos, pos + Vector{1, 1, 1});
+				// arbtirarily chosen filter for world only & no ents or static props, same mask as hud_oob
+				CTraceFilterWorldOnly filter{};
+				interfaces::engineTraceServer->TraceRay(ray, MASK_PLAYERSOLID_BRUSHONLY, &filter, &tr);
+				tracked.oob = !tr.startsolid;
+			}
 		}
-		auto& vec = oob ? oobEnts : nonOobEnts;
-		vec.emplace_back(ent->GetRefEHandle(), stringPool.size(), pos, *ang);
-		// determine a good name for this ent
-		assert(className);
-		if (name && *name)
-			stringPool += std::format("{} ({})", name, className);
-		else if (globalName && *globalName)
-			stringPool += std::format("{} ({})", globalName, className);
-		else
-			stringPool += className;
-		stringPool += '\0';
+		auto& vec = tracked.oob ? oobEnts : nonOobEnts;
+		vec.emplace_back(handle, pos, *ang);
 	}
 }
 
@@ -199,7 +273,7 @@ void HudOobEntsFeature::PrintEntsCon()
 	for (const EntInfo& ent : oobEnts)
 	{
 		Msg("%-45s, index: %04d, pos: <%7.3f, %7.3f, %7.3f>\n",
-		    stringPool.data() + ent.strIdx,
+		    GetDisplayName(ent),
 		    ent.handle.GetEntryIndex(),
 		    ent.pos.x,
 		    ent.pos.y,
@@ -224,7 +298,7 @@ void HudOobEntsFeature::PrintEntsHud()
 	{
 		spt_hud_feat.DrawColorTopHudElement(Color{255, 200, 200, 255},
 		                                    L"%S",
-		                                    stringPool.data() + oobEnts[i].strIdx);
+		                                    GetDisplayName(oobEnts[i]));
 	}
 	if (oobEnts.size() > MAX_HUD_OOB_ENTS)
 		spt_hud_feat.DrawTopHudElement(L"%lu remaining...", oobEnts.size() - MAX_HUD_OOB_ENTS);
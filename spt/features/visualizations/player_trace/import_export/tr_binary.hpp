@@ -19,6 +19,7 @@ namespace player_trace
 
 		virtual bool Write(std::span<const std::byte> sp) = 0;
 		virtual bool DoneWritingTrace() = 0; // notify writer to flush
+		virtual ~ITrWriter() = default;
 	};
 
 	class ITrReader
@@ -32,6 +33,7 @@ namespace player_trace
 
 		// reading may not be in sequential chunks
 		virtual bool ReadTo(std::span<std::byte> sp, uint32_t at) = 0;
+		virtual ~ITrReader() = default;
 	};
 
 	class TrRestore
@@ -49,6 +51,9 @@ namespace player_trace
 	class TrWrite
 	{
 	public:
+		// transpose & delta encode lumps before writing, makes compressed files a lot smaller
+		bool encodeColumns = true;
+
 		bool Write(const TrPlayerTrace& tr, ITrWriter& wr);
 	};
 
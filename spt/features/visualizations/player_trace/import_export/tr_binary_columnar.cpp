@@ -0,0 +1,148 @@
+#include "stdafx.hpp"
+
+#include <bit>
+
+#include "tr_binary_internal.hpp"
+
+#ifdef SPT_PLAYER_TRACE_ENABLED
+
+using namespace player_trace;
+
+enum TrColumnMode : uint8_t
+{
+	TR_CM_RAW,
+	TR_CM_DELTA,
+	TR_CM_XOR,
+};
+
+static inline uint32_t TrVarintLen(uint32_t v)
+{
+	return (std::bit_width(v | 1) + 6) / 7;
+}
+
+static inline uint32_t TrZigzag(uint32_t v)
+{
+	return (v << 1) ^ (uint32_t)((int32_t)v >> 31);
+}
+
+static inline uint32_t TrUnzigzag(uint32_t v)
+{
+	return (v >> 1) ^ (0u - (v & 1));
+}
+
+static inline uint32_t TrReadWord(const std::byte* p)
+{
+	uint32_t w;
+	memcpy(&w, p, sizeof w);
+	return w;
+}
+
+bool player_trace::TrEncodeColumns(std::span<const std::byte> data, uint32_t nElems, std::vector<std::byte>& out)
+{
+	out.clear();
+	if (nElems == 0 || data.size() % nElems != 0)
+		return false;
+	uint32_t elemSize = data.size() / nElems;
+	if (elemSize % 4 != 0)
+		return false;
+
+	out.reserve(data.size());
+	for (uint32_t col = 0; col < elemSize / 4; col++)
+	{
+		const std::byte* colData = data.data() + col * 4;
+
+		// figure out which mode is the smallest for this column
+		size_t deltaLen = 0, xorLen = 0;
+		uint32_t prev = 0;
+		for (uint32_t i = 0; i < nElems; i++)
+		{
+			uint32_t w = TrReadWord(colData + i * elemSize);
+			deltaLen += TrVarintLen(TrZigzag(w - prev));
+			xorLen += TrVarintLen(w ^ prev);
+			prev = w;
+		}
+		size_t rawLen = nElems * 4;
+
+		TrColumnMode mode = TR_CM_RAW;
+		if (deltaLen < rawLen && deltaLen <= xorLen)
+			mode = TR_CM_DELTA;
+		else if (xorLen < rawLen)
+			mode = TR_CM_XOR;
+
+		out.push_back((std::byte)mode);
+		prev = 0;
+		for (uint32_t i = 0; i < nElems; i++)
+		{
+			uint32_t w = TrReadWord(colData + i * elemSize);
+			if (mode == TR_CM_RAW)
+			{
+				auto wBytes = std::as_bytes(std::span{&w, 1});
+				out.insert(out.end(), wBytes.begin(), wBytes.end());
+				continue;
+			}
+			uint32_t v = mode == TR_CM_DELTA ? TrZigzag(w - prev) : w ^ prev;
+			prev = w;
+			while (v >= 0x80)
+			{
+				out.push_back((std::byte)(v | 0x80));
+				v >>= 7;
+			}
+			out.push_back((std::byte)v);
+		}
+	}
+	return out.size() < data.size();
+}
+
+bool player_trace::TrDecodeColumns(std::span<const std::byte> in, uint32_t nElems, std::span<std::byte> out)
+{
+	if (nElems == 0 || out.size() % nElems != 0)
+		return false;
+	uint32_t elemSize = out.size() / nElems;
+	if (elemSize % 4 != 0)
+		return false;
+
+	size_t pos = 0;
+	for (uint32_t col = 0; col < elemSize / 4; col++)
+	{
+		std::byte* colData = out.data() + col * 4;
+		if (pos >= in.size())
+			return false;
+		auto mode = (TrColumnMode)in[pos++];
+
+		switch (mode)
+		{
+		case TR_CM_RAW:
+			if (in.size() - pos < nElems * 4)
+				return false;
+			for (uint32_t i = 0; i < nElems; i++, pos += 4)
+				memcpy(colData + i * elemSize, in.data() + pos, 4);
+			break;
+		case TR_CM_DELTA:
+		case TR_CM_XOR:
+		{
+			uint32_t prev = 0;
+			for (uint32_t i = 0; i < nElems; i++)
+			{
+				uint32_t v = 0;
+				for (uint32_t shift = 0;; shift += 7)
+				{
+					if (pos >= in.size() || shift > 28)
+						return false;
+					uint32_t b = (uint32_t)in[pos++];
+					v |= (b & 0x7f) << shift;
+					if (!(b & 0x80))
+						break;
+				}
+				prev = mode == TR_CM_DELTA ? prev + TrUnzigzag(v) : prev ^ v;
+				memcpy(colData + i * elemSize, &prev, 4);
+			}
+			break;
+		}
+		default:
+			return false;
+		}
+	}
+	return pos == in.size();
+}
+
+#endif
@@ -1,6 +1,7 @@
 #include "stdafx.hpp"
 
 #include "tr_binary_compress.hpp"
+#include "spt/utils/thread_pool.hpp"
 
 #ifdef SPT_PLAYER_TRACE_ENABLED
 
@@ -9,6 +10,9 @@ using namespace player_trace;
 constexpr char TR_XZ_FILE_ID[] = "omg_hi!";
 constexpr uint32_t TR_XZ_FILE_VERSION = 1;
 
+constexpr char TR_BLOCK_FILE_ID[] = "chunky!";
+constexpr uint32_t TR_BLOCK_FILE_VERSION = 1;
+
 struct TrXzFooter
 {
 	uint32_t numCompressedBytes;
@@ -17,6 +21,16 @@ struct TrXzFooter
 	uint32_t version;
 };
 
+struct TrBlockFooter
+{
+	uint32_t blocksOff;
+	uint32_t nBlocks;
+	uint32_t blockSize;
+	uint32_t numUncompressedBytes;
+	char id[sizeof TR_BLOCK_FILE_ID];
+	uint32_t version;
+};
+
 TrXzFileWriter::TrXzFileWriter(std::ostream& oStream, uint32_t compressionLevel)
     : oStream{oStream}, lzma_strm{lzma_stream LZMA_STREAM_INIT}, alive{true}
 {
@@ -163,4 +177,298 @@ bool TrXzFileReader::ReadTo(std::span<std::byte> sp, uint32_t at)
 	return false;
 }
 
+TrBlockFileWriter::TrBlockFileWriter(std::ostream& oStream, bool compress, uint32_t compressionLevel)
+    : oStream{oStream}
+    , compressionLevel{compressionLevel}
+    , compress{compress}
+    , alive{true}
+    , fileOff{0}
+    , numUncompressedBytes{0}
+{
+	curBlock.reserve(TR_BLOCK_SIZE);
+}
+
+bool TrBlockFileWriter::Write(std::span<const std::byte> sp)
+{
+	while (alive && !sp.empty())
+	{
+		size_t n = MIN(sp.size(), TR_BLOCK_SIZE - curBlock.size());
+		curBlock.insert(curBlock.end(), sp.begin(), sp.begin() + n);
+		sp = sp.subspan(n);
+		numUncompressedBytes += n;
+		if (curBlock.size() == TR_BLOCK_SIZE)
+		{
+			pendingBlocks.push_back(std::move(curBlock));
+			curBlock = {};
+			curBlock.reserve(TR_BLOCK_SIZE);
+			// keep enough blocks around so that every thread has something to compress
+			if (pendingBlocks.size() >= utils::GetThreadPool().GetThreadCount() * 2 + 2)
+				alive = FlushBlocks();
+		}
+	}
+	return alive;
+}
+
+bool TrBlockFileWriter::DoneWritingTrace()
+{
+	if (alive && !curBlock.empty())
+	{
+		pendingBlocks.push_back(std::move(curBlock));
+		curBlock = {};
+	}
+	if (alive)
+		alive = FlushBlocks();
+	if (alive)
+	{
+		TrBlockFooter footer{
+		    .blocksOff = fileOff,
+		    .nBlocks = blocks.size(),
+		    .blockSize = TR_BLOCK_SIZE,
+		    .numUncompressedBytes = numUncompressedBytes,
+		    .version = TR_BLOCK_FILE_VERSION,
+		};
+		memcpy(footer.id, TR_BLOCK_FILE_ID, sizeof footer.id);
+		alive = oStream.write((char*)blocks.data(), blocks.size() * sizeof(TrBlockEntry))
+		            .write((char*)&footer, sizeof footer)
+		            .flush()
+		            .good();
+	}
+	return alive;
+}
+
+bool TrBlockFileWriter::FlushBlocks()
+{
+	std::vector<std::vector<uint8_t>> outBufs(pendingBlocks.size());
+	if (compress)
+	{
+		std::atomic_bool ok = true;
+		utils::GetThreadPool().ParallelFor(pendingBlocks.size(),
+		                                   [&](size_t i)
+		                                   {
+			                                   auto& in = pendingBlocks[i];
+			                                   auto& out = outBufs[i];
+			                                   out.resize(lzma_stream_buffer_bound(in.size()));
+			                                   size_t outPos = 0;
+			                                   lzma_ret ret = lzma_easy_buffer_encode(compressionLevel,
+			                                                                          LZMA_CHECK_CRC32,
+			                                                                          nullptr,
+			                                                                          (uint8_t*)in.data(),
+			                                                                          in.size(),
+			                                                                          out.data(),
+			                                                                          &outPos,
+			                                                                          out.size());
+			                                   if (ret != LZMA_OK)
+				                                   ok = false;
+			                                   out.resize(outPos);
+		                                   });
+		if (!ok)
+			return false;
+	}
+
+	for (size_t i = 0; i < pendingBlocks.size(); i++)
+	{
+		auto& in = pendingBlocks[i];
+		auto& out = outBufs[i];
+		TrBlockEntry entry{
+		    .dataOff = fileOff,
+		    .numUncompressedBytes = in.size(),
+		    .compressed = compress && out.size() < in.size(),
+		};
+		auto data = entry.compressed ? std::as_bytes(std::span{out}) : std::span<const std::byte>{in};
+		entry.dataLenBytes = data.size();
+		if (!oStream.write((char*)data.data(), data.size()).good())
+			return false;
+		fileOff += entry.dataLenBytes;
+		blocks.push_back(entry);
+	}
+	pendingBlocks.clear();
+	return true;
+}
+
+TrBlockFileReader::TrBlockFileReader(const std::filesystem::path& path)
+    : file{INVALID_HANDLE_VALUE}
+    , mapping{NULL}
+    , view{nullptr}
+    , viewSize{0}
+    , blockSize{0}
+    , numUncompressedBytes{0}
+    , nextCacheSlot{0}
+{
+	file = CreateFileW(path.c_str(),
+	                   GENERIC_READ,
+	                   FILE_SHARE_READ,
+	                   NULL,
+	                   OPEN_EXISTING,
+	                   FILE_ATTRIBUTE_NORMAL | FILE_FLAG_RANDOM_ACCESS,
+	                   NULL);
+	if (file == INVALID_HANDLE_VALUE)
+	{
+		errMsg = std::format("failed to open file (error {})", GetLastError());
+		return;
+	}
+	LARGE_INTEGER fileSize;
+	if (!GetFileSizeEx(file, &fileSize) || fileSize.QuadPart < (LONGLONG)sizeof(TrBlockFooter)
+	    || fileSize.QuadPart > UINT32_MAX)
+	{
+		errMsg = "bad file size";
+		return;
+	}
+	// the file is mapped instead of read, so only the blocks that are used get paged in
+	mapping = CreateFileMappingW(file, NULL, PAGE_READONLY, 0, 0, NULL);
+	if (mapping)
+		view = (const std::byte*)MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+	if (!view)
+	{
+		errMsg = std::format("failed to map file (error {})", GetLastError());
+		return;
+	}
+	viewSize = (size_t)fileSize.QuadPart;
+
+	TrBlockFooter footer;
+	memcpy(&footer, view + viewSize - sizeof footer, sizeof footer);
+	if (memcmp(footer.id, TR_BLOCK_FILE_ID, sizeof footer.id) || footer.version != TR_BLOCK_FILE_VERSION)
+	{
+		errMsg = "invalid footer";
+		return;
+	}
+	uint64_t blocksEnd = (uint64_t)footer.blocksOff + (uint64_t)footer.nBlocks * sizeof(TrBlockEntry);
+	if (footer.blockSize == 0 || blocksEnd > viewSize - sizeof footer)
+	{
+		errMsg = "invalid block index";
+		return;
+	}
+	blocks.resize(footer.nBlocks);
+	memcpy(blocks.data(), view + footer.blocksOff, blocks.size() * sizeof(TrBlockEntry));
+
+	// validate the index once so that ReadTo doesn't have to
+	uint64_t totalUncompressed = 0;
+	for (uint32_t i = 0; i < blocks.size(); i++)
+	{
+		auto& block = blocks[i];
+		bool isLast = i + 1 == blocks.size();
+		if ((uint64_t)block.dataOff + block.dataLenBytes > footer.blocksOff
+		    || block.numUncompressedBytes > footer.blockSize
+		    || (!isLast && block.numUncompressedBytes != footer.blockSize)
+		    || (!block.compressed && block.dataLenBytes != block.numUncompressedBytes))
+		{
+			errMsg = std::format("invalid entry for block {}", i);
+			blocks.clear();
+			return;
+		}
+		totalUncompressed += block.numUncompressedBytes;
+	}
+	if (totalUncompressed != footer.numUncompressedBytes)
+	{
+		errMsg = "block sizes don't add up";
+		blocks.clear();
+		return;
+	}
+
+	blockSize = footer.blockSize;
+	numUncompressedBytes = footer.numUncompressedBytes;
+}
+
+TrBlockFileReader::~TrBlockFileReader()
+{
+	if (view)
+		UnmapViewOfFile(view);
+	if (mapping)
+		CloseHandle(mapping);
+	if (file != INVALID_HANDLE_VALUE)
+		CloseHandle(file);
+}
+
+bool TrBlockFileReader::DecompressBlock(uint32_t blockIdx, std::span<std::byte> out) const
+{
+	auto& block = blocks[blockIdx];
+	Assert(out.size() == block.numUncompressedBytes);
+	if (!block.compressed)
+	{
+		memcpy(out.data(), view + block.dataOff, out.size());
+		return true;
+	}
+	uint64_t memLimit = UINT64_MAX;
+	size_t inPos = 0, outPos = 0;
+	lzma_ret ret = lzma_stream_buffer_decode(&memLimit,
+	                                         0,
+	                                         nullptr,
+	                                         (const uint8_t*)view + block.dataOff,
+	                                         &inPos,
+	                                         block.dataLenBytes,
+	                                         (uint8_t*)out.data(),
+	                                         &outPos,
+	                                         out.size());
+	return ret == LZMA_OK && outPos == out.size();
+}
+
+const std::byte* TrBlockFileReader::GetCachedBlock(uint32_t blockIdx)
+{
+	for (auto& cached : cache)
+		if (cached.blockIdx == blockIdx)
+			return cached.data.data();
+
+	auto& slot = cache[nextCacheSlot];
+	nextCacheSlot = (nextCacheSlot + 1) % cache.size();
+	slot.data.resize(blocks[blockIdx].numUncompressedBytes);
+	if (!DecompressBlock(blockIdx, std::span{slot.data}))
+	{
+		slot.blockIdx = UINT32_MAX;
+		return nullptr;
+	}
+	slot.blockIdx = blockIdx;
+	return slot.data.data();
+}
+
+bool TrBlockFileReader::ReadTo(std::span<std::byte> sp, uint32_t at)
+{
+	if ((uint64_t)at + sp.size() > numUncompressedBytes)
+		return false;
+
+	// whole compressed blocks are decompressed straight into the destination, in parallel
+	struct WholeBlock
+	{
+		uint32_t blockIdx;
+		std::span<std::byte> out;
+	};
+	std::vector<WholeBlock> wholeBlocks;
+
+	while (!sp.empty())
+	{
+		uint32_t blockIdx = at / blockSize;
+		uint32_t blockOff = at % blockSize;
+		auto& block = blocks[blockIdx];
+		size_t n = MIN(sp.size(), block.numUncompressedBytes - blockOff);
+
+		if (!block.compressed)
+		{
+			memcpy(sp.data(), view + block.dataOff + blockOff, n);
+		}
+		else if (blockOff == 0 && n == block.numUncompressedBytes)
+		{
+			wholeBlocks.push_back({blockIdx, sp.first(n)});
+		}
+		else
+		{
+			const std::byte* data = GetCachedBlock(blockIdx);
+			if (!data)
+				return false;
+			memcpy(sp.data(), data + blockOff, n);
+		}
+		sp = sp.subspan(n);
+		at += n;
+	}
+
+	if (wholeBlocks.size() == 1)
+		return DecompressBlock(wholeBlocks[0].blockIdx, wholeBlocks[0].out);
+
+	std::atomic_bool ok = true;
+	utils::GetThreadPool().ParallelFor(wholeBlocks.size(),
+	                                   [&](size_t i)
+	                                   {
+		                                   if (!DecompressBlock(wholeBlocks[i].blockIdx, wholeBlocks[i].out))
+			                                   ok = false;
+	                                   });
+	return ok;
+}
+
 #endif
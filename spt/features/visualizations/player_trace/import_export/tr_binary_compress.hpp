@@ -1,5 +1,8 @@
 #pragma once
 
+#include <array>
+#include <filesystem>
+
 #include "tr_binary.hpp"
 
 #ifdef SPT_PLAYER_TRACE_ENABLED
@@ -8,6 +11,7 @@
 #include "thirdparty/xz/include/lzma.h"
 
 #define TR_COMPRESSED_FILE_EXT ".sptr.xz"
+#define TR_BLOCK_FILE_EXT ".sptr"
 
 namespace player_trace
 {
@@ -48,6 +52,79 @@ namespace player_trace
 
 		virtual bool ReadTo(std::span<std::byte> sp, uint32_t at);
 	};
+
+	constexpr uint32_t TR_BLOCK_SIZE = 1 << 18;
+
+	struct TrBlockEntry
+	{
+		uint32_t dataOff;
+		uint32_t dataLenBytes;
+		uint32_t numUncompressedBytes;
+		// blocks that don't compress well are stored as-is
+		uint32_t compressed;
+	};
+
+	/*
+	* Splits the trace into fixed size blocks which are compressed independently, followed by a
+	* block index. Since every block can be decoded on its own, the reader only has to decompress
+	* the blocks it reads from. With compression off the blocks are stored as-is and the reader
+	* maps the file instead of loading it.
+	*/
+	class TrBlockFileWriter : public ITrWriter
+	{
+		std::ostream& oStream;
+		uint32_t compressionLevel;
+		bool compress;
+		bool alive;
+		uint32_t fileOff;
+		uint32_t numUncompressedBytes;
+		std::vector<std::byte> curBlock;
+		// full blocks waiting to be compressed, these are done in parallel
+		std::vector<std::vector<std::byte>> pendingBlocks;
+		std::vector<TrBlockEntry> blocks;
+
+	public:
+		TrBlockFileWriter(std::ostream& oStream, bool compress = true, uint32_t compressionLevel = 1);
+
+		virtual bool Write(std::span<const std::byte> sp);
+		virtual bool DoneWritingTrace();
+
+	private:
+		bool FlushBlocks();
+	};
+
+	class TrBlockFileReader : public ITrReader
+	{
+		HANDLE file;
+		HANDLE mapping;
+		const std::byte* view;
+		size_t viewSize;
+		uint32_t blockSize;
+		uint32_t numUncompressedBytes;
+		std::vector<TrBlockEntry> blocks;
+
+		// the last few decompressed blocks, for reads that don't cover a whole block
+		struct CachedBlock
+		{
+			uint32_t blockIdx = UINT32_MAX;
+			std::vector<std::byte> data;
+		};
+		std::array<CachedBlock, 4> cache;
+		uint32_t nextCacheSlot;
+
+	public:
+		// same as TrXzFileReader::errMsg
+		std::string errMsg;
+
+		TrBlockFileReader(const std::filesystem::path& path);
+		~TrBlockFileReader();
+
+		virtual bool ReadTo(std::span<std::byte> sp, uint32_t at);
+
+	private:
+		bool DecompressBlock(uint32_t blockIdx, std::span<std::byte> out) const;
+		const std::byte* GetCachedBlock(uint32_t blockIdx);
+	};
 } // namespace player_trace
 
 #endif
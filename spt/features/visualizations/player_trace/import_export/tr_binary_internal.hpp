@@ -7,7 +7,7 @@
 namespace player_trace
 {
 	constexpr char TR_FILE_ID[8] = "sausage";
-	constexpr uint32_t TR_SERIALIZE_VERSION = 2;
+	constexpr uint32_t TR_SERIALIZE_VERSION = 3;
 	constexpr size_t TR_MAX_SPT_VERSION_LEN = 32;
 
 	struct TrPreamble
@@ -49,7 +49,44 @@ namespace player_trace
 		tr_struct_version firstExportVersion;
 	};
 
-	using TrLump = struct TrLump_v2;
+	enum TrLumpEncoding : uint32_t
+	{
+		// the lump data is the vector as is
+		TR_LE_RAW,
+		// see TrEncodeColumns
+		TR_LE_COLUMNAR,
+	};
+
+	struct TrLump_v3 : TrLump_v2
+	{
+		TrLump_v3() {};
+
+		TrLump_v3(const TrLump_v2& v2) : encoding{TR_LE_RAW}, encodedLenBytes{v2.dataLenBytes}
+		{
+			memcpy(this, &v2, sizeof v2);
+		}
+
+		TrLumpEncoding encoding;
+		// the number of bytes at dataOff, dataLenBytes is the size after decoding
+		uint32_t encodedLenBytes;
+	};
+
+	using TrLump = struct TrLump_v3;
+
+	/*
+	* Slowly changing values compress poorly when they're stored as an array of structs, so lumps
+	* are (optionally) transposed into columns of 4 byte words before they're given to the writer.
+	* Each column is then stored as one of:
+	* 
+	* - raw words
+	* - zigzag varints of the difference to the previous word (ticks, indices)
+	* - varints of the XOR with the previous word (floats that only change in the low bits)
+	* 
+	* whichever is smallest. Lumps with an element size that isn't a multiple of 4 aren't encoded.
+	* Returns false if the lump can't be encoded or if encoding doesn't make it any smaller.
+	*/
+	bool TrEncodeColumns(std::span<const std::byte> data, uint32_t nElems, std::vector<std::byte>& out);
+	bool TrDecodeColumns(std::span<const std::byte> in, uint32_t nElems, std::span<std::byte> out);
 
 	struct TrRestoreInternal;
 
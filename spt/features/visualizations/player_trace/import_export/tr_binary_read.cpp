@@ -8,6 +8,31 @@
 
 using namespace player_trace;
 
+// reads the (decoded) lump data, out must be dataLenBytes long
+static bool TrReadLumpBytes(TrRestoreInternal& internal, const TrLump& lump, std::span<std::byte> out)
+{
+	switch (lump.encoding)
+	{
+	case TR_LE_RAW:
+		return internal.reader.ReadTo(out, lump.dataOff);
+	case TR_LE_COLUMNAR:
+	{
+		std::vector<std::byte> encoded(lump.encodedLenBytes);
+		if (!internal.reader.ReadTo(std::span{encoded}, lump.dataOff))
+			return false;
+		if (!TrDecodeColumns(encoded, lump.nElems, out))
+		{
+			internal.restore.errMsg = std::format("failed to decode lump '{}'", lump.name);
+			return false;
+		}
+		return true;
+	}
+	default:
+		internal.restore.errMsg = std::format("unknown encoding {} for lump '{}'", (uint32_t)lump.encoding, lump.name);
+		return false;
+	}
+}
+
 /*
 * Broken up into 2 cases:
 * 1) There are no upgrade handlers. Read data straight into the trace vector.
@@ -18,7 +43,6 @@ template<typename T>
 static bool TrReadLumpData(TrRestoreInternal& internal, TrTopologicalNode& node)
 {
 	auto& tr = internal.trace;
-	auto& rd = internal.reader;
 	auto& restore = internal.restore;
 	auto& lump = node.lump;
 
@@ -37,7 +61,7 @@ static bool TrReadLumpData(TrRestoreInternal& internal, TrTopologicalNode& node)
 		                TR_LUMP_VERSION(T)));
 
 		upgradeBuf.resize(lump.dataLenBytes);
-		if (!rd.ReadTo(std::span{upgradeBuf}, lump.dataOff))
+		if (!TrReadLumpBytes(internal, lump, std::span{upgradeBuf}))
 			return false;
 
 		for (auto handler : node.handlers)
@@ -107,7 +131,7 @@ static bool TrReadLumpData(TrRestoreInternal& internal, TrTopologicalNode& node)
 	else
 	{
 		vec.resize(lump.nElems);
-		if (!rd.ReadTo(std::as_writable_bytes(std::span{vec}), lump.dataOff))
+		if (!TrReadLumpBytes(internal, lump, std::as_writable_bytes(std::span{vec})))
 			return false;
 	}
 	return true;
@@ -247,7 +271,19 @@ bool TrRestore::Restore(TrPlayerTrace& tr, ITrReader& rd)
 			errMsg = "failed to read lump headers";
 			return false;
 		}
-		lumps.assign(v1Lumps.cbegin(), v1Lumps.cend());
+		for (size_t i = 0; i < lumps.size(); i++)
+			lumps[i] = TrLump_v2{v1Lumps[i]};
+		break;
+	}
+	case 2:
+	{
+		std::vector<TrLump_v2> v2Lumps(header.nLumps);
+		if (!rd.ReadTo(std::as_writable_bytes(std::span{v2Lumps}), header.lumpsOff))
+		{
+			errMsg = "failed to read lump headers";
+			return false;
+		}
+		lumps.assign(v2Lumps.cbegin(), v2Lumps.cend());
 		break;
 	}
 	default:
@@ -1,40 +1,33 @@
 #include "stdafx.hpp"
 
 #include "tr_binary_internal.hpp"
+#include "spt/utils/thread_pool.hpp"
 
 #ifdef SPT_PLAYER_TRACE_ENABLED
 
 using namespace player_trace;
 
+struct TrLumpOut
+{
+	TrLump lump;
+	std::span<const std::byte> data;
+	std::vector<std::byte> encoded;
+};
+
 template<typename T>
-bool WriteLumpHeader(ITrWriter& wr,
-                     const TrPlayerTrace& trace,
-                     const std::vector<T>& vec,
-                     uint32_t& fileOff,
-                     uint32_t& lumpDataFileOff)
+static void AddLump(std::vector<TrLumpOut>& lumps, const TrPlayerTrace& trace, const std::vector<T>& vec)
 {
-	TrLump lump{};
+	TrLumpOut& out = lumps.emplace_back();
+	TrLump& lump = out.lump;
+	memset(&lump, 0, sizeof lump);
 	strncpy(lump.name, TR_LUMP_NAME(T), sizeof lump.name);
 	lump.structVersion = TR_LUMP_VERSION(T);
-	lump.dataOff = lumpDataFileOff;
 	lump.dataLenBytes = vec.size() * sizeof(T);
 	lump.nElems = vec.size();
 	lump.firstExportVersion = trace.GetFirstExportVersion<T>();
-
-	if (!wr.Write(lump))
-		return false;
-	fileOff += sizeof lump;
-	lumpDataFileOff += lump.dataLenBytes;
-	return true;
-}
-
-template<typename T>
-bool WriteLumpData(ITrWriter& wr, const std::vector<T>& vec, uint32_t& fileOff)
-{
-	if (!wr.Write(std::as_bytes(std::span{vec})))
-		return false;
-	fileOff += vec.size() * sizeof(T);
-	return true;
+	lump.encoding = TR_LE_RAW;
+	lump.encodedLenBytes = lump.dataLenBytes;
+	out.data = std::as_bytes(std::span{vec});
 }
 
 bool TrWrite::Write(const TrPlayerTrace& tr, ITrWriter& wr)
@@ -52,6 +45,26 @@ bool TrWrite::Write(const TrPlayerTrace& tr, ITrWriter& wr)
 
 	constexpr uint32_t nLumps = std::tuple_size_v<decltype(tr._storage)>;
 
+	std::vector<TrLumpOut> lumps;
+	lumps.reserve(nLumps);
+	std::apply([&](auto&... vecs) { (AddLump(lumps, tr, vecs), ...); }, tr._storage);
+
+	// the encoded size is needed for the lump headers, so encode everything up front
+	if (encodeColumns)
+	{
+		utils::GetThreadPool().ParallelFor(nLumps,
+		                                   [&lumps](size_t i)
+		                                   {
+			                                   TrLumpOut& out = lumps[i];
+			                                   if (TrEncodeColumns(out.data, out.lump.nElems, out.encoded))
+			                                   {
+				                                   out.lump.encoding = TR_LE_COLUMNAR;
+				                                   out.lump.encodedLenBytes = out.encoded.size();
+				                                   out.data = out.encoded;
+			                                   }
+		                                   });
+	}
+
 	TrHeader header{
 	    .lumpsOff = fileOff + sizeof header,
 	    .nLumps = nLumps,
@@ -65,14 +78,21 @@ bool TrWrite::Write(const TrPlayerTrace& tr, ITrWriter& wr)
 	fileOff += sizeof header;
 
 	uint32_t lumpDataFileOff = fileOff + sizeof(TrLump) * nLumps;
-	if (!std::apply([&](auto&... vecs) { return (WriteLumpHeader(wr, tr, vecs, fileOff, lumpDataFileOff) && ...); },
-	                tr._storage))
+	for (auto& out : lumps)
 	{
-		return false;
+		out.lump.dataOff = lumpDataFileOff;
+		lumpDataFileOff += out.lump.encodedLenBytes;
+		if (!wr.Write(out.lump))
+			return false;
+		fileOff += sizeof out.lump;
 	}
 
-	if (!std::apply([&](auto&... vecs) { return (WriteLumpData(wr, vecs, fileOff) && ...); }, tr._storage))
-		return false;
+	for (auto& out : lumps)
+	{
+		if (!wr.Write(out.data))
+			return false;
+		fileOff += out.data.size();
+	}
 
 	return wr.DoneWritingTrace();
 }
@@ -402,14 +402,10 @@ void TrPlayerTrace::CollectEntities(float entCollectRadius)
 				             | (physObj->IsGravityEnabled() ? TR_POF_GRAVITY_ENABLED : 0),
 				};
 
-				auto [it, new_elem] = rc.entMeshMap.try_emplace(newPhysInfo, TrIdx<TrPhysMesh>{});
+				auto [infoIdx, new_elem] = rc.entMeshInfoSet.FindOrAdd(tr.Get<TrPhysicsObjectInfo>(), newPhysInfo);
 
 				if (new_elem)
 				{
-					// set the pointer just like how the recording cache does
-					it->first.idx = tr.Get<TrPhysicsObjectInfo>().size();
-					tr.Get<TrPhysicsObjectInfo>().push_back(newPhysInfo);
-
 					TrPhysMesh newTrMesh{
 					    .ballRadius = physObj->GetSphereRadius(),
 					    .vertIdxSp{},
@@ -427,13 +423,14 @@ void TrPlayerTrace::CollectEntities(float entCollectRadius)
 						newTrMesh.vertIdxSp = rc.GetCachedSpan(ptIdxVec);
 					}
 
-					it->second = rc.GetCachedIdx(newTrMesh);
+					Assert(rc.entMeshes.size() == infoIdx);
+					rc.entMeshes.push_back(rc.GetCachedIdx(newTrMesh));
 				}
 
-				Assert(it->first.idx.IsValid());
+				Assert(infoIdx.IsValid());
 				physObjSp[nNonNullPhysObjects] = rc.GetCachedIdx(TrPhysicsObject{
-				    .infoIdx = it->first.idx,
-				    .meshIdx = it->second,
+				    .infoIdx = infoIdx,
+				    .meshIdx = rc.entMeshes[infoIdx],
 				});
 
 				Vector pos;
@@ -84,7 +84,12 @@ CON_COMMAND_F(spt_trace_set_tick, "Sets the trace draw tick", FCVAR_DONTRECORD)
 	spt_player_trace_feat.SetDisplayTick(strtoul(args[1], nullptr, 10));
 }
 
-CON_COMMAND_F(spt_trace_export, "Export trace to binary file", FCVAR_DONTRECORD)
+CON_COMMAND_F(spt_trace_export,
+              "Export trace to binary file. Formats:\n"
+              "  block = independently compressed blocks, quick to load (default)\n"
+              "  raw = uncompressed blocks without column encoding, quickest to load but large\n"
+              "  xz = single lzma stream, smallest but has to be decompressed all at once",
+              FCVAR_DONTRECORD)
 {
 	if (spt_player_trace_feat.tr.IsRecording())
 	{
@@ -93,7 +98,7 @@ CON_COMMAND_F(spt_trace_export, "Export trace to binary file", FCVAR_DONTRECORD)
 	}
 	if (args.ArgC() < 2)
 	{
-		Msg("Usage: %s <file_name>\n", spt_trace_export_command.GetName());
+		Msg("Usage: %s <file_name> [block|raw|xz]\n", spt_trace_export_command.GetName());
 		return;
 	}
 	// nothing will break if we remove these two checks, I just think it removes a weird use case
@@ -107,9 +112,17 @@ CON_COMMAND_F(spt_trace_export, "Export trace to binary file", FCVAR_DONTRECORD)
 		Warning("Trace is still being recorded, call '%s' first\n", spt_trace_stop_command.GetName());
 		return;
 	}
+	const char* format = args.ArgC() > 2 ? args[2] : "block";
+	bool xz = !strcmp(format, "xz");
+	if (!xz && strcmp(format, "block") && strcmp(format, "raw"))
+	{
+		Warning("Unknown format '%s'\n", format);
+		return;
+	}
+
 	std::filesystem::path filePath{GetGameDir()};
 	filePath /= args[1];
-	filePath += TR_COMPRESSED_FILE_EXT;
+	filePath += xz ? TR_COMPRESSED_FILE_EXT : TR_BLOCK_FILE_EXT;
 	filePath = std::filesystem::absolute(filePath);
 
 	std::error_code ec;
@@ -128,18 +141,24 @@ CON_COMMAND_F(spt_trace_export, "Export trace to binary file", FCVAR_DONTRECORD)
 	}
 
 	TrWrite trWrite{};
-	TrXzFileWriter wr{ofs};
+	trWrite.encodeColumns = strcmp(format, "raw") != 0;
+	std::unique_ptr<ITrWriter> wr;
+	if (xz)
+		wr = std::make_unique<TrXzFileWriter>(ofs);
+	else
+		wr = std::make_unique<TrBlockFileWriter>(ofs, strcmp(format, "raw") != 0);
 
-	if (trWrite.Write(spt_player_trace_feat.tr, wr))
+	if (trWrite.Write(spt_player_trace_feat.tr, *wr))
 		Msg("Wrote trace to '%s'\n", filePath.string().c_str());
 	else
 		Warning("Failed to write trace to file\n");
 }
 
 CON_COMMAND_AUTOCOMPLETEFILE(spt_trace_import,
-                             "Load trace from binary file",
+                             "Load trace from binary file, " TR_BLOCK_FILE_EXT " files are tried before " TR_COMPRESSED_FILE_EXT,
                              FCVAR_DONTRECORD,
                              "",
+                             TR_BLOCK_FILE_EXT,
                              TR_COMPRESSED_FILE_EXT)
 {
 	if (args.ArgC() < 2)
@@ -150,23 +169,40 @@ CON_COMMAND_AUTOCOMPLETEFILE(spt_trace_import,
 
 	std::filesystem::path filePath{GetGameDir()};
 	filePath /= args[1];
-	filePath += TR_COMPRESSED_FILE_EXT;
+	filePath += TR_BLOCK_FILE_EXT;
 	filePath = std::filesystem::absolute(filePath);
-	std::ifstream ifs{filePath, std::ios::binary};
-	if (!ifs.is_open())
-	{
-		Warning("Failed to open file '%s'\n", filePath.string().c_str());
-		return;
-	}
 
 	TrRestore restore{};
-	TrXzFileReader rd{ifs};
+	std::unique_ptr<ITrReader> rd;
+	std::string* rdErrMsg;
+	std::ifstream ifs;
+
+	if (std::filesystem::exists(filePath))
+	{
+		auto blockRd = std::make_unique<TrBlockFileReader>(filePath);
+		rdErrMsg = &blockRd->errMsg;
+		rd = std::move(blockRd);
+	}
+	else
+	{
+		filePath.replace_extension(); // .sptr -> .sptr.xz
+		filePath += TR_COMPRESSED_FILE_EXT;
+		ifs.open(filePath, std::ios::binary);
+		if (!ifs.is_open())
+		{
+			Warning("Failed to open file '%s'\n", filePath.string().c_str());
+			return;
+		}
+		auto xzRd = std::make_unique<TrXzFileReader>(ifs);
+		rdErrMsg = &xzRd->errMsg;
+		rd = std::move(xzRd);
+	}
 
 	TrPlayerTrace newTr;
-	if (!restore.Restore(newTr, rd))
+	if (!restore.Restore(newTr, *rd))
 	{
 		Warning("Failed to load trace from file: %s\n",
-		        rd.errMsg.empty() ? restore.errMsg.c_str() : rd.errMsg.c_str());
+		        rdErrMsg->empty() ? restore.errMsg.c_str() : rdErrMsg->c_str());
 		return;
 	}
 
@@ -1,9 +1,11 @@
 #pragma once
 
-#include <unordered_set>
+#include <algorithm>
+#include <bit>
 #include <map>
 #include <string>
 #include <span>
+#include <unordered_map>
 
 #include "tr_structs.hpp"
 
@@ -15,6 +17,66 @@ namespace player_trace
 {
 	constexpr uint32_t MAX_DELTAS_WITHOUT_SNAPSHOT = 100;
 
+	/*
+	* Hashes for the recording cache. Everything in the trace is made out of 4 byte fields, so
+	* this mixes one 4 byte word at a time (FxHash style) and finishes with the murmur3 finalizer.
+	* For fixed size objects the loop is unrolled for each sizeof(T).
+	*/
+	inline uint32_t TrHashMix(uint32_t h, uint32_t word)
+	{
+		return (std::rotl(h, 5) ^ word) * 0x9E3779B9u;
+	}
+
+	inline uint32_t TrHashFinalize(uint32_t h)
+	{
+		h ^= h >> 16;
+		h *= 0x85EBCA6Bu;
+		h ^= h >> 13;
+		h *= 0xC2B2AE35u;
+		h ^= h >> 16;
+		return h;
+	}
+
+	template<size_t N>
+	inline uint32_t TrHashBytes(const void* p)
+	{
+		const char* bytes = (const char*)p;
+		uint32_t h = N;
+		for (size_t i = 0; i + 4 <= N; i += 4)
+		{
+			uint32_t word;
+			memcpy(&word, bytes + i, 4);
+			h = TrHashMix(h, word);
+		}
+		if constexpr (N % 4 != 0)
+		{
+			uint32_t word = 0;
+			memcpy(&word, bytes + N - N % 4, N % 4);
+			h = TrHashMix(h, word);
+		}
+		return TrHashFinalize(h);
+	}
+
+	inline uint32_t TrHashBytes(const void* p, size_t n)
+	{
+		const char* bytes = (const char*)p;
+		uint32_t h = n;
+		size_t i = 0;
+		for (; i + 4 <= n; i += 4)
+		{
+			uint32_t word;
+			memcpy(&word, bytes + i, 4);
+			h = TrHashMix(h, word);
+		}
+		if (i < n)
+		{
+			uint32_t word = 0;
+			memcpy(&word, bytes + i, n - i);
+			h = TrHashMix(h, word);
+		}
+		return TrHashFinalize(h);
+	}
+
 	class TrRecordingCache
 	{
 		friend struct TrPlayerTrace;
@@ -25,135 +87,176 @@ namespace player_trace
 		* One of the main goals of the recording cache is to reuse indices that we've seen before.
 		* Say we recording a new player data object, and the player is looking in the same
 		* direction as they were last tick. Ideally, no new QAngle object is added. Instead, the
-		* TrIdx<QAngle> into the std::vector<QAngle> is the same. The naive way to do this is to
-		* do something like: std::unordered_map<QAngle, TrIdx<QAngle>>, and the logic would
-		* look like this:
-		* 
-		* 1) try to insert a new QAngle
-		* 2) if the key exists then reuse the TrIdx value
-		* 3) if the key is new, set the value to be the size of the trace's std::vector<QAngle>
-		* 4) add the QAngle to the std::vector<QAngle> in the trace
+		* TrIdx<QAngle> into the std::vector<QAngle> is the same.
 		* 
-		* The overhead here is that the QAngle is stored twice in two locations. But this is not
-		* necessary, since we can get the QAngle if we just have a TrIdx to it. So really, we don't
-		* need a map, it's sufficient to have a set!
+		* The naive way to do this is with a std::unordered_map<QAngle, TrIdx<QAngle>>, but then
+		* every QAngle is stored twice and every new one costs a node allocation. Instead, the
+		* sets below are open addressing tables that only store the TrIdx and the hash of the
+		* object. The object itself is compared by looking it up in the trace's vector:
 		* 
-		* 1) try to insert a new MemKey<QAngle> (initialized with a QAngle&)
-		* 2) if the key exists, we'll get back an iterator to a MemKey<QAngle> with a valid idx
-		* 3) if the key is new, set the idx so to be the size of the trace's std::vector<QAngle>
-		* 4) add the QAngle to the std::vector<QAngle> in the trace
-		* 
-		* Just like that, we don't need to store the QAngle in the cache because it already exists
-		* in the trace's std::vector.
+		* 1) hash the new QAngle and probe the table
+		* 2) for every slot with the same hash, memcmp the QAngle with the one in the trace
+		* 3) if there's a match reuse that TrIdx
+		* 4) otherwise add the QAngle to the std::vector<QAngle> in the trace and put its TrIdx
+		*    in the empty slot that ended the probe
 		*/
 		template<typename T>
-		struct MemKey
+		class TrIdxSet
 		{
-			const T& ref;
-			mutable TrIdx<T> idx;
+			struct Slot
+			{
+				TrIdx<T> idx;
+				uint32_t hash;
+			};
 
-			MemKey(const T& ref) : ref{ref}, idx{} {}
+			std::vector<Slot> slots;
+			uint32_t count = 0;
 
-			inline const T* GetPtr() const
+		public:
+			// returns the index of an object equal to t in vec, adds t to the end of vec if there isn't one
+			std::pair<TrIdx<T>, bool> FindOrAdd(std::vector<T>& vec, const T& t)
 			{
-				return idx.IsValid() ? *idx : &ref;
+				if ((count + 1) * 4 > slots.size() * 3)
+					Grow();
+				uint32_t hash = TrHashBytes<sizeof(T)>(&t);
+				uint32_t mask = slots.size() - 1;
+				for (uint32_t i = hash & mask;; i = (i + 1) & mask)
+				{
+					Slot& slot = slots[i];
+					if (slot.idx._val == TrIdx<T>{}._val)
+					{
+						slot = {(uint32_t)vec.size(), hash};
+						vec.push_back(t);
+						count++;
+						return {slot.idx, true};
+					}
+					if (slot.hash == hash && !memcmp(&vec[slot.idx], &t, sizeof(T)))
+						return {slot.idx, false};
+				}
 			}
 
-			bool operator==(const MemKey& o) const
+			size_t GetMemoryUsage() const
 			{
-				return !memcmp(GetPtr(), o.GetPtr(), sizeof(T));
+				return slots.capacity() * sizeof(Slot);
 			}
 
-			struct Hasher
+		private:
+			void Grow()
 			{
-				size_t operator()(const MemKey& o) const
+				std::vector<Slot> oldSlots(std::max<size_t>(slots.size() * 2, 64), Slot{{}, 0});
+				oldSlots.swap(slots);
+				uint32_t mask = slots.size() - 1;
+				for (const Slot& old : oldSlots)
 				{
-					return std::hash<std::string_view>{}(std::string_view{
-					    reinterpret_cast<const char*>(o.GetPtr()),
-					    sizeof(T),
-					});
+					if (old.idx._val == TrIdx<T>{}._val)
+						continue;
+					uint32_t i = old.hash & mask;
+					while (slots[i].idx._val != TrIdx<T>{}._val)
+						i = (i + 1) & mask;
+					slots[i] = old;
 				}
-			};
+			}
 		};
 
-		// pretty much the same logic that's used for MemKey is used for this
+		// pretty much the same logic that's used for TrIdxSet is used for this
 		template<typename T>
-		struct MemSpanKey
+		class TrSpanSet
 		{
-			std::span<const T> span;
-			mutable TrSpan<T> trSpan;
+			struct Slot
+			{
+				TrSpan<T> span;
+				uint32_t hash;
+			};
 
-			MemSpanKey(const std::span<const T>& sp) : span{sp}, trSpan{} {}
+			std::vector<Slot> slots;
+			uint32_t count = 0;
 
-			inline std::span<const T> GetStdSpan() const
+		public:
+			TrSpan<T> FindOrAdd(std::vector<T>& vec, std::span<const T> sp)
 			{
-				return trSpan.IsValid() ? *trSpan : span;
+				if ((count + 1) * 4 > slots.size() * 3)
+					Grow();
+				uint32_t hash = TrHashBytes(sp.data(), sp.size_bytes());
+				uint32_t mask = slots.size() - 1;
+				for (uint32_t i = hash & mask;; i = (i + 1) & mask)
+				{
+					Slot& slot = slots[i];
+					if (slot.span.n == TrSpan<T>{}.n)
+					{
+						slot = {TrSpan<T>{(uint32_t)vec.size(), (uint32_t)sp.size()}, hash};
+						vec.insert(vec.cend(), sp.begin(), sp.end());
+						count++;
+						return slot.span;
+					}
+					if (slot.hash == hash && slot.span.n == sp.size()
+					    && !memcmp(vec.data() + slot.span.start, sp.data(), sp.size_bytes()))
+					{
+						return slot.span;
+					}
+				}
 			}
 
-			bool operator==(const MemSpanKey& o) const
+			size_t GetMemoryUsage() const
 			{
-				auto sp1 = GetStdSpan();
-				auto sp2 = o.GetStdSpan();
-				return sp1.size() == sp2.size() && !memcmp(sp1.data(), sp2.data(), sp1.size_bytes());
+				return slots.capacity() * sizeof(Slot);
 			}
 
-			struct Hasher
+		private:
+			void Grow()
 			{
-				size_t operator()(const MemSpanKey& o) const
+				std::vector<Slot> oldSlots(std::max<size_t>(slots.size() * 2, 64), Slot{{}, 0});
+				oldSlots.swap(slots);
+				uint32_t mask = slots.size() - 1;
+				for (const Slot& old : oldSlots)
 				{
-					auto sp = o.GetStdSpan();
-					return std::hash<std::string_view>{}(std::string_view{
-					    reinterpret_cast<const char*>(sp.data()),
-					    sp.size_bytes(),
-					});
+					if (old.span.n == TrSpan<T>{}.n)
+						continue;
+					uint32_t i = old.hash & mask;
+					while (slots[i].span.n != TrSpan<T>{}.n)
+						i = (i + 1) & mask;
+					slots[i] = old;
 				}
-			};
+			}
 		};
 
-		template<typename T>
-		using MemKeySet = std::unordered_set<MemKey<T>, typename MemKey<T>::Hasher>;
-
-		template<typename T>
-		using MemSpanKeySet = std::unordered_set<MemSpanKey<T>, typename MemSpanKey<T>::Hasher>;
-
 		std::tuple<
 
-		    MemKeySet<Vector>,
-		    MemKeySet<QAngle>,
-		    MemKeySet<TrTransform>,
-		    MemKeySet<TrPortal>,
-		    MemKeySet<TrAbsBox>,
-		    MemKeySet<TrEnt>,
-		    MemKeySet<TrPhysicsObject>,
-		    MemKeySet<TrPhysMesh>,
-		    MemKeySet<TrEntTransform>,
-		    MemKeySet<TrPlayerContactPoint>
+		    TrIdxSet<Vector>,
+		    TrIdxSet<QAngle>,
+		    TrIdxSet<TrTransform>,
+		    TrIdxSet<TrPortal>,
+		    TrIdxSet<TrAbsBox>,
+		    TrIdxSet<TrEnt>,
+		    TrIdxSet<TrPhysicsObject>,
+		    TrIdxSet<TrPhysMesh>,
+		    TrIdxSet<TrEntTransform>,
+		    TrIdxSet<TrPlayerContactPoint>
 
 		    >
 		    idxSets;
 
 		std::tuple<
 
-		    MemSpanKeySet<char>,
-		    MemSpanKeySet<TrIdx<Vector>>,
-		    MemSpanKeySet<TrIdx<TrPhysicsObject>>,
-		    MemSpanKeySet<TrIdx<TrTransform>>,
-		    MemSpanKeySet<TrIdx<TrPortal>>,
-		    MemSpanKeySet<TrIdx<TrPlayerContactPoint>>
+		    TrSpanSet<char>,
+		    TrSpanSet<TrIdx<Vector>>,
+		    TrSpanSet<TrIdx<TrPhysicsObject>>,
+		    TrSpanSet<TrIdx<TrTransform>>,
+		    TrSpanSet<TrIdx<TrPortal>>,
+		    TrSpanSet<TrIdx<TrPlayerContactPoint>>
 
 		    >
 		    spanSets;
 
 		template<typename T>
-		constexpr MemKeySet<T>& GetKeySet()
+		constexpr TrIdxSet<T>& GetKeySet()
 		{
-			return std::get<MemKeySet<T>>(idxSets);
+			return std::get<TrIdxSet<T>>(idxSets);
 		}
 
 		template<typename T>
-		constexpr MemSpanKeySet<T>& GetSpanSet()
+		constexpr TrSpanSet<T>& GetSpanSet()
 		{
-			return std::get<MemSpanKeySet<T>>(spanSets);
+			return std::get<TrSpanSet<T>>(spanSets);
 		}
 
 	public:
@@ -182,9 +285,12 @@ namespace player_trace
 		std::vector<EntSnapshotEntry> entSnapshot;
 		uint32_t nEntDeltasWithoutSnapshot = 0;
 
-		// map IPhysicsObject* -> mesh_data so that we don't have to rebuild entity meshes every tick
-		std::unordered_map<MemKey<TrPhysicsObjectInfo>, TrIdx<TrPhysMesh>, MemKey<TrPhysicsObjectInfo>::Hasher>
-		    entMeshMap;
+		/*
+		* Physics object info -> mesh so that we don't have to rebuild entity meshes every tick. The
+		* info objects are unique, so the mesh of each one is kept at the same index in entMeshes.
+		*/
+		TrIdxSet<TrPhysicsObjectInfo> entMeshInfoSet;
+		std::vector<TrIdx<TrPhysMesh>> entMeshes;
 
 		Vector landmarkDeltaToFirstMap = vec3_origin;
 
@@ -215,31 +321,13 @@ namespace player_trace
 		template<typename T>
 		TrIdx<T> GetCachedIdx(const T& t)
 		{
-			TrReadContextScope ctx{*tr};
-			auto& set = GetKeySet<T>();
-			auto [it, new_elem] = set.emplace(t);
-			if (new_elem)
-			{
-				auto& vec = tr->Get<T>();
-				it->idx = vec.size();
-				vec.push_back(t);
-			}
-			return it->idx;
+			return GetKeySet<T>().FindOrAdd(tr->Get<T>(), t).first;
 		}
 
 		template<typename T>
 		TrSpan<T> GetCachedSpan(std::span<const T> sp)
 		{
-			TrReadContextScope ctx{*tr};
-			auto& set = GetSpanSet<T>();
-			auto [it, new_elem] = set.emplace(sp);
-			if (new_elem)
-			{
-				auto& vec = tr->Get<T>();
-				it->trSpan = TrSpan<T>{vec.size(), sp.size()};
-				vec.insert(vec.cend(), sp.begin(), sp.end());
-			}
-			return it->trSpan;
+			return GetSpanSet<T>().FindOrAdd(tr->Get<T>(), sp);
 		}
 
 		template<typename T>
@@ -259,6 +347,13 @@ namespace player_trace
 			return GetCachedSpan(std::span<const char>{s.c_str(), s.size() + 1}).start;
 		}
 
+		size_t GetMemoryUsage() const
+		{
+			auto usageFunc = [](auto&... sets) { return (0u + ... + sets.GetMemoryUsage()); };
+			return std::apply(usageFunc, idxSets) + std::apply(usageFunc, spanSets)
+			       + entMeshInfoSet.GetMemoryUsage() + entMeshes.capacity() * sizeof(entMeshes[0]);
+		}
+
 		void CollectEntityDelta(std::vector<EntSnapshotEntry>& newSnapshot);
 		// delta must be recorded first!
 		void CollectEntitySnapshot();
@@ -1,5 +1,7 @@
 #include "stdafx.hpp"
 
+#include <algorithm>
+
 #include "tr_render_cache.hpp"
 #include "spt/utils/interfaces.hpp"
 #include "spt/utils/map_utils.hpp"
@@ -417,6 +419,11 @@ void TrRenderingCache::RebuildPhysMeshes()
 		for (auto& [_, tracked] : physMeshes)
 			tracked.isActive = false;
 
+	// new meshes are built all at once in parallel
+	std::vector<MeshCreateFunc> createFuncs;
+	std::vector<StaticMesh*> newMeshes;
+	std::unordered_set<TrIdx<TrPhysMesh>> queuedMeshes;
+
 	for (auto& [entIdx, entTransIdx] : entSnapshot.entMap)
 	{
 		const TrEnt& ent = **entIdx;
@@ -429,15 +436,16 @@ void TrRenderingCache::RebuildPhysMeshes()
 		{
 			auto [it, new_elem] = physMeshes.try_emplace(physIdx->meshIdx);
 			it->second.isActive = true;
-			if (it->second.mesh.Valid())
+			if (it->second.mesh.Valid() || !queuedMeshes.insert(physIdx->meshIdx).second)
 				continue;
 
 			const TrPhysMesh& physMesh = **it->first;
+			newMeshes.push_back(&it->second.mesh);
 
 			if (physMesh.ballRadius > 0)
 			{
-				it->second.mesh = spt_meshBuilder.CreateStaticMesh(
-				    [&](MeshBuilderDelegate& mb)
+				createFuncs.push_back(
+				    [&physMesh, shapeCol](MeshBuilderDelegate& mb)
 				    {
 					    mb.AddSphere(vec3_origin,
 					                 physMesh.ballRadius,
@@ -447,12 +455,11 @@ void TrRenderingCache::RebuildPhysMeshes()
 			}
 			else
 			{
-				// TODO optimize?
-				it->second.mesh = spt_meshBuilder.CreateStaticMesh(
-				    [&](MeshBuilderDelegate& mb)
+				createFuncs.push_back(
+				    [&physMesh, shapeCol](MeshBuilderDelegate& mb)
 				    {
-					    static std::vector<Vector> pts;
-					    pts.clear();
+					    std::vector<Vector> pts;
+					    pts.reserve(physMesh.vertIdxSp.n);
 					    for (auto vertIdx : *physMesh.vertIdxSp)
 						    pts.push_back(**vertIdx);
 					    mb.AddTris(pts.data(), physMesh.vertIdxSp.n / 3, shapeCol);
@@ -461,6 +468,13 @@ void TrRenderingCache::RebuildPhysMeshes()
 		}
 	}
 
+	if (!createFuncs.empty())
+	{
+		auto builtMeshes = spt_meshBuilder.CreateStaticMeshes(createFuncs);
+		for (size_t i = 0; i < builtMeshes.size(); i++)
+			*newMeshes[i] = builtMeshes[i];
+	}
+
 	if (meshes.ents.anyStale)
 	{
 		std::erase_if(physMeshes, [](const auto& entry) { return !entry.second.isActive; });
@@ -531,43 +545,43 @@ void TrRenderingCache::UpdateEntSnapshot(tr_tick toTick)
 	constexpr uint32_t JUMP_TO_SNAPSHOT_COST = 3;
 	constexpr uint32_t SNAPSHOT_DELTA_COST = 1;
 
+	// the number of delta blocks needed to get from one delta to another
+	auto countBlocks = [](TrIdx<TrEntSnapshotDelta> from, TrIdx<TrEntSnapshotDelta> to)
+	{
+		size_t n = 0;
+		auto countFunc = [&n](uint32_t, uint32_t) { n++; };
+		if (from + 1 <= to + 1)
+			EntDeltaIndex::ForEachBlock(from + 1, to + 1, true, countFunc);
+		else
+			EntDeltaIndex::ForEachBlock(to + 1, from + 1, false, countFunc);
+		return n;
+	};
+
 	SnapshotDeltaApproach approach = SDA_JUMP_TO_SNAPSHOT_THEN_INCREMENT;
-	size_t cost = JUMP_TO_SNAPSHOT_COST + SNAPSHOT_DELTA_COST * (snapDeltaIdx - snapIdxLow->snapDeltaIdx);
-	size_t nDeltas = snapDeltaIdx - snapIdxLow->snapDeltaIdx;
+	size_t nDeltas = countBlocks(snapIdxLow->snapDeltaIdx, snapDeltaIdx);
+	size_t cost = JUMP_TO_SNAPSHOT_COST + SNAPSHOT_DELTA_COST * nDeltas;
 
 	if (snapIdxHigh.IsValid())
 	{
-		size_t newCost =
-		    JUMP_TO_SNAPSHOT_COST + SNAPSHOT_DELTA_COST * (snapIdxHigh->snapDeltaIdx - snapDeltaIdx);
+		size_t newDeltas = countBlocks(snapIdxHigh->snapDeltaIdx, snapDeltaIdx);
+		size_t newCost = JUMP_TO_SNAPSHOT_COST + SNAPSHOT_DELTA_COST * newDeltas;
 		if (newCost < cost)
 		{
 			approach = SDA_JUMP_TO_SNAPSHOT_THEN_DECREMENT;
 			cost = newCost;
-			nDeltas = snapIdxHigh->snapDeltaIdx - snapDeltaIdx;
+			nDeltas = newDeltas;
 		}
 	}
 
 	if (entSnapshot.initialized)
 	{
-		if (entSnapshot.tick <= toTick)
-		{
-			size_t newCost = SNAPSHOT_DELTA_COST * (snapDeltaIdx - entSnapshot.snapshotDeltaIdx);
-			if (newCost < cost)
-			{
-				approach = SDA_INCREMENT;
-				cost = newCost;
-				nDeltas = snapDeltaIdx - entSnapshot.snapshotDeltaIdx;
-			}
-		}
-		else
+		size_t newDeltas = countBlocks(entSnapshot.snapshotDeltaIdx, snapDeltaIdx);
+		size_t newCost = SNAPSHOT_DELTA_COST * newDeltas;
+		if (newCost < cost)
 		{
-			size_t newCost = SNAPSHOT_DELTA_COST * (entSnapshot.snapshotDeltaIdx - snapDeltaIdx);
-			if (newCost < cost)
-			{
-				approach = SDA_DECREMENT;
-				cost = newCost;
-				nDeltas = entSnapshot.snapshotDeltaIdx - snapDeltaIdx;
-			}
+			approach = entSnapshot.tick <= toTick ? SDA_INCREMENT : SDA_DECREMENT;
+			cost = newCost;
+			nDeltas = newDeltas;
 		}
 	}
 
@@ -578,26 +592,27 @@ void TrRenderingCache::UpdateEntSnapshot(tr_tick toTick)
 	    "INCREMENT",
 	    "DECREMENT",
 	};
-	DevMsg("SPT: [%s] using approach %s with %u deltas\n", __FUNCTION__, approachStrs[approach], nDeltas);
+	DevMsg("SPT: [%s] using approach %s with %u delta blocks\n", __FUNCTION__, approachStrs[approach], nDeltas);
 #endif
 
 	switch (approach)
 	{
 	case SDA_JUMP_TO_SNAPSHOT_THEN_INCREMENT:
 		JumpToEntSnapshot(snapIdxLow);
-		[[fallthrough]];
-	case SDA_INCREMENT:
-		ForwardIterateSnapshotDeltas(toTick);
 		break;
 	case SDA_JUMP_TO_SNAPSHOT_THEN_DECREMENT:
 		JumpToEntSnapshot(snapIdxHigh);
-		[[fallthrough]];
+		break;
+	case SDA_INCREMENT:
 	case SDA_DECREMENT:
-		BackwardIterateSnapshotDeltas(toTick);
 		break;
 	default:
 		Assert(0);
 	}
+	SeekEntSnapshotDelta(snapDeltaIdx);
+	entSnapshot.snapshotIdx = snapIdxLow;
+	entSnapshot.tick = toTick;
+	VerifySnapshotState();
 }
 
 void TrRenderingCache::JumpToEntSnapshot(TrIdx<TrEntSnapshot> snapIdx)
@@ -613,91 +628,161 @@ void TrRenderingCache::JumpToEntSnapshot(TrIdx<TrEntSnapshot> snapIdx)
 	entSnapshot.initialized = true;
 }
 
-void TrRenderingCache::ForwardIterateSnapshotDeltas(tr_tick toTick)
+void TrRenderingCache::SeekEntSnapshotDelta(TrIdx<TrEntSnapshotDelta> toDeltaIdx)
 {
-	VerifySnapshotState();
-	TrIdx<TrEntSnapshot> snapIdxLow = entSnapshot.snapshotIdx;
+	TrIdx<TrEntSnapshotDelta> fromDeltaIdx = entSnapshot.snapshotDeltaIdx;
+	auto applyFunc = [this](bool forward)
+	{
+		return [this, forward](uint32_t level, uint32_t blockIdx)
+		{
+			if (level == 0)
+				ApplyEntDelta(**TrIdx<TrEntSnapshotDelta>{blockIdx}, forward);
+			else
+				ApplyEntDeltaBlock(GetEntDeltaBlock(level, blockIdx), forward);
+		};
+	};
 
-	while ((entSnapshot.snapshotDeltaIdx + 1).IsValid() && entSnapshot.snapshotDeltaIdx->tick < toTick)
+	// an invalid index means no deltas have been applied, +1 wraps that to 0
+	if (fromDeltaIdx + 1 <= toDeltaIdx + 1)
+		EntDeltaIndex::ForEachBlock(fromDeltaIdx + 1, toDeltaIdx + 1, true, applyFunc(true));
+	else
+		EntDeltaIndex::ForEachBlock(toDeltaIdx + 1, fromDeltaIdx + 1, false, applyFunc(false));
+
+	entSnapshot.snapshotDeltaIdx = toDeltaIdx;
+}
+
+void TrRenderingCache::ApplyEntDelta(const TrEntSnapshotDelta& delta, bool forward)
+{
+	auto eraseEnt = [this](TrIdx<TrEnt> entIdx)
 	{
-		auto& delta = **++entSnapshot.snapshotDeltaIdx;
+		auto it = entSnapshot.entMap.find(entIdx);
+		if (it == entSnapshot.entMap.cend())
+		{
+			AssertMsg(0, "SPT: attempting to delete non-existing ent");
+			return;
+		}
+		entSnapshot.entMap.erase(it);
+		meshes.ents.anyStale = true;
+	};
 
+	if (forward)
+	{
 		for (auto& create : *delta.createSp)
 			entSnapshot.entMap.emplace(create.entIdx, create.transIdx);
+	}
+	else
+	{
+		for (auto& create : *delta.createSp)
+			eraseEnt(create.entIdx);
+	}
 
-		for (auto& transDelta : *delta.deltaSp)
+	for (auto& transDelta : *delta.deltaSp)
+	{
+		auto it = entSnapshot.entMap.find(transDelta.entIdx);
+		if (it == entSnapshot.entMap.cend())
 		{
-			auto it = entSnapshot.entMap.find(transDelta.entIdx);
-			if (it == entSnapshot.entMap.cend())
-			{
-				AssertMsg(0, "SPT: attempting to delta non-existing ent");
-				continue;
-			}
-			it->second = transDelta.toTransIdx;
+			AssertMsg(0, "SPT: attempting to delta non-existing ent");
+			continue;
 		}
+		it->second = forward ? transDelta.toTransIdx : transDelta.fromTransIdx;
+	}
 
+	if (forward)
+	{
 		for (auto& del : *delta.deleteSp)
+			eraseEnt(del.entIdx);
+	}
+	else
+	{
+		for (auto& del : *delta.deleteSp)
+			entSnapshot.entMap.emplace(del.entIdx, del.oldTransIdx);
+	}
+}
+
+void TrRenderingCache::ApplyEntDeltaBlock(const std::vector<TrEntTransformDelta>& block, bool forward)
+{
+	for (auto& entry : block)
+	{
+		TrIdx<TrEntTransform> transIdx = forward ? entry.toTransIdx : entry.fromTransIdx;
+		if (transIdx.IsValid())
 		{
-			auto it = entSnapshot.entMap.find(del.entIdx);
-			if (it == entSnapshot.entMap.cend())
-			{
-				AssertMsg(0, "SPT: attempting to delete non-existing ent");
-				continue;
-			}
-			entSnapshot.entMap.erase(it);
+			entSnapshot.entMap[entry.entIdx] = transIdx;
+		}
+		else
+		{
+			entSnapshot.entMap.erase(entry.entIdx);
 			meshes.ents.anyStale = true;
 		}
-
-		entSnapshot.tick = delta.tick;
-
-		if ((snapIdxLow + 1).IsValid() && (snapIdxLow + 1)->tick <= delta.tick)
-			entSnapshot.snapshotIdx = ++snapIdxLow;
 	}
-	entSnapshot.tick = toTick;
 }
 
-void TrRenderingCache::BackwardIterateSnapshotDeltas(tr_tick toTick)
+const std::vector<TrEntTransformDelta>& TrRenderingCache::GetEntDeltaBlock(uint32_t level, uint32_t blockIdx)
 {
-	VerifySnapshotState();
-	TrIdx<TrEntSnapshot> snapIdxLow = entSnapshot.snapshotIdx;
+	Assert(level > 0 && level < EntDeltaIndex::N_LEVELS);
+	auto& blocks = entDeltaIndex.levels[level];
+	if (blocks.size() > blockIdx && blocks[blockIdx].built)
+		return blocks[blockIdx].entries;
 
-	while ((entSnapshot.snapshotDeltaIdx - 1).IsValid() && entSnapshot.snapshotDeltaIdx->tick > toTick)
+	// make room for all the children first so that building one doesn't invalidate the other
+	for (uint32_t l = 1; l <= level; l++)
 	{
-		auto& delta = **entSnapshot.snapshotDeltaIdx--;
+		auto& lBlocks = entDeltaIndex.levels[l];
+		lBlocks.resize(std::max<size_t>(lBlocks.size(), (blockIdx + 1) << (level - l)));
+	}
 
-		for (auto& create : *delta.createSp)
-		{
-			auto it = entSnapshot.entMap.find(create.entIdx);
-			if (it == entSnapshot.entMap.cend())
-			{
-				AssertMsg(0, "SPT: attempting to delete non-existing ent");
-				continue;
-			}
-			entSnapshot.entMap.erase(it);
-			meshes.ents.anyStale = true;
-		}
+	auto getChild = [this, level](uint32_t childIdx, std::vector<TrEntTransformDelta>& tmp)
+	    -> const std::vector<TrEntTransformDelta>&
+	{
+		if (level > 1)
+			return GetEntDeltaBlock(level - 1, childIdx);
 
+		// turn a trace delta into the same form as the blocks
+		const TrEntSnapshotDelta& delta = **TrIdx<TrEntSnapshotDelta>{childIdx};
+		tmp.clear();
+		for (auto& create : *delta.createSp)
+			tmp.push_back({create.entIdx, {}, create.transIdx});
 		for (auto& transDelta : *delta.deltaSp)
-		{
-			auto it = entSnapshot.entMap.find(transDelta.entIdx);
-			if (it == entSnapshot.entMap.cend())
-			{
-				AssertMsg(0, "SPT: attempting to delta non-existing ent");
-				continue;
-			}
-			it->second = transDelta.fromTransIdx;
-		}
-
+			tmp.push_back(transDelta);
 		for (auto& del : *delta.deleteSp)
-			entSnapshot.entMap.emplace(del.entIdx, del.oldTransIdx);
+			tmp.push_back({del.entIdx, del.oldTransIdx, {}});
+		std::ranges::sort(tmp, {}, &TrEntTransformDelta::entIdx);
+		return tmp;
+	};
 
-		entSnapshot.tick = delta.tick;
+	// only filled for level 1 blocks, higher levels return the children that are already stored
+	std::vector<TrEntTransformDelta> tmpA, tmpB;
+	const auto& a = getChild(blockIdx * 2, tmpA);
+	const auto& b = getChild(blockIdx * 2 + 1, tmpB);
 
-		if ((snapIdxLow - 1).IsValid() && snapIdxLow->tick >= delta.tick)
-			entSnapshot.snapshotIdx = --snapIdxLow;
+	// merge the net changes of both children, entities that end up where they started are dropped
+	std::vector<TrEntTransformDelta> merged;
+	merged.reserve(a.size() + b.size());
+	size_t i = 0, j = 0;
+	while (i < a.size() || j < b.size())
+	{
+		if (j == b.size() || (i < a.size() && a[i].entIdx < b[j].entIdx))
+		{
+			merged.push_back(a[i++]);
+		}
+		else if (i == a.size() || b[j].entIdx < a[i].entIdx)
+		{
+			merged.push_back(b[j++]);
+		}
+		else
+		{
+			if (a[i].fromTransIdx != b[j].toTransIdx)
+				merged.push_back({a[i].entIdx, a[i].fromTransIdx, b[j].toTransIdx});
+			i++;
+			j++;
+		}
 	}
-	entSnapshot.tick = toTick;
+
+	auto& block = blocks[blockIdx];
+	block.entries = std::move(merged);
+	block.built = true;
+	return block.entries;
 }
+
 void TrRenderingCache::RenderPlayerPath(MeshRendererDelegate& mr, const Vector& landmarkDeltaToFirstMap)
 {
 	RebuildPlayerPathMeshes();
@@ -1,5 +1,6 @@
 #pragma once
 
+#include <array>
 #include <unordered_set>
 #include <unordered_map>
 
@@ -33,8 +34,10 @@ namespace player_trace
 		void VerifySnapshotState() const;
 		void UpdateEntSnapshot(tr_tick toTick);
 		void JumpToEntSnapshot(TrIdx<TrEntSnapshot> snapIdx);
-		void ForwardIterateSnapshotDeltas(tr_tick toTick);
-		void BackwardIterateSnapshotDeltas(tr_tick toTick);
+		void SeekEntSnapshotDelta(TrIdx<TrEntSnapshotDelta> toDeltaIdx);
+		void ApplyEntDelta(const TrEntSnapshotDelta& delta, bool forward);
+		void ApplyEntDeltaBlock(const std::vector<TrEntTransformDelta>& block, bool forward);
+		const std::vector<TrEntTransformDelta>& GetEntDeltaBlock(uint32_t level, uint32_t blockIdx);
 
 		/*
 		* The player path coordinates are computed relative to the first map of the trace, but in order
@@ -102,6 +105,54 @@ namespace player_trace
 			bool initialized = false;
 		} entSnapshot;
 
+		/*
+		* Seeking between snapshots would normally apply every delta one by one. Instead, the deltas
+		* are grouped into aligned power of two blocks which store the net change of the whole block
+		* (as transform deltas where an invalid transform means the entity doesn't exist). Any range
+		* of deltas can be covered by O(log n) blocks, so any tick can be reached from the nearest
+		* snapshot in a handful of block applications. Blocks are built on demand and never change
+		* since the trace is append-only.
+		*/
+		struct EntDeltaIndex
+		{
+			// enough levels to span MAX_DELTAS_WITHOUT_SNAPSHOT with a single block
+			static constexpr uint32_t N_LEVELS = 8;
+
+			struct Block
+			{
+				// sorted by entIdx
+				std::vector<TrEntTransformDelta> entries;
+				bool built = false;
+			};
+
+			// levels[k][j] covers deltas [j << k, (j + 1) << k), level 0 uses the trace deltas directly
+			std::array<std::vector<Block>, N_LEVELS> levels;
+
+			// calls f(level, blockIdx) for blocks that cover deltas [begin, end) in the given direction
+			template<typename F>
+			static void ForEachBlock(uint32_t begin, uint32_t end, bool forward, F&& f)
+			{
+				while (begin < end)
+				{
+					uint32_t level = N_LEVELS - 1;
+					if (forward)
+					{
+						while (level > 0 && ((begin & ((1u << level) - 1)) || begin + (1u << level) > end))
+							level--;
+						f(level, begin >> level);
+						begin += 1u << level;
+					}
+					else
+					{
+						while (level > 0 && ((end & ((1u << level) - 1)) || end - begin < (1u << level)))
+							level--;
+						end -= 1u << level;
+						f(level, end >> level);
+					}
+				}
+			}
+		} entDeltaIndex;
+
 		std::string renderedLastTimeOnMap;
 
 	public:
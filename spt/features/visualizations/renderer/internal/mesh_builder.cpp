@@ -9,6 +9,7 @@
 
 #include "interfaces.hpp"
 #include "spt\utils\game_detection.hpp"
+#include "spt\utils\thread_pool.hpp"
 
 #include "internal_defs.hpp"
 #include "mesh_renderer_internal.hpp"
@@ -252,12 +253,24 @@ void MeshBuilderInternal::FrameCleanup()
 #endif
 }
 
+void MeshBuilderInternal::BuildArenas(std::span<const MeshCreateFunc> createFuncs, bool dynamic)
+{
+	while (arenas.size() < createFuncs.size())
+		arenas.push_back(std::make_unique<MeshVertArena>());
+
+	for (size_t i = 0; i < createFuncs.size(); i++)
+		arenas[i]->tmpMesh.Begin(dynamic, arenas[i]->lists);
+
+	utils::GetThreadPool().ParallelFor(createFuncs.size(),
+	                                   [&](size_t i) { arenas[i]->tmpMesh.Fill(createFuncs[i]); });
+}
+
 const DynamicMeshUnit& MeshBuilderInternal::GetDynamicMeshFromToken(DynamicMeshToken token) const
 {
 	return dynamicMeshUnits._Get_container()[token.dynamicMeshIdx];
 }
 
-void MeshBuilderInternal::TmpMesh::Create(const MeshCreateFunc& createFunc, bool dynamic)
+void MeshBuilderInternal::TmpMesh::Begin(bool dynamic, SimpleLists& lists)
 {
 	// check that we don't have any existing data
 	Assert(!std::count_if(components.cbegin(),
@@ -271,8 +284,8 @@ void MeshBuilderInternal::TmpMesh::Create(const MeshCreateFunc& createFunc, bool
 		for (size_t j = 0; j < (size_t)MeshMaterialSimple::Count; j++)
 		{
 			size_t k = SIMPLE_COMPONENT_INDEX(i, j);
-			components[k].verts.assign_to_end(g_meshBuilderInternal.sharedLists.simple.verts[k]);
-			components[k].indices.assign_to_end(g_meshBuilderInternal.sharedLists.simple.indices[k]);
+			components[k].verts.assign_to_end(lists.verts[k]);
+			components[k].indices.assign_to_end(lists.indices[k]);
 			components[k].type = (MeshPrimitiveType)i;
 			components[k].material = g_meshMaterialMgr.GetMaterial((MeshMaterialSimple)j);
 		}
@@ -280,10 +293,22 @@ void MeshBuilderInternal::TmpMesh::Create(const MeshCreateFunc& createFunc, bool
 
 	// used by the delegate to check if the temp mesh is too big
 	GetMaxMeshSize(maxVerts, maxIndices, dynamic);
+}
 
+void MeshBuilderInternal::TmpMesh::Fill(const MeshCreateFunc& createFunc)
+{
 	// let the user fill the tmp mesh buffers
+	TmpMesh* oldTmpMesh = curTmpMesh;
+	curTmpMesh = this;
 	MeshBuilderDelegate builderDelegate{};
 	createFunc(builderDelegate);
+	curTmpMesh = oldTmpMesh;
+}
+
+void MeshBuilderInternal::TmpMesh::Create(const MeshCreateFunc& createFunc, bool dynamic)
+{
+	Begin(dynamic, g_meshBuilderInternal.sharedLists.simple);
+	Fill(createFunc);
 }
 
 MeshPositionInfo MeshBuilderInternal::TmpMesh::CalcPosInfo()
@@ -306,12 +331,9 @@ MeshPositionInfo MeshBuilderInternal::TmpMesh::CalcPosInfo()
 
 /**************************************** MESH BUILDER PRO ****************************************/
 
-StaticMesh MeshBuilderPro::CreateStaticMesh(const MeshCreateFunc& createFunc)
+// creates the IMesh* objects for a filled tmp mesh and pops its components
+static StaticMesh UploadStaticMesh(MeshBuilderInternal::TmpMesh& tmpMesh)
 {
-	SPT_VPROF_BUDGET(__FUNCTION__, VPROF_BUDGETGROUP_MESH_RENDERER);
-	auto& tmpMesh = g_meshBuilderInternal.tmpMesh;
-	tmpMesh.Create(createFunc, false);
-
 	size_t numPopulated = std::count_if(tmpMesh.components.cbegin(),
 	                                    tmpMesh.components.cend(),
 	                                    [](const MeshVertData& vd) { return !vd.Empty(); });
@@ -332,6 +354,77 @@ StaticMesh MeshBuilderPro::CreateStaticMesh(const MeshCreateFunc& createFunc)
 	return StaticMesh{mu};
 }
 
+// copies the components of a tmp mesh that was filled in an arena to the shared lists
+static DynamicMesh CopyArenaToDynamicMesh(MeshBuilderInternal::TmpMesh& tmpMesh)
+{
+	auto& shared = g_meshBuilderInternal.sharedLists;
+	Assert(tmpMesh.components.size() == MAX_SIMPLE_COMPONENTS);
+
+	const MeshPositionInfo posInfo = tmpMesh.CalcPosInfo();
+	VectorSlice<MeshVertData> dynamicSlice{shared.dynamicMeshData};
+	for (size_t i = tmpMesh.components.size(); i-- > 0;)
+	{
+		auto& vd = tmpMesh.components[i];
+		if (!vd.Empty())
+		{
+			MeshVertData& sharedVd =
+			    dynamicSlice.emplace_back(shared.simple.verts[i], shared.simple.indices[i], vd.type, vd.material);
+			sharedVd.verts.add_range(vd.verts.begin(), vd.verts.end());
+			sharedVd.indices.add_range(vd.indices.begin(), vd.indices.end());
+		}
+		tmpMesh.components.pop_back();
+	}
+	g_meshBuilderInternal.dynamicMeshUnits.emplace(dynamicSlice, posInfo);
+	return {g_meshBuilderInternal.dynamicMeshUnits.size() - 1, g_meshRendererInternal.frameNum};
+}
+
+StaticMesh MeshBuilderPro::CreateStaticMesh(const MeshCreateFunc& createFunc)
+{
+	SPT_VPROF_BUDGET(__FUNCTION__, VPROF_BUDGETGROUP_MESH_RENDERER);
+	auto& tmpMesh = g_meshBuilderInternal.tmpMesh;
+	tmpMesh.Create(createFunc, false);
+	return UploadStaticMesh(tmpMesh);
+}
+
+/*
+* The create funcs are run in batches so that we don't keep around an arena for every single mesh. A couple of
+* jobs per thread is enough to keep the pool busy when some meshes are a lot bigger than others.
+*/
+static size_t GetMeshBatchSize()
+{
+	return utils::GetThreadPool().GetThreadCount() * 4;
+}
+
+std::vector<StaticMesh> MeshBuilderPro::CreateStaticMeshes(std::span<const MeshCreateFunc> createFuncs)
+{
+	SPT_VPROF_BUDGET(__FUNCTION__, VPROF_BUDGETGROUP_MESH_RENDERER);
+	std::vector<StaticMesh> meshes;
+	meshes.reserve(createFuncs.size());
+	for (size_t start = 0; start < createFuncs.size(); start += GetMeshBatchSize())
+	{
+		auto batch = createFuncs.subspan(start, std::min(GetMeshBatchSize(), createFuncs.size() - start));
+		g_meshBuilderInternal.BuildArenas(batch, false);
+		for (size_t i = 0; i < batch.size(); i++)
+			meshes.push_back(UploadStaticMesh(g_meshBuilderInternal.arenas[i]->tmpMesh));
+	}
+	return meshes;
+}
+
+std::vector<DynamicMesh> MeshBuilderPro::CreateDynamicMeshes(std::span<const MeshCreateFunc> createFuncs)
+{
+	SPT_VPROF_BUDGET(__FUNCTION__, VPROF_BUDGETGROUP_MESH_RENDERER);
+	std::vector<DynamicMesh> meshes;
+	meshes.reserve(createFuncs.size());
+	for (size_t start = 0; start < createFuncs.size(); start += GetMeshBatchSize())
+	{
+		auto batch = createFuncs.subspan(start, std::min(GetMeshBatchSize(), createFuncs.size() - start));
+		g_meshBuilderInternal.BuildArenas(batch, true);
+		for (size_t i = 0; i < batch.size(); i++)
+			meshes.push_back(CopyArenaToDynamicMesh(g_meshBuilderInternal.arenas[i]->tmpMesh));
+	}
+	return meshes;
+}
+
 DynamicMesh MeshBuilderPro::CreateDynamicMesh(const MeshCreateFunc& createFunc)
 {
 	SPT_VPROF_BUDGET(__FUNCTION__, VPROF_BUDGETGROUP_MESH_RENDERER);
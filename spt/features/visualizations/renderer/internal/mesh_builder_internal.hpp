@@ -9,6 +9,7 @@
 #ifdef SPT_MESH_RENDERING_ENABLED
 
 #include <forward_list>
+#include <memory>
 
 /*
 * For lack of a better place, the life cycle of meshes is described here. Grab a cookie and make some tea.
@@ -172,13 +173,15 @@ struct MeshComponent
 
 struct MeshBuilderInternal
 {
+	struct SimpleLists
+	{
+		std::array<std::vector<VertexData>, MAX_SIMPLE_COMPONENTS> verts;
+		std::array<std::vector<VertIndex>, MAX_SIMPLE_COMPONENTS> indices;
+	};
+
 	struct
 	{
-		struct
-		{
-			std::array<std::vector<VertexData>, MAX_SIMPLE_COMPONENTS> verts;
-			std::array<std::vector<VertIndex>, MAX_SIMPLE_COMPONENTS> indices;
-		} simple;
+		SimpleLists simple;
 
 		/*struct
 		{
@@ -196,15 +199,44 @@ struct MeshBuilderInternal
 		std::vector<MeshVertData> components;
 		size_t maxVerts, maxIndices;
 
+		// sets up the components at the end of the given lists, must be done on the main thread (material refs)
+		void Begin(bool dynamic, SimpleLists& lists);
+		// lets the user fill the components, can be done on any thread
+		void Fill(const MeshCreateFunc& createFunc);
+
+		// Begin + Fill with the shared lists
 		void Create(const MeshCreateFunc& createFunc, bool dynamic);
+
 		MeshPositionInfo CalcPosInfo();
 	} tmpMesh;
 
+	// the tmp mesh that the delegate on this thread is filling
+	static inline thread_local TmpMesh* curTmpMesh = nullptr;
+
+	/*
+	* Meshes that are built in parallel each get their own arena so that the create funcs can run on the thread
+	* pool. Once all the create funcs in a batch are done, the arenas are uploaded as static meshes or copied to
+	* the shared lists as dynamic meshes on the main thread. The arenas are kept around to reuse their memory.
+	*/
+	struct MeshVertArena
+	{
+		SimpleLists lists;
+		TmpMesh tmpMesh;
+	};
+
+	std::vector<std::unique_ptr<MeshVertArena>> arenas;
+
+	/*
+	* Fills arenas [0, createFuncs.size()) with the create funcs. Each arena must then be uploaded or copied to the
+	* shared lists, which pops its components so that it can be reused.
+	*/
+	void BuildArenas(std::span<const MeshCreateFunc> createFuncs, bool dynamic);
+
 	VectorStack<DynamicMeshUnit> dynamicMeshUnits;
 
 	inline MeshVertData& GetSimpleMeshComponent(MeshPrimitiveType type, MeshMaterialSimple material)
 	{
-		return tmpMesh.components[SIMPLE_COMPONENT_INDEX(type, material)];
+		return curTmpMesh->components[SIMPLE_COMPONENT_INDEX(type, material)];
 	}
 
 	struct Fuser
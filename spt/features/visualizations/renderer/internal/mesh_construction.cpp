@@ -84,8 +84,8 @@
 * precalculated, and MVD_OVERFLOWED(...) may return false even if any of the called functions failed.
 */
 
-#define _MVD_MAX_VERTS g_meshBuilderInternal.tmpMesh.maxVerts
-#define _MVD_MAX_INDICES g_meshBuilderInternal.tmpMesh.maxIndices
+#define _MVD_MAX_VERTS MeshBuilderInternal::curTmpMesh->maxVerts
+#define _MVD_MAX_INDICES MeshBuilderInternal::curTmpMesh->maxIndices
 
 // save how many verts/indices we have
 #define MVD_CHECKPOINT(mvd) \
@@ -578,10 +578,11 @@ static bool MvdAddSubdivCube(MeshVertData& vdf, MeshVertData& vdl, int nSubdivis
 	return true;
 }
 
+// meshes may be built on multiple threads, each thread gets its own scratch buffer
 static Vector* Scratch(size_t n)
 {
-	static std::unique_ptr<Vector[]> scratch = nullptr;
-	static size_t count = 0;
+	static thread_local std::unique_ptr<Vector[]> scratch = nullptr;
+	static thread_local size_t count = 0;
 	if (count < n)
 	{
 		count = SmallestPowerOfTwoGreaterOrEqual(n);
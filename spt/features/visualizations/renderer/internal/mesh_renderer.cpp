@@ -47,7 +47,8 @@ ConVar y_spt_draw_mesh_debug(
     "   - yellow: dynamic mesh with a callback\n"
     "   - red cross: the position metric to a translucent mesh, used to determine the render order\n"
     "   - green: fused opaque dynamic meshes (only available with a cvar value of 2)\n"
-    "   - light green: fused translucent dynamic meshes (only available with a cvar value of 2)");
+    "   - light green: fused translucent dynamic meshes (only available with a cvar value of 2)\n"
+    "The number of culled and drawn meshes is shown in the mesh section of the dev menu.");
 
 CON_COMMAND_F(y_spt_destroy_all_static_meshes,
               "Destroy all static meshes created with the mesh builder, used for debugging",
@@ -166,6 +167,13 @@ void MeshRendererFeature::ImGuiCallback()
 	    "Draw AABB for meshes & fused meshes",
 	};
 	SptImGui::CvarCombo(y_spt_draw_mesh_debug, "##draw_mesh_debug", opts, ARRAYSIZE(opts));
+
+	if (y_spt_draw_mesh_debug.GetBool())
+	{
+		auto& stats = g_meshRendererInternal.lastFrameCullStats;
+		ImGui::Text("Last frame: %u views, %u drawn, %u culled", stats.nViews, stats.nVisible, stats.nCulled);
+		ImGui::TextDisabled("(%u BVH node tests, %u mesh unit tests)", stats.nNodeTests, stats.nUnitTests);
+	}
 }
 
 int MeshRendererFeature::CurrentPortalRenderDepth() const
@@ -244,48 +252,38 @@ MeshUnitWrapper::MeshUnitWrapper(const std::shared_ptr<StaticMeshUnit>& staticMe
 {
 }
 
-// returns true if this unit should be rendered
-bool MeshUnitWrapper::ApplyCallbackAndCalcCamDist()
+// returns false if the callback wants to skip rendering, otherwise updates posInfo for the current view
+bool MeshUnitWrapper::ApplyCallback()
 {
-	auto& viewInfo = g_meshRendererInternal.viewInfo;
-
-	if (callback)
-	{
-		// apply callback
-
-		const MeshPositionInfo& unitPosInfo =
-		    _staticMeshPtr ? _staticMeshPtr->posInfo
-		                   : g_meshBuilderInternal.GetDynamicMeshFromToken(_dynamicToken).posInfo;
-
-		CallbackInfoIn infoIn = {
-		    *viewInfo.viewSetup,
-		    unitPosInfo,
-		    spt_meshRenderer.CurrentPortalRenderDepth(),
-		    spt_overlay.renderingOverlay,
-		};
-
-		callback(infoIn, cbInfoOut = CallbackInfoOut{});
-
-		if (cbInfoOut.skipRender || cbInfoOut.colorModulate.a == 0)
-			return false;
-		TransformAABB(cbInfoOut.mat, unitPosInfo.mins, unitPosInfo.maxs, posInfo.mins, posInfo.maxs);
-	}
-
-	// do frustum check
+	if (!callback)
+		return true;
+
+	const MeshPositionInfo& unitPosInfo = _staticMeshPtr
+	                                          ? _staticMeshPtr->posInfo
+	                                          : g_meshBuilderInternal.GetDynamicMeshFromToken(_dynamicToken).posInfo;
+
+	CallbackInfoIn infoIn = {
+	    *g_meshRendererInternal.viewInfo.viewSetup,
+	    unitPosInfo,
+	    spt_meshRenderer.CurrentPortalRenderDepth(),
+	    spt_overlay.renderingOverlay,
+	};
 
-	auto& frustum = g_meshRendererInternal.viewInfo.frustum;
-	for (int i = 0; i < 6; i++)
-		if (BoxOnPlaneSide((float*)&posInfo.mins, (float*)&posInfo.maxs, &frustum[i]) == 2)
-			return false;
+	callback(infoIn, cbInfoOut = CallbackInfoOut{});
 
-	// calc camera to mesh "distance"
+	if (cbInfoOut.skipRender || cbInfoOut.colorModulate.a == 0)
+		return false;
+	TransformAABB(cbInfoOut.mat, unitPosInfo.mins, unitPosInfo.maxs, posInfo.mins, posInfo.maxs);
+	return true;
+}
 
+void MeshUnitWrapper::CalcCamDist()
+{
+	auto& viewInfo = g_meshRendererInternal.viewInfo;
 	CalcClosestPointOnAABB(posInfo.mins, posInfo.maxs, viewInfo.viewSetup->origin, camDistSqrTo);
 	if (viewInfo.viewSetup->origin == camDistSqrTo)
 		camDistSqrTo = (posInfo.mins + posInfo.maxs) / 2.f; // if inside cube, use center idfk
 	camDistSqr = viewInfo.viewSetup->origin.DistToSqr(camDistSqrTo);
-
-	return true;
 }
 
 // We pretend this mesh wrapper contains a mesh from this unit, but it could be a fused mesh.
@@ -318,11 +316,150 @@ void MeshUnitWrapper::Render(const IMeshWrapper mw)
 		context->PopMatrix();
 }
 
+/**************************************** MESH UNIT BVH ****************************************/
+
+void MeshUnitBvh::Clear()
+{
+	nodes.clear();
+	unitIdxs.clear();
+	callbackUnitIdxs.clear();
+}
+
+void MeshUnitBvh::Build(std::span<const MeshUnitWrapper> units)
+{
+	SPT_VPROF_BUDGET(__FUNCTION__, VPROF_BUDGETGROUP_MESH_RENDERER);
+	Clear();
+	centers.resize(units.size());
+	for (uint32_t i = 0; i < units.size(); i++)
+	{
+		if (units[i].callback)
+		{
+			callbackUnitIdxs.push_back(i);
+		}
+		else
+		{
+			unitIdxs.push_back(i);
+			centers[i] = (units[i].posInfo.mins + units[i].posInfo.maxs) / 2.f;
+		}
+	}
+	if (!unitIdxs.empty())
+	{
+		nodes.reserve(unitIdxs.size() / MAX_LEAF_UNITS * 2 + 1);
+		BuildRecursive(units, 0, unitIdxs.size());
+	}
+}
+
+uint32_t MeshUnitBvh::BuildRecursive(std::span<const MeshUnitWrapper> units, uint32_t start, uint32_t count)
+{
+	uint32_t nodeIdx = nodes.size();
+	Node& node = nodes.emplace_back(Node{{INFINITY}, {-INFINITY}, start, count, 0});
+
+	Vector centerMins{INFINITY}, centerMaxs{-INFINITY};
+	for (uint32_t i = start; i < start + count; i++)
+	{
+		const MeshPositionInfo& posInfo = units[unitIdxs[i]].posInfo;
+		VectorMin(posInfo.mins, node.mins, node.mins);
+		VectorMax(posInfo.maxs, node.maxs, node.maxs);
+		VectorMin(centers[unitIdxs[i]], centerMins, centerMins);
+		VectorMax(centers[unitIdxs[i]], centerMaxs, centerMaxs);
+	}
+	if (count <= MAX_LEAF_UNITS)
+		return nodeIdx;
+
+	// median split along the axis with the most spread
+	Vector extent = centerMaxs - centerMins;
+	int axis = extent.x > extent.y ? (extent.x > extent.z ? 0 : 2) : (extent.y > extent.z ? 1 : 2);
+	auto first = unitIdxs.begin() + start;
+	std::nth_element(first,
+	                 first + count / 2,
+	                 first + count,
+	                 [this, axis](uint32_t a, uint32_t b) { return centers[a][axis] < centers[b][axis]; });
+
+	BuildRecursive(units, start, count / 2);
+	uint32_t rightIdx = BuildRecursive(units, start + count / 2, count - count / 2);
+	nodes[nodeIdx].rightIdx = rightIdx; // node ref may be invalidated by the recursion
+	return nodeIdx;
+}
+
+template<typename F>
+void MeshUnitBvh::Cull(std::span<const MeshUnitWrapper> units,
+                       const cplane_t (&frustum)[FRUSTUM_NUMPLANES],
+                       CullStats& stats,
+                       F visibleFunc) const
+{
+	// returns the new plane mask or 0 if the box is fully in, UINT32_MAX if the box is fully out
+	auto testBox = [&frustum](const Vector& mins, const Vector& maxs, uint32_t planeMask)
+	{
+		for (int i = 0; i < FRUSTUM_NUMPLANES; i++)
+		{
+			if (!(planeMask & (1 << i)))
+				continue;
+			int side = BoxOnPlaneSide((float*)&mins, (float*)&maxs, &frustum[i]);
+			if (side == 2)
+				return UINT32_MAX;
+			if (side == 1)
+				planeMask &= ~(1 << i);
+		}
+		return planeMask;
+	};
+
+	if (nodes.empty())
+		return;
+
+	cullStack.clear();
+	cullStack.push_back({0, ALL_PLANES});
+
+	while (!cullStack.empty())
+	{
+		CullStackEntry entry = cullStack.back();
+		cullStack.pop_back();
+		const Node& node = nodes[entry.nodeIdx];
+
+		stats.nNodeTests++;
+		uint32_t planeMask = testBox(node.mins, node.maxs, entry.planeMask);
+		if (planeMask == UINT32_MAX)
+		{
+			stats.nCulled += node.count;
+			continue;
+		}
+		if (planeMask == 0)
+		{
+			for (uint32_t i = node.start; i < node.start + node.count; i++)
+				visibleFunc(unitIdxs[i]);
+			stats.nVisible += node.count;
+			continue;
+		}
+		if (node.rightIdx == 0)
+		{
+			// leaf that straddles a plane, test the units individually
+			for (uint32_t i = node.start; i < node.start + node.count; i++)
+			{
+				const MeshPositionInfo& posInfo = units[unitIdxs[i]].posInfo;
+				stats.nUnitTests++;
+				if (testBox(posInfo.mins, posInfo.maxs, planeMask) == UINT32_MAX)
+				{
+					stats.nCulled++;
+				}
+				else
+				{
+					visibleFunc(unitIdxs[i]);
+					stats.nVisible++;
+				}
+			}
+			continue;
+		}
+		cullStack.push_back({node.rightIdx, planeMask});
+		cullStack.push_back({entry.nodeIdx + 1, planeMask});
+	}
+}
+
 /**************************************** MESH RENDER FEATURE ****************************************/
 
 void MeshRendererInternal::FrameCleanup()
 {
 	queuedUnitWrappers.clear();
+	unitBvh.Clear();
+	visibleUnitIdxs.clear();
 	g_meshBuilderInternal.FrameCleanup();
 	Assert(debugMeshInfo.descriptionSlices.empty());
 }
@@ -339,6 +476,11 @@ void MeshRendererInternal::OnRenderViewPre_Signal(void* thisptr, CViewSetup* cam
 	MeshRendererDelegate renderDelgate{};
 	spt_meshRenderer.signal(renderDelgate);
 	inSignal = false;
+	// nothing can be queued after the signal, so the same tree is used for every view this frame
+	unitBvh.Build(queuedUnitWrappers);
+	lastFrameCullStats = curFrameCullStats;
+	curFrameCullStats = {};
+	translucentCullStats = {};
 }
 
 void MeshRendererInternal::SetupViewInfo(CRendering3dView* rendering3dView)
@@ -367,6 +509,8 @@ void MeshRendererInternal::OnDrawOpaques(CRendering3dView* renderingView)
 	SPT_VPROF_BUDGET(__FUNCTION__, VPROF_BUDGETGROUP_MESH_RENDERER);
 	SetupViewInfo(renderingView);
 
+	curFrameCullStats.nViews++;
+
 	// push a new debug slice, the corresponding pop is at the end of DrawTranslucents
 	debugMeshInfo.descriptionSlices.emplace(debugMeshInfo.sharedDescriptionList);
 
@@ -431,10 +575,44 @@ void MeshRendererInternal::CollectRenderableComponents(std::vector<MeshComponent
 {
 	SPT_VPROF_BUDGET(__FUNCTION__, VPROF_BUDGETGROUP_MESH_RENDERER);
 	// go through all components of all queued meshes and return those that are eligable for rendering right now
-	for (MeshUnitWrapper& unitWrapper : queuedUnitWrappers)
+
+	MeshUnitBvh::CullStats& stats = opaques ? curFrameCullStats : translucentCullStats;
+
+	unitBvh.Cull(queuedUnitWrappers,
+	             viewInfo.frustum,
+	             stats,
+	             [this](uint32_t idx) { visibleUnitIdxs.push_back(idx); });
+
+	for (uint32_t idx : unitBvh.callbackUnitIdxs)
+	{
+		MeshUnitWrapper& unitWrapper = queuedUnitWrappers[idx];
+		if (!unitWrapper.ApplyCallback())
+			continue; // the user wants to skip rendering
+		stats.nUnitTests++;
+		bool culled = false;
+		for (int i = 0; i < FRUSTUM_NUMPLANES && !culled; i++)
+		{
+			culled = BoxOnPlaneSide((float*)&unitWrapper.posInfo.mins,
+			                        (float*)&unitWrapper.posInfo.maxs,
+			                        &viewInfo.frustum[i])
+			         == 2;
+		}
+		if (culled)
+		{
+			stats.nCulled++;
+			continue;
+		}
+		stats.nVisible++;
+		visibleUnitIdxs.push_back(idx);
+	}
+
+	// keep the queue order so that the render order doesn't depend on the tree layout
+	std::ranges::sort(visibleUnitIdxs);
+
+	for (uint32_t idx : visibleUnitIdxs)
 	{
-		if (!unitWrapper.ApplyCallbackAndCalcCamDist())
-			continue; // the mesh is outside our frustum or the user wants to skip rendering
+		MeshUnitWrapper& unitWrapper = queuedUnitWrappers[idx];
+		unitWrapper.CalcCamDist();
 
 		if (unitWrapper.callback && opaques && unitWrapper.cbInfoOut.colorModulate.a < 1)
 			continue; // color modulation forces all meshes in this unit to be translucent
@@ -469,6 +647,7 @@ void MeshRendererInternal::CollectRenderableComponents(std::vector<MeshComponent
 					components.emplace_back(&unitWrapper, &vData, IMeshWrapper{});
 		}
 	}
+	visibleUnitIdxs.clear();
 }
 
 void MeshRendererInternal::AddDebugCrosses(DebugDescList& debugList, std::span<const MeshComponent> span)
@@ -27,17 +27,82 @@ struct MeshUnitWrapper
 
 	MeshUnitWrapper(const std::shared_ptr<StaticMeshUnit>& staticMeshPtr, const RenderCallback& callback = nullptr);
 
-	// returns true if this unit should be rendered
-	bool ApplyCallbackAndCalcCamDist();
+	// returns false if the callback wants to skip rendering, otherwise updates posInfo for the current view
+	bool ApplyCallback();
+	void CalcCamDist();
 
 	// We pretend this mesh wrapper contains a mesh from this unit, but it could be a fused mesh.
 	// All that matters is that we use its material and our callback.
 	void Render(const IMeshWrapper mw);
 };
 
+/*
+* A bounding volume hierarchy over the queued mesh units. Units without a callback have the same AABB in every
+* view, so the tree is built once per frame right after the render signal and shared between the main view and
+* all portal/overlay views. Units with a callback can move their mesh depending on the view, those are kept in a
+* separate list and are frustum tested individually after their callback is applied.
+* 
+* The nodes are stored in depth-first order so the units under any node are a contiguous range of unitIdxs; the
+* left child of an internal node is always the next node.
+*/
+struct MeshUnitBvh
+{
+	static constexpr uint32_t MAX_LEAF_UNITS = 4;
+	static constexpr uint32_t ALL_PLANES = (1 << FRUSTUM_NUMPLANES) - 1;
+
+	struct Node
+	{
+		Vector mins, maxs;
+		uint32_t start, count; // range in unitIdxs
+		uint32_t rightIdx;     // 0 for leaves
+	};
+
+	struct CullStats
+	{
+		uint32_t nViews, nUnitTests, nNodeTests, nCulled, nVisible;
+	};
+
+	std::vector<Node> nodes;
+	std::vector<uint32_t> unitIdxs;
+	std::vector<uint32_t> callbackUnitIdxs;
+
+	void Build(std::span<const MeshUnitWrapper> units);
+	void Clear();
+
+	// calls visibleFunc with the index of every unit without a callback that is (at least partially) in the frustum
+	template<typename F>
+	void Cull(std::span<const MeshUnitWrapper> units,
+	          const cplane_t (&frustum)[FRUSTUM_NUMPLANES],
+	          CullStats& stats,
+	          F visibleFunc) const;
+
+private:
+	/*
+	* Each cull stack entry keeps track of which planes still need to be tested. If a node is completely in front of
+	* a plane then so are its children, and if a node is in front of all the planes then all of the units under it
+	* are visible without any more tests.
+	*/
+	struct CullStackEntry
+	{
+		uint32_t nodeIdx, planeMask;
+	};
+
+	std::vector<Vector> centers; // scratch space for the build
+	// scratch space for culling, the tree is usually shallow but nothing stops a degenerate one from being deep
+	mutable std::vector<CullStackEntry> cullStack;
+
+	uint32_t BuildRecursive(std::span<const MeshUnitWrapper> units, uint32_t start, uint32_t count);
+};
+
 struct MeshRendererInternal
 {
 	std::vector<MeshUnitWrapper> queuedUnitWrappers;
+	MeshUnitBvh unitBvh;
+	MeshUnitBvh::CullStats curFrameCullStats{}, lastFrameCullStats{};
+	// the same units are culled again in the translucent pass, these only get counted once per view
+	MeshUnitBvh::CullStats translucentCullStats{};
+	// scratch space for CollectRenderableComponents()
+	std::vector<uint32_t> visibleUnitIdxs;
 
 	struct
 	{
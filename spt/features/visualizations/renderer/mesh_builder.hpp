@@ -231,6 +231,15 @@ public:
 	DynamicMesh CreateDynamicMesh(const MeshCreateFunc& createFunc);
 	StaticMesh CreateStaticMesh(const MeshCreateFunc& createFunc);
 
+	/*
+	* Same as above, but the create funcs are run in parallel on the thread pool and only the IMesh* creation
+	* happens on this thread. The create funcs must be safe to run at the same time, so they can't touch any
+	* shared state (static scratch buffers, game state that might change, etc.). The meshes are returned in the
+	* same order as the create funcs.
+	*/
+	std::vector<DynamicMesh> CreateDynamicMeshes(std::span<const MeshCreateFunc> createFuncs);
+	std::vector<StaticMesh> CreateStaticMeshes(std::span<const MeshCreateFunc> createFuncs);
+
 	/*
 	* For large meshes that might fill up, the only solution to gracefully keep going is to have
 	* a nested loop: one inside the create func and one outside. When the loop inside exits
@@ -0,0 +1,577 @@
+#include "stdafx.hpp"
+
+#include "worldsize.h"
+
+#include "renderer\mesh_renderer.hpp"
+#include "spt\features\tracing.hpp"
+
+#if defined(SPT_MESH_RENDERING_ENABLED) && defined(SPT_TRACE_PORTAL_ENABLED)
+
+#include <algorithm>
+#include <chrono>
+#include <stack>
+#include <unordered_set>
+
+#include "spt\feature.hpp"
+#include "spt\utils\ent_utils.hpp"
+#include "spt\utils\math.hpp"
+#include "spt\utils\portal_utils.hpp"
+#include "spt\utils\interfaces.hpp"
+#include "imgui\imgui_interface.hpp"
+
+#undef min
+#undef max
+
+ConVar spt_seam_finder("spt_seam_finder",
+                       "0",
+                       FCVAR_CHEAT | FCVAR_DONTRECORD,
+                       "Searches the brush edges around the crosshair for seamshots from the current position and draws the ones it finds in green. Use spt_seam_finder_list to see them.");
+ConVar spt_seam_finder_radius("spt_seam_finder_radius",
+                              "256",
+                              FCVAR_CHEAT | FCVAR_DONTRECORD,
+                              "Edges within this distance of the crosshair are searched by spt_seam_finder.");
+ConVar spt_seam_finder_spacing("spt_seam_finder_spacing",
+                               "1",
+                               FCVAR_CHEAT | FCVAR_DONTRECORD,
+                               "The distance between the points that spt_seam_finder tries along each edge.",
+                               true,
+                               0.05f,
+                               false,
+                               0);
+ConVar spt_seam_finder_ms_per_frame("spt_seam_finder_ms_per_frame",
+                                    "2",
+                                    FCVAR_DONTRECORD,
+                                    "How many milliseconds to spend per frame on spt_seam_finder.");
+
+// searches from this many positions are kept, looking around from one of them again doesn't start over
+#define MAX_CACHED_SEARCHES 8
+// the points on an edge tried between two checks of the time budget
+#define SEAM_BATCH_SIZE 16
+// how far past the seam a trace has to go to count, same as spt_find_seam_shot
+#define SEAM_MIN_OVERSHOOT 50.0f
+// how far from an edge to look for the brush that forms the seam with it
+#define SEAM_PROBE_DIST 0.5f
+
+/*
+* Looks for seamshots along the edges of world brushes. The brushes near the crosshair are found through the
+* collision bsp and cut into polyhedra, every edge where one of the faces is covered by another brush (a concave
+* corner between two brushes) gets a row of points along it. A point is a seamshot if a portal trace from the camera
+* to just outside either face ends up inside the brush or goes on well past the seam. Each frame
+* a few batches of points are tried, the closest edges first, and all results are kept per map and camera
+* position so looking around from the same spot only searches the edges that haven't been seen yet.
+*/
+class SeamFinderFeature : public FeatureWrapper<SeamFinderFeature>
+{
+public:
+	struct SeamShot
+	{
+		QAngle angle;
+		Vector pos;
+		// how far the trace went past the seam
+		float overshoot;
+		// the part of the edge that seamshots were found on
+		Vector passStart, passEnd;
+	};
+
+	// the seamshots found from the current position, the ones closest to the current view angles first
+	std::vector<SeamShot> GetRankedSeamShots();
+	void GetProgress(size_t& nDone, size_t& nEdges);
+
+protected:
+	void LoadFeature() override;
+	void UnloadFeature() override
+	{
+		searches.clear();
+	}
+
+private:
+	struct Edge
+	{
+		Vector a, b;
+		Vector n1, n2;
+		float d1, d2;
+		float distSqr;
+		int nSamples;
+		int nextSample;
+		bool found;
+		SeamShot best;
+	};
+
+	struct Search
+	{
+		std::string mapName;
+		Vector cameraPos;
+		uint32_t lastUsed;
+		std::vector<Edge> edges;
+		// edges that still have points to try, the closest one is at the back
+		std::vector<size_t> pending;
+		std::vector<Vector> regions;
+		// brush index << 32 | line index, the parts of a brush outside one region can be added by the next
+		std::unordered_set<uint64_t> edgesAdded;
+	};
+
+	std::vector<Search> searches;
+	uint32_t frameCount = 0;
+
+	void OnMeshRenderSignal(MeshRendererDelegate& mr);
+	Search* GetSearch(const char* mapName, const Vector& cameraPos);
+	Search* FindSearch(const Vector& cameraPos);
+	void AddRegion(Search& search, const CCollisionBSPData* bspData, const Vector& center, float radius);
+	void AddBrushEdges(Search& search,
+	                   const CCollisionBSPData* bspData,
+	                   int brushIdx,
+	                   const Vector& center,
+	                   float radius);
+	bool TestPoint(const Search& search, const Edge& edge, const Vector& point, SeamShot& out);
+	void RunBatches(Search& search, float msBudget);
+};
+
+static SeamFinderFeature spt_seam_finder_feat;
+
+static bool BrushContainsPoint(const CCollisionBSPData* bspData, const cbrush_t* brush, const Vector& point)
+{
+	if (brush->IsBox())
+	{
+		const cboxbrush_t* box = &bspData->map_boxbrushes[brush->GetBox()];
+		for (int i = 0; i < 3; i++)
+			if (point[i] < box->mins[i] || point[i] > box->maxs[i])
+				return false;
+		return true;
+	}
+	for (int i = 0; i < brush->numsides; i++)
+	{
+		const cbrushside_t* side = &bspData->map_brushsides[brush->firstbrushside + i];
+		if (side->plane->normal.Dot(point) - side->plane->dist > 0)
+			return false;
+	}
+	return true;
+}
+
+// is the point inside a portal blocking world brush other than skipBrushIdx
+static bool PointInOtherBrush(const CCollisionBSPData* bspData, const Vector& point, int skipBrushIdx)
+{
+	int curr = bspData->map_cmodels[0].headnode;
+	while (curr >= 0)
+	{
+		const cnode_t& node = bspData->map_nodes[curr];
+		curr = node.children[node.plane->normal.Dot(point) - node.plane->dist >= 0 ? 0 : 1];
+	}
+	const cleaf_t& leaf = bspData->map_leafs[-1 - curr];
+	for (int i = 0; i < leaf.numleafbrushes; i++)
+	{
+		unsigned short brushIdx = bspData->map_leafbrushes[leaf.firstleafbrush + i];
+		const cbrush_t* brush = &bspData->map_brushes[brushIdx];
+		if (brushIdx != skipBrushIdx && (brush->contents & MASK_SHOT_PORTAL)
+		    && BrushContainsPoint(bspData, brush, point))
+		{
+			return true;
+		}
+	}
+	return false;
+}
+
+static CPolyhedron* CreateBrushPolyhedron(const CCollisionBSPData* bspData, const cbrush_t* brush)
+{
+	static std::vector<VPlane> planes;
+	planes.clear();
+	if (brush->IsBox())
+	{
+		const cboxbrush_t* box = &bspData->map_boxbrushes[brush->GetBox()];
+		for (int i = 0; i < 3; i++)
+		{
+			Vector n{0, 0, 0};
+			n[i] = 1;
+			planes.emplace_back(n, box->maxs[i]);
+			planes.emplace_back(-n, -box->mins[i]);
+		}
+	}
+	else
+	{
+		for (int i = 0; i < brush->numsides; i++)
+		{
+			const cbrushside_t* side = &bspData->map_brushsides[brush->firstbrushside + i];
+			if (side->bBevel)
+				continue;
+			planes.emplace_back(side->plane->normal, side->plane->dist);
+		}
+	}
+	return GeneratePolyhedronFromPlanes((float*)planes.data(), planes.size(), 0.001, true);
+}
+
+SeamFinderFeature::Search* SeamFinderFeature::FindSearch(const Vector& cameraPos)
+{
+	for (auto& search : searches)
+		if (search.cameraPos.DistToSqr(cameraPos) < 0.01f * 0.01f)
+			return &search;
+	return nullptr;
+}
+
+SeamFinderFeature::Search* SeamFinderFeature::GetSearch(const char* mapName, const Vector& cameraPos)
+{
+	// a different map means none of the old results apply
+	if (!searches.empty() && searches.front().mapName != mapName)
+		searches.clear();
+
+	Search* search = FindSearch(cameraPos);
+	if (!search)
+	{
+		if (searches.size() >= MAX_CACHED_SEARCHES)
+		{
+			auto oldest = std::ranges::min_element(searches, {}, &Search::lastUsed);
+			searches.erase(oldest);
+		}
+		search = &searches.emplace_back();
+		search->mapName = mapName;
+		search->cameraPos = cameraPos;
+	}
+	search->lastUsed = frameCount;
+	return search;
+}
+
+void SeamFinderFeature::AddRegion(Search& search, const CCollisionBSPData* bspData, const Vector& center, float radius)
+{
+	search.regions.push_back(center);
+	std::vector<bool> seen(bspData->numbrushes);
+
+	// only go down the sides of the world tree that touch the sphere
+	std::stack<int, std::vector<int>> s;
+	s.push(bspData->map_cmodels[0].headnode);
+	while (!s.empty())
+	{
+		int curr = s.top();
+		s.pop();
+		if (curr >= 0)
+		{
+			const cnode_t& node = bspData->map_nodes[curr];
+			float d = node.plane->normal.Dot(center) - node.plane->dist;
+			if (d > -radius)
+				s.push(node.children[0]);
+			if (d < radius)
+				s.push(node.children[1]);
+			continue;
+		}
+
+		const cleaf_t& leaf = bspData->map_leafs[-1 - curr];
+		for (int i = 0; i < leaf.numleafbrushes; i++)
+		{
+			unsigned short brushIdx = bspData->map_leafbrushes[leaf.firstleafbrush + i];
+			if (seen[brushIdx])
+				continue;
+			seen[brushIdx] = true;
+			if (bspData->map_brushes[brushIdx].contents & MASK_SHOT_PORTAL)
+				AddBrushEdges(search, bspData, brushIdx, center, radius);
+		}
+	}
+
+	// closest to the crosshair gets searched first
+	for (size_t i : search.pending)
+	{
+		Edge& edge = search.edges[i];
+		Vector closest;
+		CalcClosestPointOnLineSegment(center, edge.a, edge.b, closest);
+		edge.distSqr = closest.DistToSqr(center);
+	}
+	std::ranges::sort(search.pending, std::greater{}, [&](size_t i) { return search.edges[i].distSqr; });
+}
+
+void SeamFinderFeature::AddBrushEdges(Search& search,
+                                      const CCollisionBSPData* bspData,
+                                      int brushIdx,
+                                      const Vector& center,
+                                      float radius)
+{
+	CPolyhedron* poly = CreateBrushPolyhedron(bspData, &bspData->map_brushes[brushIdx]);
+	if (!poly)
+		return;
+
+	// every line is shared by two polygons, find the normals of both
+	static std::vector<std::pair<int, int>> linePolys;
+	linePolys.assign(poly->iLineCount, {-1, -1});
+	for (int p = 0; p < poly->iPolygonCount; p++)
+	{
+		const Polyhedron_IndexedPolygon_t& polygon = poly->pPolygons[p];
+		for (int i = 0; i < polygon.iIndexCount; i++)
+		{
+			auto& polys = linePolys[poly->pIndices[polygon.iFirstIndex + i].iLineIndex];
+			(polys.first == -1 ? polys.first : polys.second) = p;
+		}
+	}
+
+	float spacing = spt_seam_finder_spacing.GetFloat();
+	for (int l = 0; l < poly->iLineCount; l++)
+	{
+		auto [p1, p2] = linePolys[l];
+		if (p1 == -1 || p2 == -1 || search.edgesAdded.contains((uint64_t)brushIdx << 32 | l))
+			continue;
+		Edge edge;
+		edge.a = poly->pVertices[poly->pLines[l].iPointIndices[0]];
+		edge.b = poly->pVertices[poly->pLines[l].iPointIndices[1]];
+		edge.n1 = poly->pPolygons[p1].polyNormal;
+		edge.n2 = poly->pPolygons[p2].polyNormal;
+		edge.d1 = edge.n1.Dot(edge.a);
+		edge.d2 = edge.n2.Dot(edge.a);
+
+		// the camera has to see at least one of the faces, and an almost flat edge can't be shot through
+		if (edge.n1.Dot(search.cameraPos) - edge.d1 <= 0 && edge.n2.Dot(search.cameraPos) - edge.d2 <= 0)
+			continue;
+		if (edge.n1.Dot(edge.n2) > 0.999f)
+			continue;
+
+		Vector closest;
+		CalcClosestPointOnLineSegment(center, edge.a, edge.b, closest);
+		edge.distSqr = closest.DistToSqr(center);
+		if (edge.distSqr > radius * radius)
+			continue;
+
+		/*
+		* Only concave corners can be seamshots: another brush has to cover one face right past the edge while the
+		* space in front of the other face stays open. An edge sticking out into the open is a convex corner and a
+		* trace can't slip past it.
+		*/
+		Vector mid = (edge.a + edge.b) * 0.5f;
+		Vector past1 = mid + (edge.n1 - edge.n2) * SEAM_PROBE_DIST;
+		Vector past2 = mid + (edge.n2 - edge.n1) * SEAM_PROBE_DIST;
+		bool covered1 = PointInOtherBrush(bspData, past1, brushIdx);
+		bool covered2 = PointInOtherBrush(bspData, past2, brushIdx);
+		if (covered1 == covered2)
+			continue;
+
+		search.edgesAdded.insert((uint64_t)brushIdx << 32 | l);
+		edge.nSamples = std::max(1, (int)((edge.b - edge.a).Length() / spacing));
+		edge.nextSample = 0;
+		edge.found = false;
+		search.pending.push_back(search.edges.size());
+		search.edges.push_back(edge);
+	}
+	poly->Release();
+}
+
+bool SeamFinderFeature::TestPoint(const Search& search, const Edge& edge, const Vector& point, SeamShot& out)
+{
+	// aim just outside of each face, the trace has to slip between them to end up behind one
+	const float distanceToSeam = 0.01f;
+	const Vector targets[] = {point + edge.n1 * distanceToSeam, point + edge.n2 * distanceToSeam};
+	bool found = false;
+
+	for (const Vector& target : targets)
+	{
+		Vector dir = target - search.cameraPos;
+		float targetDist = dir.NormalizeInPlace();
+
+		trace_t tr;
+		Ray_t ray;
+		ray.Init(search.cameraPos, search.cameraPos + dir * MAX_TRACE_LENGTH);
+		interfaces::engineTraceServer->TraceRay(ray, MASK_SHOT_PORTAL, spt_tracing.GetPortalTraceFilter(), &tr);
+
+		float traceDist = (tr.endpos - tr.startpos).Length();
+		// hit something on the way there
+		if (traceDist < targetDist - 0.1f)
+			continue;
+		// slipped into the brush itself, or went on well past where the corner should have stopped it
+		bool inside = edge.n1.Dot(tr.endpos) - edge.d1 < 0 && edge.n2.Dot(tr.endpos) - edge.d2 < 0;
+		float overshoot = traceDist - targetDist;
+		bool through = tr.fraction == 1.0f || inside || overshoot > SEAM_MIN_OVERSHOOT;
+		if (through && (!found || overshoot > out.overshoot))
+		{
+			found = true;
+			VectorAngles(dir, out.angle);
+			out.angle.x = utils::NormalizeDeg(out.angle.x);
+			out.angle.y = utils::NormalizeDeg(out.angle.y);
+			out.pos = point;
+			out.overshoot = overshoot;
+		}
+	}
+	return found;
+}
+
+void SeamFinderFeature::RunBatches(Search& search, float msBudget)
+{
+	using namespace std::chrono;
+	auto startTime = high_resolution_clock::now();
+
+	// always do at least one batch per frame
+	do
+	{
+		if (search.pending.empty())
+			return;
+		Edge& edge = search.edges[search.pending.back()];
+		int end = std::min(edge.nextSample + SEAM_BATCH_SIZE, edge.nSamples);
+		for (; edge.nextSample < end; edge.nextSample++)
+		{
+			Vector point = edge.a + (edge.b - edge.a) * ((edge.nextSample + 0.5f) / edge.nSamples);
+			SeamShot shot;
+			if (!TestPoint(search, edge, point, shot))
+				continue;
+			if (!edge.found)
+			{
+				edge.best = shot;
+				edge.best.passStart = point;
+			}
+			else if (shot.overshoot > edge.best.overshoot)
+			{
+				Vector passStart = edge.best.passStart;
+				edge.best = shot;
+				edge.best.passStart = passStart;
+			}
+			edge.best.passEnd = point;
+			edge.found = true;
+		}
+		if (edge.nextSample >= edge.nSamples)
+			search.pending.pop_back();
+	} while (duration_cast<microseconds>(high_resolution_clock::now() - startTime).count() / 1000.f < msBudget);
+}
+
+std::vector<SeamFinderFeature::SeamShot> SeamFinderFeature::GetRankedSeamShots()
+{
+	std::vector<SeamShot> shots;
+	Search* search = FindSearch(utils::GetPlayerEyePosition());
+	if (!search)
+		return shots;
+	for (const Edge& edge : search->edges)
+		if (edge.found)
+			shots.push_back(edge.best);
+
+	QAngle viewAngles;
+	interfaces::engine->GetViewAngles(viewAngles);
+	auto angleDist = [&](const SeamShot& shot)
+	{
+		float dx = utils::NormalizeDeg(shot.angle.x - viewAngles.x);
+		float dy = utils::NormalizeDeg(shot.angle.y - viewAngles.y);
+		return dx * dx + dy * dy;
+	};
+	std::ranges::sort(shots, {}, angleDist);
+	return shots;
+}
+
+void SeamFinderFeature::GetProgress(size_t& nDone, size_t& nEdges)
+{
+	nDone = nEdges = 0;
+	Search* search = FindSearch(utils::GetPlayerEyePosition());
+	if (!search)
+		return;
+	nEdges = search->edges.size();
+	nDone = nEdges - search->pending.size();
+}
+
+void SeamFinderFeature::OnMeshRenderSignal(MeshRendererDelegate& mr)
+{
+	if (!spt_seam_finder.GetBool())
+		return;
+	auto player = utils::spt_serverEntList.GetPlayer();
+	if (!player)
+		return;
+	frameCount++;
+
+	// setang wouldn't give the same shot from inside a portal
+	if (utils::GetEnvironmentPortal())
+		return;
+
+	Vector cameraPos = utils::GetPlayerEyePosition();
+	static utils::CachedField<QAngle, "CBasePlayer", "pl.v_angle", true> vangle;
+	Vector dir;
+	AngleVectors(*vangle.GetPtrPlayer(), &dir);
+
+	Ray_t ray;
+	ray.Init(cameraPos, cameraPos + dir * MAX_TRACE_LENGTH);
+	trace_t tr;
+	WorldHitInfo hitInfo =
+	    spt_tracing.TraceLineWithWorldInfoServer(ray, MASK_SHOT_PORTAL, spt_tracing.GetPortalTraceFilter(), tr);
+
+	Search* search = nullptr;
+	if (hitInfo.bspData && !tr.startsolid)
+	{
+		search = GetSearch(hitInfo.bspData->map_name, cameraPos);
+		float radius = spt_seam_finder_radius.GetFloat();
+		// a new region once the crosshair has moved far enough from all of the searched ones
+		bool covered = std::ranges::any_of(search->regions,
+		                                   [&](const Vector& c)
+		                                   { return c.DistToSqr(tr.endpos) < radius * radius / 4; });
+		if (!covered && radius > 0)
+			AddRegion(*search, hitInfo.bspData, tr.endpos, radius);
+	}
+	else
+	{
+		search = FindSearch(cameraPos);
+	}
+	if (!search)
+		return;
+	search->lastUsed = frameCount;
+	RunBatches(*search, spt_seam_finder_ms_per_frame.GetFloat());
+
+	if (std::ranges::none_of(search->edges, &Edge::found))
+		return;
+	mr.DrawMesh(spt_meshBuilder.CreateDynamicMesh(
+	    [search](MeshBuilderDelegate& mb)
+	    {
+		    const color32 green{0, 255, 0, 255};
+		    for (const Edge& edge : search->edges)
+		    {
+			    if (!edge.found)
+				    continue;
+			    mb.AddLine(edge.best.passStart, edge.best.passEnd, {green, false});
+			    mb.AddCross(edge.best.pos, 3, {green, false});
+		    }
+	    }));
+}
+
+CON_COMMAND(spt_seam_finder_list,
+            "Lists the seamshots spt_seam_finder found from the current position, closest to the crosshair first. Usage: spt_seam_finder_list [count]")
+{
+	auto shots = spt_seam_finder_feat.GetRankedSeamShots();
+	size_t count = args.ArgC() > 1 ? (size_t)atoi(args.Arg(1)) : 10;
+	size_t nDone, nEdges;
+	spt_seam_finder_feat.GetProgress(nDone, nEdges);
+	Msg("Searched %u / %u edges, found %u seamshots\n", nDone, nEdges, shots.size());
+	for (size_t i = 0; i < shots.size() && i < count; i++)
+	{
+		Msg("%u: setang %.8f %.8f 0 (at %.2f %.2f %.2f, %.1f units past the seam)\n",
+		    i,
+		    shots[i].angle.x,
+		    shots[i].angle.y,
+		    shots[i].pos.x,
+		    shots[i].pos.y,
+		    shots[i].pos.z,
+		    shots[i].overshoot);
+	}
+}
+
+CON_COMMAND(spt_seam_finder_goto,
+            "Sets the view angles to a seamshot from spt_seam_finder_list. Usage: spt_seam_finder_goto [index]")
+{
+	auto shots = spt_seam_finder_feat.GetRankedSeamShots();
+	size_t i = args.ArgC() > 1 ? (size_t)atoi(args.Arg(1)) : 0;
+	if (i >= shots.size())
+	{
+		Msg("No seamshot with index %u, %u were found\n", i, shots.size());
+		return;
+	}
+	interfaces::engine->SetViewAngles(shots[i].angle);
+}
+
+void SeamFinderFeature::LoadFeature()
+{
+	if (!spt_meshRenderer.signal.Works || !interfaces::engineTraceServer)
+		return;
+	InitConcommandBase(spt_seam_finder);
+	InitConcommandBase(spt_seam_finder_radius);
+	InitConcommandBase(spt_seam_finder_spacing);
+	InitConcommandBase(spt_seam_finder_ms_per_frame);
+	InitCommand(spt_seam_finder_list);
+	InitCommand(spt_seam_finder_goto);
+	spt_meshRenderer.signal.Connect(this, &SeamFinderFeature::OnMeshRenderSignal);
+
+	// the spacing only matters when edges are added, start over so it applies everywhere
+	spt_seam_finder_spacing.InstallChangeCallback([](IConVar*, const char*, auto)
+	                                              { spt_seam_finder_feat.searches.clear(); });
+
+	SptImGuiGroup::Draw_Misc_SeamFinder.RegisterUserCallback(
+	    []()
+	    {
+		    SptImGui::CvarCheckbox(spt_seam_finder, "##checkbox");
+		    size_t nDone, nEdges;
+		    spt_seam_finder_feat.GetProgress(nDone, nEdges);
+		    ImGui::Text("Searched %u / %u edges", nDone, nEdges);
+	    });
+}
+
+#endif
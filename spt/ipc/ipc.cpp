@@ -15,6 +15,7 @@ static bool WINSOCK_INITIALIZED = false;
 static u_long BLOCKING = 1;
 const int BUFLEN = 32767;
 const int MAX_MSG_BUFFER = 256;
+const int SEND_TIMEOUT_SEC = 2;
 
 void CloseSocket(int& socket)
 {
@@ -36,11 +37,68 @@ static bool DataAvailable(int& socket)
 	return result > 0;
 }
 
+// waits until the socket has room in its send buffer, false on timeout or error
+static bool WaitWritable(int socket, std::chrono::steady_clock::duration timeout)
+{
+	auto usec = std::chrono::duration_cast<std::chrono::microseconds>(timeout).count();
+	if (usec <= 0)
+		return false;
+
+	fd_set write;
+	timeval tv;
+	tv.tv_sec = (long)(usec / 1000000);
+	tv.tv_usec = (long)(usec % 1000000);
+
+	FD_ZERO(&write);
+	FD_SET((uint32_t)socket, &write);
+	return select(socket + 1, NULL, &write, NULL, &tv) > 0;
+}
+
+/*
+* Blocks until everything is sent, frames can be much bigger than the socket buffer. Gives up if the other end
+* doesn't read anything for a while so that a stuck peer can't hang the sending thread, the caller closes the socket.
+*/
+static bool SendAll(int socket, const char* data, size_t len)
+{
+	const auto timeout = std::chrono::seconds(SEND_TIMEOUT_SEC);
+	auto lastProgress = std::chrono::steady_clock::now();
+	while (len > 0)
+	{
+		int result = send(socket, data, (int)len, 0);
+		if (result == SOCKET_ERROR)
+		{
+			int error = WSAGetLastError();
+			if (error != WSAEWOULDBLOCK)
+			{
+				Print("Send failed: %d\n", error);
+				return false;
+			}
+			// sleep in select instead of spinning until the client reads some of what's queued up
+			if (!WaitWritable(socket, timeout - (std::chrono::steady_clock::now() - lastProgress)))
+			{
+				Print("Send timed out, the other end hasn't read anything for %d seconds\n", SEND_TIMEOUT_SEC);
+				return false;
+			}
+			continue;
+		}
+
+		lastProgress = std::chrono::steady_clock::now();
+
+		len -= result;
+		data += result;
+	}
+	return true;
+}
+
 ipc::IPCServer::IPCServer()
 {
 	listenSocket = INVALID_SOCKET;
 	clientSocket = INVALID_SOCKET;
 	RECV_BUFFER = new char[BUFLEN];
+	binaryMode = false;
+	connectionId = 0;
+	sendFailed = false;
+	deferredCloseSocket = INVALID_SOCKET;
 }
 
 void ipc::InitWinsock()
@@ -123,12 +181,12 @@ void ipc::IPCServer::CloseConnections()
 	Print("Closing sockets.\n");
 	if (listenSocket != SOCKET_ERROR)
 		CloseSocket(listenSocket);
-	if (clientSocket != SOCKET_ERROR)
-		CloseSocket(clientSocket);
+	CloseClient();
 }
 
 void ipc::IPCServer::Loop()
 {
+	CloseIfSendFailed();
 	CheckForConnections();
 	ReadMessages();
 	DispatchMessages();
@@ -178,27 +236,179 @@ void ipc::IPCServer::SendMsg(const nlohmann::json& msg)
 		return;
 	}
 
+	if (binaryMode)
+	{
+		std::string out = msg.dump();
+		auto& buf = BeginFrame(IPC_FRAME_JSON);
+		buf.insert(buf.end(), out.begin(), out.end());
+		EndFrame();
+		return;
+	}
+
+	// include the null terminator
 	std::string out = msg.dump();
-	const char* string = out.c_str();
+	Send(connectionId, out.c_str(), out.size() + 1);
+	CloseIfSendFailed();
+}
+
+bool ipc::IPCServer::ClientConnected()
+{
+	return clientSocket != SOCKET_ERROR;
+}
+
+bool ipc::IPCServer::BinaryMode()
+{
+	return binaryMode && ClientConnected();
+}
 
-	for (std::size_t i = 0; i <= out.size();)
+std::vector<char>& ipc::IPCServer::BeginFrame(IPCFrameType type)
+{
+	// the length gets filled in by EndFrame()
+	sendBuffer.resize(IPC_FRAME_HEADER_LEN);
+	sendBuffer[4] = (char)type;
+	return sendBuffer;
+}
+
+void ipc::IPCServer::EndFrame()
+{
+	if (clientSocket == SOCKET_ERROR)
+	{
+		Print("No client connected.\n");
+		return;
+	}
+
+	uint32_t len = sendBuffer.size() - IPC_FRAME_HEADER_LEN;
+	memcpy(sendBuffer.data(), &len, sizeof len);
+	Send(connectionId, sendBuffer.data(), sendBuffer.size());
+	CloseIfSendFailed();
+}
+
+uint32_t ipc::IPCServer::GetConnectionId()
+{
+	return connectionId;
+}
+
+bool ipc::IPCServer::SendRaw(uint32_t connId, const char* data, size_t len)
+{
+	// the game thread notices a dead connection the next time it loops
+	return Send(connId, data, len);
+}
+
+bool ipc::IPCServer::Send(uint32_t connId, const char* data, size_t len)
+{
+	{
+		std::lock_guard lk{sendMutex};
+		if (connId != connectionId || clientSocket == SOCKET_ERROR || sendFailed)
+			return false;
+		sendQueue.insert(sendQueue.end(), data, data + len);
+	}
+	FlushSendQueue();
+	return true;
+}
+
+/*
+* Whoever gets the write lock sends everything that's queued up. The other thread only ever tries to take it, so
+* the game thread never waits while the stream thread is stuck sending to a slow client; its data just gets sent
+* by the stream thread once the current write is done (and the other way around).
+*/
+void ipc::IPCServer::FlushSendQueue()
+{
+	std::vector<char> batch;
+	while (true)
 	{
-		int result = send(clientSocket, string, out.size() - i + 1, 0);
-		if (result == SOCKET_ERROR)
 		{
-			Print("Send failed: %d\n", WSAGetLastError());
-			CloseSocket(clientSocket);
-			return;
+			std::unique_lock wlk{writeMutex, std::try_to_lock};
+			if (!wlk)
+				return;
+
+			int socket;
+			{
+				std::lock_guard lk{sendMutex};
+				batch.swap(sendQueue);
+				socket = clientSocket;
+			}
+
+			bool ok = batch.empty() || SendAll(socket, batch.data(), batch.size());
+			batch.clear();
+
+			std::lock_guard lk{sendMutex};
+			if (deferredCloseSocket != INVALID_SOCKET)
+			{
+				CloseSocket(deferredCloseSocket);
+			}
+			else if (!ok)
+			{
+				sendFailed = true;
+				sendQueue.clear();
+			}
 		}
 
-		i += result;
-		string += result;
+		// check after letting go of the write lock, anything queued after this gets sent by the thread that queued it
+		std::lock_guard lk{sendMutex};
+		if (sendQueue.empty())
+			return;
 	}
 }
 
-bool ipc::IPCServer::ClientConnected()
+void ipc::IPCServer::CloseClient()
 {
-	return clientSocket != SOCKET_ERROR;
+	std::lock_guard lk{sendMutex};
+	sendQueue.clear();
+	sendFailed = false;
+	if (clientSocket == SOCKET_ERROR)
+		return;
+
+	std::unique_lock wlk{writeMutex, std::try_to_lock};
+	if (wlk)
+	{
+		CloseSocket(clientSocket);
+	}
+	else
+	{
+		// the other thread is in the middle of a send, make it fail right away and let it close the socket
+		shutdown(clientSocket, SD_BOTH);
+		deferredCloseSocket = clientSocket;
+		clientSocket = INVALID_SOCKET;
+	}
+}
+
+void ipc::IPCServer::CloseIfSendFailed()
+{
+	bool failed;
+	{
+		std::lock_guard lk{sendMutex};
+		failed = sendFailed;
+	}
+	if (failed)
+	{
+		Print("Sending to the client failed, closing socket.\n");
+		CloseClient();
+	}
+}
+
+bool ipc::IPCServer::MarkSchemaSent(uint32_t schemaId)
+{
+	return sentSchemas.insert(schemaId).second;
+}
+
+void ipc::IPCServer::StartBinaryMode(const nlohmann::json& msg)
+{
+	nlohmann::json ack;
+	ack["type"] = "binary_ack";
+	ack["version"] = IPC_BINARY_VERSION;
+
+	auto version = msg.find("version");
+	if (version == msg.end() || !version->is_number_integer() || version->get<int>() != IPC_BINARY_VERSION)
+	{
+		ack["error"] = "unsupported version";
+		SendMsg(ack);
+		return;
+	}
+
+	// the ack is the last null terminated message
+	SendMsg(ack);
+	binaryMode = true;
+	sentSchemas.clear();
 }
 
 ipc::IPCServer::~IPCServer()
@@ -226,7 +436,7 @@ void ipc::IPCServer::ReadMessages()
 		}
 		else if (result == 0)
 		{
-			CloseSocket(clientSocket);
+			CloseClient();
 			Print("Client disconnected, closing socket.\n");
 			return;
 		}
@@ -236,7 +446,7 @@ void ipc::IPCServer::ReadMessages()
 
 			if (error != WSAEWOULDBLOCK && error != WSAECONNREFUSED)
 			{
-				CloseSocket(clientSocket);
+				CloseClient();
 				Print("Client disconnected, closing socket.\n");
 				return;
 			}
@@ -260,7 +470,11 @@ void ipc::IPCServer::ReadMessages()
 				{
 					std::string type = msg["type"];
 
-					if (callbacks.find(type) == callbacks.end())
+					if (type == "binary_hello")
+					{
+						StartBinaryMode(msg);
+					}
+					else if (callbacks.find(type) == callbacks.end())
 					{
 						Print("No callback for message type %s\n", type.c_str());
 					}
@@ -321,8 +535,8 @@ void ipc::IPCServer::CheckForConnections()
 	}
 
 	// Accept a client socket
-	clientSocket = accept(listenSocket, NULL, NULL);
-	if (clientSocket == INVALID_SOCKET)
+	int newSocket = accept(listenSocket, NULL, NULL);
+	if (newSocket == INVALID_SOCKET)
 	{
 		int error = WSAGetLastError();
 		if (error == WSAEWOULDBLOCK || error == WSAECONNREFUSED)
@@ -336,7 +550,14 @@ void ipc::IPCServer::CheckForConnections()
 	}
 
 	Print("Got client\n");
-	ioctlsocket(clientSocket, FIONBIO, &BLOCKING);
+	ioctlsocket(newSocket, FIONBIO, &BLOCKING);
+	binaryMode = false;
+	sentSchemas.clear();
+	std::lock_guard lk{sendMutex};
+	clientSocket = newSocket;
+	connectionId++;
+	sendQueue.clear();
+	sendFailed = false;
 }
 
 void ipc::IPCServer::DispatchMessages()
@@ -366,6 +587,136 @@ void ipc::IPCServer::DispatchMessages(const std::string& type)
 	vec.clear();
 }
 
+ipc::IPCClient::IPCClient()
+{
+	serverSocket = INVALID_SOCKET;
+}
+
+bool ipc::IPCClient::Connect(const char* port)
+{
+	if (serverSocket != INVALID_SOCKET)
+	{
+		Print("Already connected!\n");
+		return false;
+	}
+
+	struct addrinfo *result = NULL, hints;
+
+	ZeroMemory(&hints, sizeof(hints));
+	hints.ai_family = AF_INET;
+	hints.ai_socktype = SOCK_STREAM;
+	hints.ai_protocol = IPPROTO_TCP;
+
+	int iResult = getaddrinfo("127.0.0.1", port, &hints, &result);
+	if (iResult != 0)
+	{
+		Print("getaddrinfo failed: %d\n", iResult);
+		return false;
+	}
+
+	serverSocket = socket(result->ai_family, result->ai_socktype, result->ai_protocol);
+	if (serverSocket == INVALID_SOCKET)
+	{
+		Print("Error at socket(): %ld\n", WSAGetLastError());
+		freeaddrinfo(result);
+		return false;
+	}
+
+	// connect while still blocking, the server is on the same machine so this is quick
+	iResult = connect(serverSocket, result->ai_addr, (int)result->ai_addrlen);
+	freeaddrinfo(result);
+	if (iResult == SOCKET_ERROR)
+	{
+		Print("connect failed with error: %d\n", WSAGetLastError());
+		CloseSocket(serverSocket);
+		return false;
+	}
+
+	ioctlsocket(serverSocket, FIONBIO, &BLOCKING);
+	pending.clear();
+	return true;
+}
+
+void ipc::IPCClient::Close()
+{
+	if (serverSocket != INVALID_SOCKET)
+		CloseSocket(serverSocket);
+	pending.clear();
+}
+
+bool ipc::IPCClient::Connected()
+{
+	return serverSocket != INVALID_SOCKET;
+}
+
+bool ipc::IPCClient::SendMsg(const nlohmann::json& msg)
+{
+	if (serverSocket == INVALID_SOCKET)
+		return false;
+
+	// messages are null terminated, same as what the server expects
+	std::string out = msg.dump();
+	if (!SendAll(serverSocket, out.c_str(), out.size() + 1))
+	{
+		CloseSocket(serverSocket);
+		return false;
+	}
+	return true;
+}
+
+void ipc::IPCClient::ReadMessages(std::vector<nlohmann::json>& out)
+{
+	if (serverSocket == INVALID_SOCKET)
+		return;
+
+	char buffer[4096];
+	while (DataAvailable(serverSocket))
+	{
+		int result = recv(serverSocket, buffer, sizeof(buffer), 0);
+		if (result > 0)
+		{
+			pending.append(buffer, result);
+		}
+		else if (result == 0)
+		{
+			Print("Server closed the connection.\n");
+			CloseSocket(serverSocket);
+			break;
+		}
+		else
+		{
+			int error = WSAGetLastError();
+			if (error != WSAEWOULDBLOCK)
+			{
+				Print("Server disconnected, closing socket.\n");
+				CloseSocket(serverSocket);
+			}
+			break;
+		}
+	}
+
+	// unlike the server, keep partial messages around until the rest arrives
+	size_t start = 0;
+	for (size_t end = pending.find('\0'); end != std::string::npos; end = pending.find('\0', start))
+	{
+		try
+		{
+			out.push_back(nlohmann::json::parse(pending.begin() + start, pending.begin() + end));
+		}
+		catch (const std::exception& ex)
+		{
+			Print("Error parsing message: %s\n", ex.what());
+		}
+		start = end + 1;
+	}
+	pending.erase(0, start);
+}
+
+ipc::IPCClient::~IPCClient()
+{
+	Close();
+}
+
 void ipc::Print(const char* msg, ...)
 {
 	if (PRINT_FUNC != nullptr)
@@ -1,4 +1,9 @@
+#pragma once
+
+#include <cstdint>
+#include <mutex>
 #include <unordered_map>
+#include <unordered_set>
 #include <vector>
 
 #include "thirdparty\json.hpp"
@@ -14,6 +19,39 @@ namespace ipc
 	void InitWinsock();
 	void AddPrintFunc(PrintFunc func);
 
+	/*
+	* Binary mode: a client sends {"type": "binary_hello", "version": IPC_BINARY_VERSION} and the server answers
+	* with a null terminated {"type": "binary_ack"}. Everything the server sends after the ack is a frame: a
+	* little endian uint32 payload length, one IPCFrameType byte, then the payload. Messages from the client stay
+	* null terminated json.
+	*
+	* IPC_FRAME_ENT_SCHEMA: uint32 schema id, uint16 length + class name, uint16 prop count, then for every prop
+	*                       a IPCPropType byte and uint16 length + prop name. Sent once per connection before the
+	*                       first entity that uses it.
+	* IPC_FRAME_ENT:        uint32 entity index, uint32 schema id (UINT32_MAX if the entity doesn't exist), then
+	*                       the values in schema order: int32, float, 3 floats, or uint16 length + chars.
+	* IPC_FRAME_STREAM:     pushed every tick for "subscribe" messages, see ipc_stream.hpp.
+	*/
+	constexpr int IPC_BINARY_VERSION = 1;
+	constexpr size_t IPC_FRAME_HEADER_LEN = 5;
+	constexpr uint32_t IPC_NO_SCHEMA = UINT32_MAX;
+
+	enum IPCFrameType : uint8_t
+	{
+		IPC_FRAME_JSON,
+		IPC_FRAME_ENT_SCHEMA,
+		IPC_FRAME_ENT,
+		IPC_FRAME_STREAM,
+	};
+
+	enum IPCPropType : uint8_t
+	{
+		IPC_PROP_INT,
+		IPC_PROP_FLOAT,
+		IPC_PROP_VECTOR,
+		IPC_PROP_STRING,
+	};
+
 	class IPCServer
 	{
 	public:
@@ -25,6 +63,20 @@ namespace ipc
 		void AddCallback(std::string type, MsgCallback callback, bool blocking);
 		void SendMsg(const nlohmann::json& msg);
 		bool ClientConnected();
+		// true once the current client has switched to binary frames
+		bool BinaryMode();
+		// Starts a frame in the reusable send buffer, append the payload to the returned buffer and call EndFrame()
+		std::vector<char>& BeginFrame(IPCFrameType type);
+		void EndFrame();
+		// Returns true the first time it's called with this id for the current client
+		bool MarkSchemaSent(uint32_t schemaId);
+		// changes every time a new client connects
+		uint32_t GetConnectionId();
+		/*
+		* Sends already framed data, can be called from other threads. Does nothing if the client with the given
+		* connection id is gone.
+		*/
+		bool SendRaw(uint32_t connectionId, const char* data, size_t len);
 		~IPCServer();
 
 	private:
@@ -32,13 +84,52 @@ namespace ipc
 		void CheckForConnections();
 		void DispatchMessages();
 		void DispatchMessages(const std::string& type);
+		void StartBinaryMode(const nlohmann::json& msg);
+		// queues the data and sends it unless another thread is already writing to the socket
+		bool Send(uint32_t connId, const char* data, size_t len);
+		void FlushSendQueue();
+		void CloseClient();
+		void CloseIfSendFailed();
 		int listenSocket;
 		int clientSocket;
 		char* RECV_BUFFER;
+		bool binaryMode;
+		uint32_t connectionId;
+		// guards the client socket and the send queue, never held during socket I/O
+		std::mutex sendMutex;
+		// held by whichever thread is writing to the socket, nobody waits for it
+		std::mutex writeMutex;
+		// whole frames/messages that haven't been written yet
+		std::vector<char> sendQueue;
+		bool sendFailed;
+		// a socket that was closed while another thread was writing to it, that thread closes it
+		int deferredCloseSocket;
+		std::vector<char> sendBuffer;
+		std::unordered_set<uint32_t> sentSchemas;
 
 		std::unordered_map<std::string, MsgCallback> callbacks;
 		std::unordered_map<std::string, bool> blockingMap;
 		std::unordered_map<std::string, std::vector<nlohmann::json>> msgQueue;
 	};
 
+	// Connects to the IPCServer of another SPT instance, used to hand out work to other games
+	class IPCClient
+	{
+	public:
+		IPCClient();
+		IPCClient(const IPCClient&) = delete;
+		IPCClient& operator=(const IPCClient&) = delete;
+		bool Connect(const char* port);
+		void Close();
+		bool Connected();
+		bool SendMsg(const nlohmann::json& msg);
+		// Appends all complete messages that have been received so far, doesn't block
+		void ReadMessages(std::vector<nlohmann::json>& out);
+		~IPCClient();
+
+	private:
+		int serverSocket;
+		std::string pending;
+	};
+
 } // namespace ipc
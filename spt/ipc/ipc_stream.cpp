@@ -0,0 +1,104 @@
+#include "stdafx.hpp"
+
+#include "ipc_stream.hpp"
+
+namespace ipc
+{
+	// every frame in the ring is prefixed by the id of the connection it's meant for
+	constexpr size_t RECORD_HEADER_LEN = sizeof(uint32_t) + IPC_FRAME_HEADER_LEN;
+
+	IPCStreamSender::IPCStreamSender(size_t capacity) : ring(capacity) {}
+
+	IPCStreamSender::~IPCStreamSender()
+	{
+		Stop();
+	}
+
+	void IPCStreamSender::Start(IPCServer& srv)
+	{
+		if (thread.joinable())
+			return;
+		server = &srv;
+		stopping = false;
+		readPos = used = 0;
+		thread = std::thread{&IPCStreamSender::SenderThread, this};
+	}
+
+	void IPCStreamSender::Stop()
+	{
+		if (!thread.joinable())
+			return;
+		{
+			std::lock_guard lk{mutex};
+			stopping = true;
+		}
+		cv.notify_one();
+		thread.join();
+	}
+
+	void IPCStreamSender::Write(const void* data, size_t len)
+	{
+		size_t writePos = (readPos + used) % ring.size();
+		size_t first = std::min(len, ring.size() - writePos);
+		memcpy(ring.data() + writePos, data, first);
+		memcpy(ring.data(), (const char*)data + first, len - first);
+		used += len;
+	}
+
+	size_t IPCStreamSender::GetMaxPayloadSize() const
+	{
+		return ring.size() - RECORD_HEADER_LEN;
+	}
+
+	bool IPCStreamSender::Push(uint32_t connectionId, IPCFrameType type, std::span<const char> payload)
+	{
+		if (!thread.joinable())
+			return false;
+
+		if (payload.size() > GetMaxPayloadSize())
+			return false;
+
+		uint32_t len = payload.size();
+		{
+			std::lock_guard lk{mutex};
+			if (ring.size() - used < RECORD_HEADER_LEN + len)
+				return false;
+			Write(&connectionId, sizeof connectionId);
+			Write(&len, sizeof len);
+			Write(&type, sizeof type);
+			Write(payload.data(), len);
+		}
+		cv.notify_one();
+		return true;
+	}
+
+	void IPCStreamSender::SenderThread()
+	{
+		std::vector<char> batch;
+		while (true)
+		{
+			{
+				std::unique_lock lk{mutex};
+				cv.wait(lk, [this] { return stopping || used > 0; });
+				if (stopping)
+					return;
+				// take everything at once so the game thread can keep pushing while this sends
+				size_t first = std::min(used, ring.size() - readPos);
+				batch.assign(ring.data() + readPos, ring.data() + readPos + first);
+				batch.insert(batch.end(), ring.data(), ring.data() + used - first);
+				readPos = (readPos + used) % ring.size();
+				used = 0;
+			}
+
+			for (size_t pos = 0; pos < batch.size();)
+			{
+				uint32_t connectionId, len;
+				memcpy(&connectionId, batch.data() + pos, sizeof connectionId);
+				memcpy(&len, batch.data() + pos + sizeof connectionId, sizeof len);
+				const char* frame = batch.data() + pos + sizeof connectionId;
+				server->SendRaw(connectionId, frame, IPC_FRAME_HEADER_LEN + len);
+				pos += RECORD_HEADER_LEN + len;
+			}
+		}
+	}
+} // namespace ipc
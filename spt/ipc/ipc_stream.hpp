@@ -0,0 +1,65 @@
+#pragma once
+
+#include <condition_variable>
+#include <mutex>
+#include <span>
+#include <thread>
+#include <vector>
+
+#include "ipc.hpp"
+
+namespace ipc
+{
+	/*
+	* Clients can send {"type": "subscribe", "id": <id>, "server": <bool>, "entities": [<index>, ...],
+	* "fields": [{"map": <datamap>, "field": <name>, "type": "int" | "float" | "bool" | "vector"}, ...]} once
+	* they're in binary mode. The fields are resolved once, then every tick SPT pushes an IPC_FRAME_STREAM
+	* frame with the values that changed since the last frame of that subscription:
+	*
+	* uint32 subscription id, uint32 tick (counts up from the first subscription), uint8 IPCStreamFlags,
+	* uint32 change count, then for every change a uint16 entity slot (index into "entities"), a uint16 field
+	* index and the value. A field index of IPC_STREAM_ENT_GONE means the entity doesn't exist anymore and has no
+	* value, all of its fields are sent again when it comes back. Ticks without changes are not sent.
+	*
+	* {"type": "unsubscribe", "id": <id>} stops the stream.
+	*/
+	enum IPCStreamFlags : uint8_t
+	{
+		// frames were dropped before this one, it has every field of every entity that exists (forget the rest)
+		IPC_STREAM_RESYNC = 1,
+	};
+
+	constexpr uint16_t IPC_STREAM_ENT_GONE = UINT16_MAX;
+
+	/*
+	* Sends frames from a dedicated thread so that a slow client never stalls the game thread. Frames are
+	* copied into a fixed size ring buffer, if it's full the frame is dropped and Push() returns false. Frames
+	* with a payload over GetMaxPayloadSize() never fit and are always dropped.
+	*/
+	class IPCStreamSender
+	{
+	public:
+		explicit IPCStreamSender(size_t capacity);
+		IPCStreamSender(const IPCStreamSender&) = delete;
+		~IPCStreamSender();
+
+		void Start(IPCServer& server);
+		// waits for the thread to exit, unsent frames are dropped
+		void Stop();
+		bool Push(uint32_t connectionId, IPCFrameType type, std::span<const char> payload);
+		size_t GetMaxPayloadSize() const;
+
+	private:
+		void Write(const void* data, size_t len);
+		void SenderThread();
+
+		IPCServer* server = nullptr;
+		std::vector<char> ring;
+		size_t readPos = 0;
+		size_t used = 0;
+		std::thread thread;
+		std::mutex mutex;
+		std::condition_variable cv;
+		bool stopping = false;
+	};
+} // namespace ipc
@@ -0,0 +1,125 @@
+#include "stdafx.hpp"
+
+#include "compiled_script.hpp"
+
+#include <iterator>
+
+#include "variable_container.hpp"
+
+namespace scripts
+{
+	bool CompiledScript::Load(const std::string& path)
+	{
+		std::error_code ec;
+		auto writeTime = std::filesystem::last_write_time(path, ec);
+		if (ec)
+			return false;
+		uintmax_t size = std::filesystem::file_size(path, ec);
+		if (ec)
+			return false;
+		if (path == loadedPath && writeTime == loadedWriteTime && size == loadedSize)
+			return true;
+
+		loadedPath.clear();
+		lines.clear();
+		std::ifstream ifs(path);
+		if (!ifs.is_open())
+			return false;
+		std::string contents{std::istreambuf_iterator<char>(ifs), std::istreambuf_iterator<char>()};
+		if (ifs.bad())
+			return false;
+
+		// same lines as std::getline would give, including an empty one after a trailing newline
+		size_t start = 0;
+		while (true)
+		{
+			size_t end = contents.find('\n', start);
+			Line& line = lines.emplace_back();
+			line.text.assign(contents, start, end == std::string::npos ? std::string::npos : end - start);
+			size_t comment = line.text.find("//");
+			if (comment != std::string::npos)
+				line.text.erase(comment);
+			if (end == std::string::npos)
+				break;
+			start = end + 1;
+		}
+
+		loadedPath = path;
+		loadedWriteTime = writeTime;
+		loadedSize = size;
+		return true;
+	}
+
+	void CompiledScript::SplitLine(Line& line, VariableContainer& variables)
+	{
+		bool hadVariables = !line.segments.empty();
+		line.segments.clear();
+		line.varsVersion = UINT32_MAX;
+
+		size_t literalStart = 0;
+		size_t pos = 0;
+		while ((pos = line.text.find('[', pos)) != std::string::npos)
+		{
+			size_t close = line.text.find(']', pos + 1);
+			if (close == std::string::npos)
+				break;
+			auto it = variables.variableMap.find(line.text.substr(pos + 1, close - pos - 1));
+			if (it == variables.variableMap.end())
+			{
+				pos++;
+				continue;
+			}
+			if (pos > literalStart)
+				line.segments.push_back({literalStart, pos - literalStart, nullptr});
+			line.segments.push_back({0, 0, &it->second});
+			pos = literalStart = close + 1;
+		}
+		if (!line.segments.empty() && literalStart < line.text.size())
+			line.segments.push_back({literalStart, line.text.size() - literalStart, nullptr});
+
+		// the cached frame bulk can only be kept if the text stays the same
+		if (hadVariables || !line.segments.empty())
+		{
+			line.filled.clear();
+			line.hasFrameBulk = false;
+		}
+	}
+
+	const std::string& CompiledScript::GetLine(size_t i, VariableContainer& variables, uint32_t varsVersion)
+	{
+		Line& line = lines[i];
+		if (line.varsVersion != varsVersion)
+		{
+			SplitLine(line, variables);
+			line.varsVersion = varsVersion;
+		}
+		if (line.segments.empty())
+			return line.text;
+
+		scratch.clear();
+		for (const Segment& segment : line.segments)
+		{
+			if (segment.variable)
+				scratch += segment.variable->GetValue();
+			else
+				scratch.append(line.text, segment.start, segment.len);
+		}
+		if (scratch != line.filled)
+		{
+			std::swap(scratch, line.filled);
+			line.hasFrameBulk = false;
+		}
+		return line.filled;
+	}
+
+	const FrameBulkOutput* CompiledScript::GetFrameBulk(size_t i) const
+	{
+		return lines[i].hasFrameBulk ? &lines[i].frameBulk : nullptr;
+	}
+
+	void CompiledScript::SetFrameBulk(size_t i, const FrameBulkOutput& output)
+	{
+		lines[i].frameBulk = output;
+		lines[i].hasFrameBulk = true;
+	}
+} // namespace scripts
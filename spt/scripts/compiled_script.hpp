@@ -0,0 +1,65 @@
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+#include "framebulk_handler.hpp"
+
+namespace scripts
+{
+	class ScriptVariable;
+	class VariableContainer;
+
+	/*
+	* A script file split into lines once, so that search iterations don't have to read and reparse the whole
+	* file every time. Each line is cut into pieces of literal text and slots for the variables it uses, filling
+	* in the variables is just gluing the pieces back together. Frame bulks are cached per line and only parsed
+	* again if the text of the line changed, which only happens for lines that use a variable.
+	*
+	* Slots are found against the variables that exist when the line is read. The reader bumps the version
+	* whenever variables are added or removed and lines split against an older version are split again.
+	*/
+	class CompiledScript
+	{
+	public:
+		// reads the file unless it's already loaded and hasn't changed on disk, false if it can't be read
+		bool Load(const std::string& path);
+		size_t GetLineCount() const
+		{
+			return lines.size();
+		}
+		// the line with comments removed and the current variable values filled in
+		const std::string& GetLine(size_t i, VariableContainer& variables, uint32_t varsVersion);
+		// the parsed frame bulk for what GetLine(i) returned last, null if it hasn't been parsed yet
+		const FrameBulkOutput* GetFrameBulk(size_t i) const;
+		void SetFrameBulk(size_t i, const FrameBulkOutput& output);
+
+	private:
+		struct Segment
+		{
+			size_t start;
+			size_t len;
+			ScriptVariable* variable; // null for literal text
+		};
+
+		struct Line
+		{
+			std::string text;
+			std::string filled;
+			std::vector<Segment> segments; // empty if the line doesn't use any variables
+			uint32_t varsVersion = UINT32_MAX;
+			bool hasFrameBulk = false;
+			FrameBulkOutput frameBulk;
+		};
+
+		void SplitLine(Line& line, VariableContainer& variables);
+
+		std::string loadedPath;
+		std::filesystem::file_time_type loadedWriteTime;
+		uintmax_t loadedSize = 0;
+		std::vector<Line> lines;
+		std::string scratch;
+	};
+} // namespace scripts
@@ -1,6 +1,9 @@
 #pragma once
 
-#include "srctas_reader.hpp"
+#include <map>
+#include <set>
+#include <sstream>
+#include <string>
 
 namespace scripts
 {
@@ -0,0 +1,303 @@
+#include "stdafx.hpp"
+
+#include "parallel_search.hpp"
+
+#include "srctas_reader.hpp"
+#include "file.hpp"
+
+namespace scripts
+{
+	ParallelSearch g_ParallelSearch;
+
+	const char* GetSearchResultName(SearchResult result)
+	{
+		switch (result)
+		{
+		case SearchResult::Success:
+			return "success";
+		case SearchResult::Fail:
+			return "fail";
+		default:
+			return "error";
+		}
+	}
+
+	SearchResult ParseSearchResultName(const std::string& name)
+	{
+		if (name == "success")
+			return SearchResult::Success;
+		else if (name == "fail")
+			return SearchResult::Fail;
+		else
+			return SearchResult::NoSearch;
+	}
+
+	void ParallelSearch::Start(const std::string& script, const std::vector<std::string>& ports)
+	{
+		if (running)
+			Stop();
+
+		std::map<std::string, ScriptVariable> vars;
+		SearchType searchType;
+		// parsed with a reader of its own, g_TASReader might be in the middle of running something
+		SourceTASReader parser;
+		if (!parser.LoadSearchVariables(script, searchType, vars))
+			return;
+
+		std::vector<SearchDimension> newDims;
+		for (auto& pair : vars)
+		{
+			if (pair.second.IsRange())
+				newDims.push_back(SearchDimension{pair.first, pair.second.GetIndexCount()});
+		}
+
+		this->script = script;
+		type = searchType;
+		variables = std::move(vars);
+		dims = std::move(newDims);
+
+		std::string signature = GetSignature();
+		if (signature != memoSignature)
+		{
+			memo.clear();
+			memoSignature = signature;
+		}
+
+		remotes.clear();
+		if (!ports.empty() && !ipc::Winsock_Initialized())
+			ipc::InitWinsock();
+
+		for (auto& port : ports)
+		{
+			Runner runner;
+			runner.port = port;
+			runner.client = std::make_unique<ipc::IPCClient>();
+			if (runner.client->Connect(port.c_str()))
+			{
+				Msg("Connected to the SPT instance on port %s.\n", port.c_str());
+				remotes.push_back(std::move(runner));
+			}
+			else
+			{
+				Warning("Could not connect to the SPT instance on port %s, it won't be used.\n", port.c_str());
+			}
+		}
+
+		try
+		{
+			scheduler.Init(type, dims, remotes.size() + 1, memo);
+		}
+		catch (const std::exception& ex)
+		{
+			Msg("Error starting search: %s\n", ex.what());
+			remotes.clear();
+			return;
+		}
+
+		Msg("Starting parallel search over %u variables on %u instances.\n", dims.size(), remotes.size() + 1);
+		running = true;
+		localBusy = false;
+		startTime = std::chrono::steady_clock::now();
+		Dispatch();
+	}
+
+	void ParallelSearch::Stop()
+	{
+		if (!running)
+			return;
+
+		running = false;
+		for (auto& runner : remotes)
+		{
+			if (runner.busy && runner.client->Connected())
+			{
+				// the other game stops whatever it's doing when it gets a new script
+				nlohmann::json msg;
+				msg["type"] = "cmd";
+				msg["cmd"] = "tas_script_result_stop";
+				runner.client->SendMsg(msg);
+			}
+		}
+		remotes.clear();
+
+		if (localBusy)
+		{
+			localBusy = false;
+			g_TASReader.SearchResult(SearchResult::NoSearch);
+		}
+		Msg("Parallel search stopped.\n");
+	}
+
+	void ParallelSearch::Poll()
+	{
+		if (!running)
+			return;
+
+		std::vector<nlohmann::json> messages;
+		for (auto& runner : remotes)
+		{
+			if (!runner.client->Connected())
+				continue;
+
+			messages.clear();
+			runner.client->ReadMessages(messages);
+
+			for (auto& msg : messages)
+			{
+				if (msg.find("type") == msg.end() || msg["type"] != "search_result" || msg.find("id") == msg.end())
+					continue;
+				if (!runner.busy || msg["id"].get<int>() != runner.id)
+					continue;
+
+				runner.busy = false;
+				SearchResult result = ParseSearchResultName(msg.value("result", "error"));
+				if (result == SearchResult::NoSearch)
+				{
+					// most likely the script is missing or broken on that instance
+					Warning("Instance on port %s could not run the script, it won't be used anymore.\n",
+					        runner.port.c_str());
+					scheduler.Requeue(runner.assignment);
+					runner.client->Close();
+				}
+				else
+				{
+					scheduler.Report(runner.assignment, result, msg.value("tick", -1));
+				}
+			}
+
+			if (runner.busy && !runner.client->Connected())
+			{
+				Warning("Lost connection to the instance on port %s.\n", runner.port.c_str());
+				runner.busy = false;
+				scheduler.Requeue(runner.assignment);
+			}
+		}
+
+		Dispatch();
+	}
+
+	void ParallelSearch::Dispatch()
+	{
+		if (!running)
+			return;
+
+		std::vector<Runner*> idle;
+		for (auto& runner : remotes)
+		{
+			if (!runner.busy && runner.client->Connected())
+				idle.push_back(&runner);
+		}
+
+		size_t idleCount = idle.size() + (localBusy ? 0 : 1);
+		std::vector<SearchAssignment> batch;
+		scheduler.NextBatch(idleCount, batch);
+
+		size_t next = 0;
+		for (auto runner : idle)
+		{
+			if (next >= batch.size())
+				break;
+
+			runner->id = ++nextId;
+			runner->assignment = batch[next];
+
+			nlohmann::json msg;
+			msg["type"] = "search_run";
+			msg["id"] = runner->id;
+			msg["script"] = script;
+			msg["assignment"] = ToMap(runner->assignment);
+
+			if (runner->client->SendMsg(msg))
+			{
+				runner->busy = true;
+				++next;
+			}
+		}
+
+		// the local game goes last, starting the script there might finish it right away
+		if (!localBusy && next < batch.size())
+			RunLocal(batch[next++]);
+
+		// runners that disconnected while sending
+		for (; next < batch.size(); ++next)
+			scheduler.Requeue(batch[next]);
+
+		if (running && scheduler.IsDone())
+			Finish();
+	}
+
+	void ParallelSearch::RunLocal(const SearchAssignment& a)
+	{
+		localBusy = true;
+		localAssignment = a;
+		g_TASReader.ExecuteSearchCandidate(script,
+		                                   ToMap(a),
+		                                   [this](SearchResult result, int tick) { OnLocalResult(result, tick); });
+	}
+
+	void ParallelSearch::OnLocalResult(SearchResult result, int tick)
+	{
+		if (!localBusy)
+			return;
+		localBusy = false;
+
+		if (result == SearchResult::NoSearch)
+		{
+			// script error or tas_script_result_stop, either way there's no point continuing
+			scheduler.Requeue(localAssignment);
+			Stop();
+			return;
+		}
+
+		scheduler.Report(localAssignment, result, tick);
+		Dispatch();
+	}
+
+	void ParallelSearch::Finish()
+	{
+		running = false;
+		remotes.clear();
+
+		double seconds =
+		    std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+
+		Msg("Search done.\n");
+		SearchAssignment best;
+		SearchCandidateResult bestResult;
+		if (scheduler.GetBest(best, bestResult))
+		{
+			Msg("Best result was with:\n");
+			for (size_t i = 0; i < dims.size(); ++i)
+				Msg("\t - %s : %s\n", dims[i].name.c_str(), variables[dims[i].name].GetValueAtIndex(best[i]).c_str());
+			Msg("\t- tick: %d\n", bestResult.tick);
+		}
+		else
+		{
+			Msg("No results found.\n");
+		}
+
+		Msg("Tried %u candidates (%u from earlier searches), %u successful, %u errors, took %.1f s.\n",
+		    scheduler.GetTriedCount(),
+		    scheduler.GetCacheHits(),
+		    scheduler.GetSuccessCount(),
+		    scheduler.GetErrorCount(),
+		    seconds);
+	}
+
+	std::map<std::string, int> ParallelSearch::ToMap(const SearchAssignment& a)
+	{
+		std::map<std::string, int> out;
+		for (size_t i = 0; i < dims.size() && i < a.size(); ++i)
+			out[dims[i].name] = a[i];
+		return out;
+	}
+
+	std::string ParallelSearch::GetSignature()
+	{
+		// results can only be reused if the script hasn't been edited since
+		std::ifstream is(GetGameDir() + "\\" + script + SCRIPT_EXT, std::ios::binary);
+		std::stringstream ss;
+		ss << is.rdbuf();
+		return script + ":" + std::to_string(std::hash<std::string>()(ss.str()));
+	}
+} // namespace scripts
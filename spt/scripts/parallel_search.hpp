@@ -0,0 +1,71 @@
+#pragma once
+
+#include <chrono>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "search_scheduler.hpp"
+#include "variable_container.hpp"
+#include "..\ipc\ipc.hpp"
+
+namespace scripts
+{
+	const char* GetSearchResultName(SearchResult result);
+	SearchResult ParseSearchResultName(const std::string& name);
+
+	/*
+	* Runs a range search with the SearchScheduler. Candidates are run on this game and on any other SPT
+	* instances given by their IPC port; those get a "search_run" message and answer with "search_result".
+	* Every instance has to have the same script and save files.
+	*/
+	class ParallelSearch
+	{
+	public:
+		void Start(const std::string& script, const std::vector<std::string>& ports);
+		void Stop();
+		// collects results from the other instances, called every frame
+		void Poll();
+		bool IsRunning() const
+		{
+			return running;
+		}
+
+	private:
+		struct Runner
+		{
+			std::string port;
+			std::unique_ptr<ipc::IPCClient> client;
+			bool busy = false;
+			int id = 0;
+			SearchAssignment assignment;
+		};
+
+		void Dispatch();
+		void RunLocal(const SearchAssignment& a);
+		void OnLocalResult(SearchResult result, int tick);
+		void Finish();
+		std::map<std::string, int> ToMap(const SearchAssignment& a);
+		std::string GetSignature();
+
+		bool running = false;
+		std::string script;
+		SearchType type = SearchType::None;
+		std::map<std::string, ScriptVariable> variables;
+		std::vector<SearchDimension> dims;
+		SearchScheduler scheduler;
+
+		// results are kept between searches as long as the script doesn't change
+		SearchMemo memo;
+		std::string memoSignature;
+
+		std::vector<Runner> remotes;
+		bool localBusy = false;
+		SearchAssignment localAssignment;
+		int nextId = 0;
+		std::chrono::steady_clock::time_point startTime;
+	};
+
+	extern ParallelSearch g_ParallelSearch;
+} // namespace scripts
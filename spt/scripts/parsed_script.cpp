@@ -21,7 +21,7 @@ namespace scripts
 		initCommand += cmd;
 	}
 
-	void ParsedScript::AddFrameBulk(FrameBulkOutput& output)
+	void ParsedScript::AddFrameBulk(const FrameBulkOutput& output)
 	{
 		if (output.ticks >= 0)
 		{
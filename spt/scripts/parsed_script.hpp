@@ -39,7 +39,7 @@ namespace scripts
 
 		void AddDuringLoadCmd(const std::string& cmd);
 		void AddInitCommand(const std::string& cmd);
-		void AddFrameBulk(FrameBulkOutput& output);
+		void AddFrameBulk(const FrameBulkOutput& output);
 		void AddSaveState();
 		void AddSaveLoad();
 		void AddAfterFramesEntry(long long int tick, std::string command);
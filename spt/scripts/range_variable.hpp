@@ -37,6 +37,10 @@ namespace scripts
 		std::string GetRangeString();
 		void ParseInput(const std::string& value, bool angle);
 		void ParseValues(const std::string& value);
+		// index based access for the search scheduler, valid indices are [0, GetIndexCount())
+		int GetIndexCount();
+		void SetValueIndex(int index);
+		std::string GetValueAtIndex(int index);
 
 	private:
 		void SelectLow(SearchResult lastResult);
@@ -72,6 +76,27 @@ namespace scripts
 		return std::to_string(GetValueForIndex(valueIndex));
 	}
 
+	template<typename T>
+	inline int RangeVariable<T>::GetIndexCount()
+	{
+		return static_cast<int>((initialHigh - initialLow) / increment) + 1;
+	}
+
+	template<typename T>
+	inline void RangeVariable<T>::SetValueIndex(int index)
+	{
+		if (index < 0 || index >= GetIndexCount())
+			throw std::exception("Variable index out of range");
+		valueIndex = index;
+		lastIndex = index;
+	}
+
+	template<typename T>
+	inline std::string RangeVariable<T>::GetValueAtIndex(int index)
+	{
+		return std::to_string(GetValueForIndex(index));
+	}
+
 	template<typename T>
 	inline std::string RangeVariable<T>::GetRangeString()
 	{
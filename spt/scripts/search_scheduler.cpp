@@ -0,0 +1,363 @@
+#include "stdafx.hpp"
+
+#include "search_scheduler.hpp"
+
+namespace scripts
+{
+	// above this many combinations random search doesn't bother scanning for the last untried ones
+	const double MAX_SCANNED_COMBINATIONS = 1e6;
+	const int RANDOM_ATTEMPTS = 64;
+
+	void SearchScheduler::Init(SearchType type,
+	                           const std::vector<SearchDimension>& dims,
+	                           size_t parallelism,
+	                           SearchMemo& memo)
+	{
+		if ((type == SearchType::Lowest || type == SearchType::Highest) && dims.size() > 1)
+			throw std::exception("Binary search only accepts one range variable");
+		if (type == SearchType::None)
+			throw std::exception("Not in search mode");
+
+		this->type = type;
+		this->dims = dims;
+		this->parallelism = std::max<size_t>(parallelism, 1);
+		this->memo = &memo;
+
+		totalCombinations = 1;
+		for (auto& dim : dims)
+			totalCombinations *= dim.count;
+
+		inFlight.clear();
+		requeued.clear();
+		seen.clear();
+		exhausted = false;
+		foundRandom = false;
+		hasBest = false;
+		tried = 0;
+		cacheHits = 0;
+		successes = 0;
+		errors = 0;
+
+		std::random_device rd;
+		rng = std::mt19937(rd());
+
+		rangeNext.assign(dims.size(), 0);
+
+		if ((type == SearchType::Lowest || type == SearchType::Highest) && !dims.empty())
+		{
+			lo = -1;
+			hi = dims[0].count;
+			StartBisectionRound();
+		}
+	}
+
+	std::string SearchScheduler::GetKey(const SearchAssignment& a)
+	{
+		std::string key;
+		for (int index : a)
+		{
+			key += std::to_string(index);
+			key += ',';
+		}
+		return key;
+	}
+
+	size_t SearchScheduler::NextBatch(size_t maxCount, std::vector<SearchAssignment>& out)
+	{
+		size_t added = 0;
+		while (added < maxCount)
+		{
+			SearchAssignment a;
+			if (!requeued.empty())
+			{
+				a = requeued.front();
+				requeued.pop_front();
+			}
+			else if (!Generate(a))
+			{
+				break;
+			}
+
+			std::string key = GetKey(a);
+			if (inFlight.find(key) != inFlight.end())
+				continue;
+
+			auto it = memo->find(key);
+			if (it != memo->end())
+			{
+				// already ran this one in an earlier search over the same script
+				cacheHits++;
+				Record(a, it->second);
+				continue;
+			}
+
+			inFlight.insert(key);
+			out.push_back(std::move(a));
+			added++;
+		}
+		return added;
+	}
+
+	void SearchScheduler::Report(const SearchAssignment& a, SearchResult result, int tick)
+	{
+		std::string key = GetKey(a);
+		if (inFlight.erase(key) == 0)
+			return;
+
+		SearchCandidateResult r{result, tick};
+		// errors don't get memoized so that they're retried the next time
+		if (result != SearchResult::NoSearch)
+			(*memo)[key] = r;
+		Record(a, r);
+	}
+
+	void SearchScheduler::Requeue(const SearchAssignment& a)
+	{
+		if (inFlight.erase(GetKey(a)) > 0)
+			requeued.push_back(a);
+	}
+
+	bool SearchScheduler::IsDone() const
+	{
+		return inFlight.empty() && requeued.empty() && (exhausted || foundRandom);
+	}
+
+	bool SearchScheduler::GetBest(SearchAssignment& a, SearchCandidateResult& result) const
+	{
+		if (!hasBest)
+			return false;
+		a = best;
+		result = bestResult;
+		return true;
+	}
+
+	bool SearchScheduler::Generate(SearchAssignment& a)
+	{
+		if (exhausted)
+			return false;
+
+		if (dims.empty())
+		{
+			// nothing to search over, run the script once
+			a.clear();
+			exhausted = true;
+			return true;
+		}
+
+		switch (type)
+		{
+		case SearchType::Lowest:
+		case SearchType::Highest:
+			if (roundNext >= roundPoints.size())
+				return false;
+			a.assign(1, roundPoints[roundNext++]);
+			return true;
+		case SearchType::Random:
+		case SearchType::RandomLowest:
+		case SearchType::RandomHighest:
+			return GenerateRandom(a);
+		case SearchType::Range:
+			return GenerateRange(a);
+		default:
+			return false;
+		}
+	}
+
+	bool SearchScheduler::GenerateRandom(SearchAssignment& a)
+	{
+		if (foundRandom)
+			return false;
+		if (seen.size() >= totalCombinations)
+		{
+			exhausted = true;
+			return false;
+		}
+
+		a.resize(dims.size());
+		for (int attempt = 0; attempt < RANDOM_ATTEMPTS; ++attempt)
+		{
+			for (size_t i = 0; i < dims.size(); ++i)
+				a[i] = std::uniform_int_distribution<int>(0, dims[i].count - 1)(rng);
+			if (seen.insert(GetKey(a)).second)
+				return true;
+		}
+
+		// almost everything has been tried, look for what's left
+		if (totalCombinations <= MAX_SCANNED_COMBINATIONS)
+		{
+			std::fill(a.begin(), a.end(), 0);
+			while (true)
+			{
+				if (seen.insert(GetKey(a)).second)
+					return true;
+
+				size_t i = 0;
+				for (; i < dims.size(); ++i)
+				{
+					if (++a[i] < dims[i].count)
+						break;
+					a[i] = 0;
+				}
+				if (i == dims.size())
+					break;
+			}
+		}
+
+		exhausted = true;
+		return false;
+	}
+
+	bool SearchScheduler::GenerateRange(SearchAssignment& a)
+	{
+		a = rangeNext;
+
+		size_t i = 0;
+		for (; i < dims.size(); ++i)
+		{
+			if (++rangeNext[i] < dims[i].count)
+				break;
+			rangeNext[i] = 0;
+		}
+		if (i == dims.size())
+			exhausted = true;
+
+		return true;
+	}
+
+	void SearchScheduler::StartBisectionRound()
+	{
+		roundPoints.clear();
+		roundResults.clear();
+		roundDone.clear();
+		roundNext = 0;
+		roundReported = 0;
+
+		int interior = hi - lo - 1;
+		if (interior <= 0)
+		{
+			exhausted = true;
+			return;
+		}
+
+		// split (lo, hi) into parallelism + 1 parts so every runner gets one point
+		long long k = std::min<long long>(parallelism, interior);
+		for (long long j = 1; j <= k; ++j)
+		{
+			int p = lo + static_cast<int>((static_cast<long long>(hi - lo) * j) / (k + 1));
+			if (p > lo && p < hi && (roundPoints.empty() || roundPoints.back() != p))
+				roundPoints.push_back(p);
+		}
+		roundResults.assign(roundPoints.size(), SearchResult::NoSearch);
+		roundDone.assign(roundPoints.size(), false);
+	}
+
+	void SearchScheduler::FinishBisectionRound()
+	{
+		// points that errored say nothing about the answer, only move the bounds past actual results
+		const int n = static_cast<int>(roundPoints.size());
+		const int oldLo = lo;
+		const int oldHi = hi;
+		if (type == SearchType::Lowest)
+		{
+			// the lowest success becomes the new upper bound, the highest fail below it the new lower bound
+			int s = 0;
+			while (s < n && roundResults[s] != SearchResult::Success)
+				++s;
+			if (s < n)
+				hi = roundPoints[s];
+			for (int i = s - 1; i >= 0; --i)
+			{
+				if (roundResults[i] == SearchResult::Fail)
+				{
+					lo = roundPoints[i];
+					break;
+				}
+			}
+		}
+		else
+		{
+			int s = n - 1;
+			while (s >= 0 && roundResults[s] != SearchResult::Success)
+				--s;
+			if (s >= 0)
+				lo = roundPoints[s];
+			for (int i = s + 1; i < n; ++i)
+			{
+				if (roundResults[i] == SearchResult::Fail)
+				{
+					hi = roundPoints[i];
+					break;
+				}
+			}
+		}
+
+		if (lo == oldLo && hi == oldHi)
+		{
+			// every point in the round errored, another round would just run the same points again
+			roundPoints.clear();
+			roundResults.clear();
+			roundDone.clear();
+			exhausted = true;
+			return;
+		}
+
+		StartBisectionRound();
+	}
+
+	bool SearchScheduler::IsBetter(const SearchAssignment& a, const SearchCandidateResult& r) const
+	{
+		if (r.result != SearchResult::Success)
+			return false;
+		if (!hasBest)
+			return true;
+
+		switch (type)
+		{
+		case SearchType::Lowest:
+			return a[0] < best[0];
+		case SearchType::Highest:
+			return a[0] > best[0];
+		case SearchType::RandomHighest:
+			return r.tick > bestResult.tick;
+		case SearchType::RandomLowest:
+		case SearchType::Range:
+			return r.tick < bestResult.tick;
+		default:
+			return false;
+		}
+	}
+
+	void SearchScheduler::Record(const SearchAssignment& a, const SearchCandidateResult& r)
+	{
+		tried++;
+		if (r.result == SearchResult::Success)
+			successes++;
+		else if (r.result == SearchResult::NoSearch)
+			errors++;
+
+		if (IsBetter(a, r))
+		{
+			hasBest = true;
+			best = a;
+			bestResult = r;
+		}
+
+		if (type == SearchType::Random && r.result == SearchResult::Success)
+			foundRandom = true;
+
+		if ((type == SearchType::Lowest || type == SearchType::Highest) && !a.empty())
+		{
+			for (size_t i = 0; i < roundPoints.size(); ++i)
+			{
+				if (roundPoints[i] == a[0] && !roundDone[i])
+				{
+					roundDone[i] = true;
+					roundResults[i] = r.result;
+					if (++roundReported == roundPoints.size())
+						FinishBisectionRound();
+					break;
+				}
+			}
+		}
+	}
+} // namespace scripts
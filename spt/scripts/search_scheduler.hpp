@@ -0,0 +1,125 @@
+#pragma once
+
+#include <deque>
+#include <random>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "range_variable.hpp"
+
+namespace scripts
+{
+	// A range variable as seen by the scheduler, values are only referred to by index
+	struct SearchDimension
+	{
+		std::string name;
+		int count;
+	};
+
+	// One index per dimension, in the same order as the dimensions
+	typedef std::vector<int> SearchAssignment;
+
+	struct SearchCandidateResult
+	{
+		SearchResult result;
+		int tick;
+	};
+
+	typedef std::unordered_map<std::string, SearchCandidateResult> SearchMemo;
+
+	/*
+	* Hands out batches of variable assignments for a range search and collects their results. Unlike
+	* RangeVariable::Select, which picks one value per game iteration, the scheduler can have many
+	* candidates in flight at once:
+	*   - low/high: k-ary bisection of the single range variable, k being the number of parallel runners
+	*   - random/randomlow/randomhigh: random assignments that haven't been tried yet
+	*   - range: every assignment in order
+	* Results are memoized by assignment, candidates that are already in the memo are never handed out.
+	*/
+	class SearchScheduler
+	{
+	public:
+		// memo must outlive the scheduler, it can be shared between searches over the same domain
+		void Init(SearchType type, const std::vector<SearchDimension>& dims, size_t parallelism, SearchMemo& memo);
+
+		// appends up to maxCount new candidates to out, returns how many were added
+		size_t NextBatch(size_t maxCount, std::vector<SearchAssignment>& out);
+		void Report(const SearchAssignment& a, SearchResult result, int tick);
+		// gives a handed out candidate back, e.g. when the runner it was sent to disconnected
+		void Requeue(const SearchAssignment& a);
+
+		bool IsDone() const;
+		bool GetBest(SearchAssignment& a, SearchCandidateResult& result) const;
+
+		size_t GetTriedCount() const
+		{
+			return tried;
+		}
+		size_t GetCacheHits() const
+		{
+			return cacheHits;
+		}
+		size_t GetSuccessCount() const
+		{
+			return successes;
+		}
+		size_t GetErrorCount() const
+		{
+			return errors;
+		}
+		size_t GetInFlightCount() const
+		{
+			return inFlight.size();
+		}
+
+		static std::string GetKey(const SearchAssignment& a);
+
+	private:
+		bool Generate(SearchAssignment& a);
+		bool GenerateRandom(SearchAssignment& a);
+		bool GenerateRange(SearchAssignment& a);
+		void StartBisectionRound();
+		void FinishBisectionRound();
+		bool IsBetter(const SearchAssignment& a, const SearchCandidateResult& r) const;
+		void Record(const SearchAssignment& a, const SearchCandidateResult& r);
+
+		SearchType type = SearchType::None;
+		std::vector<SearchDimension> dims;
+		size_t parallelism = 1;
+		SearchMemo* memo = nullptr;
+		double totalCombinations = 0;
+
+		// candidates that have been handed out, but have no result yet
+		std::unordered_set<std::string> inFlight;
+		std::deque<SearchAssignment> requeued;
+		// random search only, everything generated so far
+		std::unordered_set<std::string> seen;
+		bool exhausted = false;
+		bool foundRandom = false;
+
+		// bisection state, the answer is always in (lo, hi]/[lo, hi) for low/high searches
+		int lo = 0;
+		int hi = 0;
+		std::vector<int> roundPoints;
+		std::vector<SearchResult> roundResults;
+		// errors leave their point as NoSearch, so this is tracked separately
+		std::vector<bool> roundDone;
+		size_t roundNext = 0;
+		size_t roundReported = 0;
+
+		// range state
+		SearchAssignment rangeNext;
+
+		std::mt19937 rng;
+
+		bool hasBest = false;
+		SearchAssignment best;
+		SearchCandidateResult bestResult;
+		size_t tried = 0;
+		size_t cacheHits = 0;
+		size_t successes = 0;
+		size_t errors = 0;
+	};
+} // namespace scripts
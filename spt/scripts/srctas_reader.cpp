@@ -31,10 +31,15 @@ namespace scripts
 	{
 		InitPropertyHandlers();
 		iterationFinished = true;
+		parseOnly = false;
+		candidateMode = false;
+		nextLine = 0;
+		varsVersion = 0;
 	}
 
 	void SourceTASReader::ExecuteScript(const std::string& script)
 	{
+		AbortCandidate();
 		freezeVariables = false;
 		fileName = script;
 		CommonExecuteScript(false);
@@ -43,6 +48,7 @@ namespace scripts
 	void SourceTASReader::ExecuteScriptWithResume(const std::string& script, int resumeTicks)
 	{
 		char buffer[80];
+		AbortCandidate();
 		freezeVariables = false;
 		fileName = script;
 		CommonExecuteScript(false);
@@ -56,14 +62,66 @@ namespace scripts
 
 	void SourceTASReader::StartSearch(const std::string& script)
 	{
+		AbortCandidate();
 		freezeVariables = false;
 		fileName = script;
 		CommonExecuteScript(true);
 		freezeVariables = true;
 	}
 
+	void SourceTASReader::ExecuteSearchCandidate(const std::string& script,
+	                                             const std::map<std::string, int>& assignment,
+	                                             CandidateCallback callback)
+	{
+		AbortCandidate();
+		freezeVariables = false;
+		fileName = script;
+		candidateMode = true;
+		candidateAssignment = assignment;
+		candidateCallback = std::move(callback);
+
+		if (!CommonExecuteScript(true))
+			SearchResult(SearchResult::NoSearch);
+	}
+
+	bool SourceTASReader::LoadSearchVariables(const std::string& script,
+	                                          SearchType& type,
+	                                          std::map<std::string, ScriptVariable>& variablesOut)
+	{
+		AbortCandidate();
+		freezeVariables = false;
+		fileName = script;
+		parseOnly = true;
+		bool ok = CommonExecuteScript(true);
+		parseOnly = false;
+		// nothing was started, don't check the conditions that were just parsed
+		iterationFinished = true;
+
+		type = searchType;
+		variablesOut = variables.variableMap;
+		return ok;
+	}
+
+	void SourceTASReader::AbortCandidate()
+	{
+		// let whoever started the candidate know that it won't finish
+		if (candidateMode)
+			SearchResult(SearchResult::NoSearch);
+	}
+
 	void SourceTASReader::SearchResult(scripts::SearchResult result)
 	{
+		if (candidateMode)
+		{
+			// the callback might start the next candidate right away
+			candidateMode = false;
+			auto callback = std::move(candidateCallback);
+			candidateCallback = nullptr;
+			if (callback)
+				callback(result, result == SearchResult::NoSearch ? -1 : GetCurrentTick());
+			return;
+		}
+
 		try
 		{
 			variables.SetResult(result);
@@ -85,8 +143,9 @@ namespace scripts
 		}
 	}
 
-	void SourceTASReader::CommonExecuteScript(bool search)
+	bool SourceTASReader::CommonExecuteScript(bool search)
 	{
+		bool ok = false;
 		try
 		{
 			DevMsg("Attempting to parse a version 1 TAS script...\n");
@@ -98,9 +157,8 @@ namespace scripts
 #endif
 
 			std::string gameDir = GetGameDir();
-			scriptStream.open(gameDir + "\\" + fileName + SCRIPT_EXT);
-
-			if (!scriptStream.is_open())
+			// only reads the file again if it changed since the last iteration
+			if (!compiledScript.Load(gameDir + "\\" + fileName + SCRIPT_EXT))
 				throw std::exception("File does not exist");
 			ParseProps();
 
@@ -108,11 +166,17 @@ namespace scripts
 				throw std::exception("In search mode but search property is not set");
 			else if (!search && searchType != SearchType::None)
 				throw std::exception("Not in search mode but search property is set");
+			else if (searchType == SearchType::Range && !candidateMode && !parseOnly)
+				throw std::exception("Range search is only supported by tas_script_search_parallel");
 
-			while (!scriptStream.eof())
+			while (nextLine < compiledScript.GetLineCount())
 			{
 				if (IsFramesLine())
+				{
+					if (parseOnly)
+						break;
 					ParseFrames();
+				}
 				else if (IsVarsLine())
 					ParseVariables();
 				else
@@ -120,7 +184,9 @@ namespace scripts
 					    "Unexpected section order in file. Expected order is props - variables - frames");
 			}
 
-			Execute();
+			if (!parseOnly)
+				Execute();
+			ok = true;
 		}
 		catch (const std::exception& ex)
 		{
@@ -136,7 +202,7 @@ namespace scripts
 			Msg("Unexpected exception on line %i\n", currentLine);
 		}
 
-		scriptStream.close();
+		return ok;
 	}
 
 	void SourceTASReader::OnAfterFrames()
@@ -239,12 +305,12 @@ namespace scripts
 
 	bool SourceTASReader::ParseLine()
 	{
-		if (!scriptStream.good())
+		if (nextLine >= compiledScript.GetLineCount())
 		{
 			return false;
 		}
 
-		std::getline(scriptStream, line);
+		line = compiledScript.GetLine(nextLine++, variables, varsVersion);
 		SetNewLine();
 
 		return true;
@@ -252,25 +318,11 @@ namespace scripts
 
 	void SourceTASReader::SetNewLine()
 	{
-		const std::string COMMENT_START = "//";
-		int end = line.find(COMMENT_START); // ignore comments
-		if (end != std::string::npos)
-			line.erase(end);
-
-		ReplaceVariables();
 		lineStream.str(line);
 		lineStream.clear();
 		++currentLine;
 	}
 
-	void SourceTASReader::ReplaceVariables()
-	{
-		for (auto& variable : variables.variableMap)
-		{
-			ReplaceAll(line, GetVarIdentifier(variable.first), variable.second.GetValue());
-		}
-	}
-
 	void SourceTASReader::ResetConvars()
 	{
 #ifndef OE
@@ -326,15 +378,17 @@ namespace scripts
 		if (!freezeVariables)
 		{
 			variables.Clear();
+			++varsVersion;
 		}
 		ResetIterationState();
 	}
 
 	void SourceTASReader::ResetIterationState()
 	{
-		ResetConvars();
+		if (!parseOnly)
+			ResetConvars();
 		conditions.clear();
-		scriptStream.clear();
+		nextLine = 0;
 		lineStream.clear();
 		line.clear();
 		currentLine = 0;
@@ -393,7 +447,10 @@ namespace scripts
 				ParseVariable();
 		}
 
-		variables.Iteration(searchType);
+		if (candidateMode)
+			variables.ApplyAssignment(candidateAssignment);
+		else
+			variables.Iteration(searchType);
 		variables.PrintState();
 	}
 
@@ -407,6 +464,7 @@ namespace scripts
 		std::string value;
 		GetTriplet(lineStream, type, name, value, ' ');
 		variables.AddNewVariable(type, name, value);
+		++varsVersion;
 	}
 
 	void SourceTASReader::ParseFrames()
@@ -431,11 +489,17 @@ namespace scripts
 		{
 			currentScript.AddSaveLoad();
 		}
+		else if (auto cached = compiledScript.GetFrameBulk(nextLine - 1))
+		{
+			// same text as in the last iteration
+			currentScript.AddFrameBulk(*cached);
+		}
 		else
 		{
 			FrameBulkInfo info(lineStream);
 			auto output = HandleFrameBulk(info);
 
+			compiledScript.SetFrameBulk(nextLine - 1, output);
 			currentScript.AddFrameBulk(output);
 		}
 	}
@@ -500,6 +564,8 @@ namespace scripts
 			searchType = SearchType::RandomLowest;
 		else if (value == "randomhigh")
 			searchType = SearchType::RandomHighest;
+		else if (value == "range")
+			searchType = SearchType::Range;
 		else
 			throw std::exception("Search type was invalid");
 	}
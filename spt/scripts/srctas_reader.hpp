@@ -1,9 +1,11 @@
 #pragma once
 #include <fstream>
+#include <functional>
 #include <map>
 #include <sstream>
 #include <string>
 
+#include "compiled_script.hpp"
 #include "condition.hpp"
 #include "parsed_script.hpp"
 #include "range_variable.hpp"
@@ -13,6 +15,9 @@ namespace scripts
 {
 	extern const std::string SCRIPT_EXT;
 
+	// Called with the result and the tick it was decided on, NoSearch means the script had an error
+	typedef std::function<void(scripts::SearchResult result, int tick)> CandidateCallback;
+
 	class SourceTASReader
 	{
 	public:
@@ -20,6 +25,14 @@ namespace scripts
 		void ExecuteScript(const std::string& script);
 		void ExecuteScriptWithResume(const std::string& script, int resumeTicks);
 		void StartSearch(const std::string& script);
+		// Runs one iteration of a search with the range variables fixed to the given indices
+		void ExecuteSearchCandidate(const std::string& script,
+		                            const std::map<std::string, int>& assignment,
+		                            CandidateCallback callback);
+		// Parses the props and variables of a search script without running it
+		bool LoadSearchVariables(const std::string& script,
+		                         SearchType& type,
+		                         std::map<std::string, ScriptVariable>& variablesOut);
 		void SearchResult(scripts::SearchResult result);
 		void OnAfterFrames();
 		int GetCurrentTick();
@@ -29,8 +42,14 @@ namespace scripts
 	private:
 		bool iterationFinished;
 		bool freezeVariables;
+		bool parseOnly;
+		bool candidateMode;
+		std::map<std::string, int> candidateAssignment;
+		CandidateCallback candidateCallback;
 		std::string fileName;
-		std::ifstream scriptStream;
+		CompiledScript compiledScript;
+		size_t nextLine;
+		uint32_t varsVersion; // bumped when variables are added or removed
 		std::istringstream lineStream;
 		std::string line;
 		int currentLine;
@@ -45,7 +64,8 @@ namespace scripts
 		std::map<std::string, void (SourceTASReader::*)(const std::string&)> propertyHandlers;
 		std::vector<std::unique_ptr<Condition>> conditions;
 
-		void CommonExecuteScript(bool search);
+		bool CommonExecuteScript(bool search);
+		void AbortCandidate();
 		void Reset();
 		void ResetIterationState();
 		void Execute();
@@ -53,7 +73,6 @@ namespace scripts
 
 		bool ParseLine();
 		void SetNewLine();
-		void ReplaceVariables();
 		void ResetConvars();
 
 		void InitPropertyHandlers();
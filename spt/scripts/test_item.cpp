@@ -1,53 +1,139 @@
 #include "stdafx.hpp"
 #include "test_item.hpp"
+#include <algorithm>
 #include <fstream>
 #include "string_utils.hpp"
 #include "dbg.h"
 
 namespace scripts
 {
-	std::vector<TestItem> GetTestData(const std::string& fileName)
+	/*
+	* The binary format is a header followed by one block per column: trackerNo, tolerance and count, then count
+	* ticks followed by count values. Values are stored as floats, so they compare exactly against what was
+	* generated instead of going through decimal text. Tests\test_data.py converts between the two formats.
+	*/
+	constexpr char BINARY_DATA_ID[8] = "spttdb";
+	constexpr uint32_t BINARY_DATA_VERSION = 1;
+
+	struct BinaryDataHeader
 	{
-		std::vector<TestItem> data;
-		std::ifstream is;
-		is.open(fileName);
+		char id[sizeof BINARY_DATA_ID];
+		uint32_t version;
+		uint32_t numColumns;
+	};
 
-		if (!is.is_open())
-			throw std::exception("Unable to open file for test data");
+	struct BinaryColumnHeader
+	{
+		int32_t trackerNo;
+		float tolerance;
+		uint32_t count;
+	};
 
+	static bool IsBinaryFile(const std::string& fileName)
+	{
+		return fileName.ends_with(".tdb");
+	}
+
+	static TestData GetTextTestData(std::ifstream& is)
+	{
+		TestData data;
 		std::string line;
 		std::string tickS;
-		int tick;
 		std::string noS;
-		int no;
 		std::string value;
+		Vector v;
 
 		while (std::getline(is, line))
 		{
 			if (!line.empty())
 			{
 				GetStringTriplet(line, tickS, noS, value, ' ');
-				tick = ParseValue<int>(tickS);
-				no = ParseValue<int>(noS);
-				data.emplace_back(tick, no, value);
+				GetTriplet<float>(value, v.x, v.y, v.z, '|');
+				TestColumn& column = data.GetColumn(ParseValue<int>(noS), 0);
+				column.ticks.push_back(ParseValue<int>(tickS));
+				column.values.push_back(v);
 			}
 		}
 
 		return data;
 	}
 
-	void WriteTestDataToFile(const std::vector<TestItem>& testData, const std::string& fileName)
+	static TestData GetBinaryTestData(std::ifstream& is)
 	{
+		TestData data;
+		BinaryDataHeader header;
+		if (!is.read((char*)&header, sizeof header) || memcmp(header.id, BINARY_DATA_ID, sizeof header.id))
+			throw std::exception("Not a binary test data file");
+		if (header.version != BINARY_DATA_VERSION)
+			throw std::exception("Unsupported test data version");
+
+		for (uint32_t i = 0; i < header.numColumns; ++i)
+		{
+			BinaryColumnHeader columnHeader;
+			if (!is.read((char*)&columnHeader, sizeof columnHeader))
+				throw std::exception("Unexpected end of test data");
+			TestColumn& column = data.columns.emplace_back(columnHeader.trackerNo, columnHeader.tolerance);
+			column.ticks.resize(columnHeader.count);
+			column.values.resize(columnHeader.count);
+			is.read((char*)column.ticks.data(), columnHeader.count * sizeof(int));
+			is.read((char*)column.values.data(), columnHeader.count * sizeof(Vector));
+			if (!is)
+				throw std::exception("Unexpected end of test data");
+		}
+
+		return data;
+	}
+
+	TestData GetTestData(const std::string& fileName)
+	{
+		bool binary = IsBinaryFile(fileName);
+		std::ifstream is;
+		is.open(fileName, binary ? std::ios::binary : std::ios::in);
+
+		if (!is.is_open())
+			throw std::exception("Unable to open file for test data");
+
+		TestData data = binary ? GetBinaryTestData(is) : GetTextTestData(is);
+		for (auto& column : data.columns)
+		{
+			if (!std::is_sorted(column.ticks.begin(), column.ticks.end()))
+				throw std::exception("Test data ticks are out of order");
+		}
+
+		return data;
+	}
+
+	void WriteTestDataToFile(const TestData& testData, const std::string& fileName)
+	{
+		if (!IsBinaryFile(fileName))
+			throw std::exception("Test data can only be written as binary");
+
 		std::ofstream os;
-		os.open(fileName);
+		os.open(fileName, std::ios::binary);
+		BinaryDataHeader header{.version = BINARY_DATA_VERSION, .numColumns = (uint32_t)testData.columns.size()};
+		memcpy(header.id, BINARY_DATA_ID, sizeof header.id);
+		os.write((const char*)&header, sizeof header);
 
-		for (auto& entry : testData)
+		for (auto& column : testData.columns)
 		{
-			os << entry.tick << ' ' << entry.trackerNo << ' ' << entry.data << '\n';
+			BinaryColumnHeader columnHeader{column.trackerNo, column.tolerance, (uint32_t)column.ticks.size()};
+			os.write((const char*)&columnHeader, sizeof columnHeader);
+			os.write((const char*)column.ticks.data(), column.ticks.size() * sizeof(int));
+			os.write((const char*)column.values.data(), column.values.size() * sizeof(Vector));
 		}
 
 		os.close();
 	}
 
-	TestItem::TestItem(int tick, int no, const std::string& data) : tick(tick), trackerNo(no), data(data) {}
+	TestColumn::TestColumn(int trackerNo, float tolerance) : trackerNo(trackerNo), tolerance(tolerance) {}
+
+	TestColumn& TestData::GetColumn(int trackerNo, float tolerance)
+	{
+		for (auto& column : columns)
+		{
+			if (column.trackerNo == trackerNo)
+				return column;
+		}
+		return columns.emplace_back(trackerNo, tolerance);
+	}
 } // namespace scripts
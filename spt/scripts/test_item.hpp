@@ -1,18 +1,31 @@
 #pragma once
 #include <string>
 #include <vector>
+#include "mathlib\vector.h"
 
 namespace scripts
 {
-	struct TestItem
+	// Everything one tracker is expected to output, sorted by tick
+	struct TestColumn
 	{
-		TestItem(int tick, int no, const std::string& data);
+		TestColumn(int trackerNo, float tolerance);
 
-		int tick;
 		int trackerNo;
-		std::string data;
+		// largest difference on any axis that still passes, <= 0 uses the tracker's own
+		float tolerance;
+		std::vector<int> ticks;
+		std::vector<Vector> values;
 	};
 
-	std::vector<TestItem> GetTestData(const std::string& fileName);
-	void WriteTestDataToFile(const std::vector<TestItem>& testData, const std::string& fileName);
+	struct TestData
+	{
+		std::vector<TestColumn> columns;
+
+		TestColumn& GetColumn(int trackerNo, float tolerance);
+	};
+
+	// Reads text (.td) or binary (.tdb) test data depending on the extension
+	TestData GetTestData(const std::string& fileName);
+	// Always writes the binary format
+	void WriteTestDataToFile(const TestData& testData, const std::string& fileName);
 } // namespace scripts
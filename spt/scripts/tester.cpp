@@ -5,6 +5,7 @@
 #include "..\sptlib-wrapper.hpp"
 #include "file.hpp"
 #include "srctas_reader.hpp"
+#include "string_utils.hpp"
 #include "dbg.h"
 
 namespace scripts
@@ -41,7 +42,8 @@ namespace scripts
 			else
 			{
 				runningTest = true;
-				testItems = GetTestData(TestDataFile(testName));
+				testData = GetTestData(TestDataFile(testName));
+				columnPositions.assign(testData.columns.size(), 0);
 			}
 
 			g_TASReader.ExecuteScript(testName);
@@ -66,6 +68,9 @@ namespace scripts
 
 	std::string Tester::TestDataFile(const std::string& testName)
 	{
+		std::string binaryFile = GetGameDir() + "\\" + testName + BINARY_DATA_EXT;
+		if (FileExists(binaryFile))
+			return binaryFile;
 		return GetGameDir() + "\\" + testName + DATA_EXT;
 	}
 
@@ -127,45 +132,46 @@ namespace scripts
 
 	void Tester::TestIteration()
 	{
-		while (currentTestItem < testItems.size() && testItems[currentTestItem].tick <= dataTick)
+		for (std::size_t i = 0; i < testData.columns.size(); ++i)
 		{
-			auto& item = testItems[currentTestItem];
+			auto& column = testData.columns[i];
+			auto& pos = columnPositions[i];
 
-			if (item.tick < dataTick)
+			while (pos < column.ticks.size() && column.ticks[pos] < dataTick)
+				++pos;
+			if (pos >= column.ticks.size() || column.ticks[pos] != dataTick)
 				continue;
 
-			auto& tracker = trackers[item.trackerNo];
-			auto result = tracker->Validate(item.data);
+			auto tracker = trackers.find(column.trackerNo);
+			if (tracker == trackers.end())
+			{
+				std::ostringstream oss;
+				oss << "Unknown tracker " << column.trackerNo << " in test data";
+				throw std::exception(oss.str().c_str());
+			}
+
+			float tolerance = column.tolerance > 0 ? column.tolerance : tracker->second->GetTolerance();
+			auto result = tracker->second->Validate(column.values[pos], tolerance);
 
 			if (!result.successful)
 			{
 				std::ostringstream oss;
-				oss << "Tracker \"" << tracker->TrackerName() << "\" difference at tick " << item.tick
+				oss << "Tracker \"" << tracker->second->TrackerName() << "\" difference at tick " << dataTick
 				    << " : \"" << result.errorMsg << "\"";
 				throw std::exception(oss.str().c_str());
 			}
 
-			++currentTestItem;
+			++pos;
 		}
 	}
 
 	void Tester::GenerationIteration()
 	{
-		for (std::size_t i = 0; i < trackers.size(); ++i)
+		for (auto& [trackerNo, tracker] : trackers)
 		{
-			auto& tracker = trackers[i];
-			std::string data = tracker->GenerateTestData();
-			auto selfValidation = tracker->Validate(data);
-
-			if (!selfValidation.successful)
-			{
-				std::ostringstream oss;
-				oss << "Tracker " << tracker->TrackerName() << " failed to self-validate on tick "
-				    << dataTick << " : \"" << selfValidation.errorMsg << "\"";
-				throw std::exception(oss.str().c_str());
-			}
-
-			testItems.push_back(TestItem(dataTick, i, tracker->GenerateTestData()));
+			auto& column = testData.GetColumn(trackerNo, tracker->GetTolerance());
+			column.ticks.push_back(dataTick);
+			column.values.push_back(tracker->GetValue());
 		}
 	}
 
@@ -178,7 +184,7 @@ namespace scripts
 		}
 		else
 		{
-			WriteTestDataToFile(testItems, TestDataFile(currentTest));
+			WriteTestDataToFile(testData, GetGameDir() + "\\" + currentTest + BINARY_DATA_EXT);
 		}
 
 		if (successfulTest && runningTest)
@@ -227,6 +233,45 @@ namespace scripts
 		LoadTest(folder, generating, true);
 	}
 
+	void Tester::RunAutomatedTestList(const std::string& listFileName, const std::string& fileName)
+	{
+		OpenLogFile(fileName);
+		automatedTest = true;
+		Reset();
+
+		std::ifstream is(listFileName);
+		if (!is.is_open())
+		{
+			PrintTestMessage("Unable to open test list " + listFileName);
+			CloseLogFile();
+			EngineConCmd("quit");
+			return;
+		}
+
+		std::string line;
+		while (std::getline(is, line))
+		{
+			rtrim(line);
+			if (line.empty())
+				continue;
+			if (RequiredFilesExist(line, false))
+				testNames.push_back(line);
+			else
+				logFileStream << "[TEST] " << line << " : Test was unsuccessful, test files not found\n";
+		}
+
+		if (!testNames.empty())
+		{
+			LoadTest(testNames[0], false, true);
+		}
+		else
+		{
+			PrintTestMessage("No valid tests found in the list.");
+			CloseLogFile();
+			EngineConCmd("quit");
+		}
+	}
+
 	void Tester::RunAllTests(const std::string& folder, bool generating, bool automated)
 	{
 		this->automatedTest = automated;
@@ -257,8 +302,8 @@ namespace scripts
 
 	void Tester::ResetIteration()
 	{
-		testItems.clear();
-		currentTestItem = 0;
+		testData.columns.clear();
+		columnPositions.clear();
 		afterFramesTick = 0;
 		dataTick = 0;
 		successfulTest = true;
@@ -17,14 +17,15 @@
 //	- Test: I have this data for this tick. Is it correct? Tracker: Yes/No, and here's why
 //	- Contains its active tick range with access using the public functions GetStartTick() and GetEndTick()
 
-// TestItem
-//	- A simple tracker number - value pairing
-// A vector of these can be loaded/written from/to a file using a utility function provided in test_item.hpp
-// The test data can be edited post generation
+// TestData
+//	- A column of tick - value pairs per tracker, each with the tolerance it's validated with
+// Can be loaded/written from/to a file using a utility function provided in test_item.hpp
+// Text data (.td) can be edited post generation, new data is generated as binary (.tdb)
 
 namespace scripts
 {
 	const std::string DATA_EXT = ".td";
+	const std::string BINARY_DATA_EXT = ".tdb";
 	const int VELOCITY_NO = 0;
 	const int POS_NO = 1;
 	const int ANG_NO = 2;
@@ -36,6 +37,7 @@ namespace scripts
 		Tester();
 		void LoadTest(const std::string& testName, bool generating, bool automatedTest = false);
 		static bool RequiredFilesExist(const std::string& testName, bool generating);
+		// the binary data if there is any, the text data otherwise
 		static std::string TestDataFile(const std::string& testName);
 		static std::string ScriptFile(const std::string& testName);
 		static std::string GetFolder(const std::string& testName);
@@ -47,6 +49,8 @@ namespace scripts
 		void TestDone();
 
 		void RunAutomatedTest(const std::string& folder, bool generating, const std::string& testFileName);
+		// runs the tests named in listFileName (one per line), so a runner can split a suite between games
+		void RunAutomatedTestList(const std::string& listFileName, const std::string& testFileName);
 		void RunAllTests(const std::string& folder, bool generating, bool automatedTest = false);
 		void ResetIteration();
 		void Reset();
@@ -59,7 +63,7 @@ namespace scripts
 		const std::string& GetCurrentTestName();
 
 		std::map<int, std::unique_ptr<Tracker>> trackers;
-		std::vector<TestItem> testItems;
+		TestData testData;
 		std::vector<std::string> testNames;
 		std::vector<int> failedTests;
 		std::string currentTest;
@@ -72,7 +76,7 @@ namespace scripts
 		bool automatedTest;
 
 		std::string testFileName;
-		std::size_t currentTestItem;
+		std::vector<std::size_t> columnPositions;
 		int afterFramesTick;
 		int dataTick;
 		bool successfulTest;
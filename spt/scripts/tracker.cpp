@@ -12,16 +12,14 @@ namespace scripts
 		return std::abs(v.x) <= maxDiff && std::abs(v.y) <= maxDiff && std::abs(v.z) <= maxDiff;
 	}
 
-	ValidationResult VectorValidation(const Vector& current, const std::string& expectedValue, int decimals)
+	Tracker::Tracker(int decimals) : decimals(decimals) {}
+
+	ValidationResult Tracker::Validate(const Vector& expectedValue, float tolerance) const
 	{
-		Vector expectedVel;
 		ValidationResult result;
-		GetTriplet<float>(expectedValue, expectedVel.x, expectedVel.y, expectedVel.z, '|');
-
-		Vector diff = current - expectedVel;
-		float maxDiff = std::powf(0.1f, decimals);
+		Vector diff = GetValue() - expectedValue;
 
-		if (ValidDiff(diff, maxDiff))
+		if (ValidDiff(diff, tolerance))
 		{
 			result.successful = true;
 		}
@@ -36,24 +34,14 @@ namespace scripts
 		return result;
 	}
 
-	std::string GenerateVectorData(Vector v, int decimals)
-	{
-		std::ostringstream oss;
-		oss << std::fixed << std::setprecision(decimals) << v.x << '|' << v.y << '|' << v.z;
-
-		return oss.str();
-	}
-
-	VelocityTracker::VelocityTracker(int decimals) : decimals(decimals) {}
-
-	std::string VelocityTracker::GenerateTestData() const
+	float Tracker::GetTolerance() const
 	{
-		return GenerateVectorData(spt_playerio.GetPlayerVelocity(), decimals);
+		return std::powf(0.1f, decimals);
 	}
 
-	ValidationResult VelocityTracker::Validate(const std::string& expectedValue) const
+	Vector VelocityTracker::GetValue() const
 	{
-		return VectorValidation(spt_playerio.GetPlayerVelocity(), expectedValue, decimals);
+		return spt_playerio.GetPlayerVelocity();
 	}
 
 	std::string VelocityTracker::TrackerName() const
@@ -61,19 +49,9 @@ namespace scripts
 		return "velocity";
 	}
 
-	PosTracker::PosTracker(int decimals)
-	{
-		this->decimals = decimals;
-	}
-
-	std::string PosTracker::GenerateTestData() const
+	Vector PosTracker::GetValue() const
 	{
-		return GenerateVectorData(spt_playerio.GetPlayerEyePos(tas_strafe_version.GetInt() >= 8), decimals);
-	}
-
-	ValidationResult PosTracker::Validate(const std::string& expectedValue) const
-	{
-		return VectorValidation(spt_playerio.GetPlayerEyePos(tas_strafe_version.GetInt() >= 8), expectedValue, decimals);
+		return spt_playerio.GetPlayerEyePos(tas_strafe_version.GetInt() >= 8);
 	}
 
 	std::string PosTracker::TrackerName() const
@@ -81,22 +59,12 @@ namespace scripts
 		return "position";
 	}
 
-	AngTracker::AngTracker(int decimals) : decimals(decimals) {}
-
-	std::string AngTracker::GenerateTestData() const
-	{
-		float va[3];
-		EngineGetViewAngles(va);
-
-		return GenerateVectorData(Vector(va[0], va[1], va[2]), decimals);
-	}
-
-	ValidationResult AngTracker::Validate(const std::string& expectedValue) const
+	Vector AngTracker::GetValue() const
 	{
 		float va[3];
 		EngineGetViewAngles(va);
 
-		return VectorValidation(Vector(va[0], va[1], va[2]), expectedValue, decimals);
+		return Vector(va[0], va[1], va[2]);
 	}
 
 	std::string AngTracker::TrackerName() const
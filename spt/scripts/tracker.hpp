@@ -1,6 +1,7 @@
 #pragma once
 #include <string>
 #include <vector>
+#include "mathlib\vector.h"
 
 namespace scripts
 {
@@ -13,45 +14,40 @@ namespace scripts
 	class Tracker
 	{
 	public:
-		virtual std::string GenerateTestData() const = 0;
-		virtual ValidationResult Validate(const std::string& expectedValue) const = 0;
+		Tracker(int decimals);
+		virtual Vector GetValue() const = 0;
 		virtual std::string TrackerName() const = 0;
 		virtual ~Tracker() {}
+
+		ValidationResult Validate(const Vector& expectedValue, float tolerance) const;
+		// largest difference on any axis that still passes, given by how many decimals the text format keeps
+		float GetTolerance() const;
+
+	protected:
+		int decimals;
 	};
 
 	class VelocityTracker : public Tracker
 	{
 	public:
-		VelocityTracker(int decimals);
-		std::string GenerateTestData() const override;
-		ValidationResult Validate(const std::string& expectedValue) const override;
+		using Tracker::Tracker;
+		Vector GetValue() const override;
 		std::string TrackerName() const override;
-
-	private:
-		int decimals;
 	};
 
 	class PosTracker : public Tracker
 	{
 	public:
-		PosTracker(int decimals);
-		std::string GenerateTestData() const override;
-		ValidationResult Validate(const std::string& expectedValue) const override;
+		using Tracker::Tracker;
+		Vector GetValue() const override;
 		std::string TrackerName() const override;
-
-	private:
-		int decimals;
 	};
 
 	class AngTracker : public Tracker
 	{
 	public:
-		AngTracker(int decimals);
-		std::string GenerateTestData() const override;
-		ValidationResult Validate(const std::string& expectedValue) const override;
+		using Tracker::Tracker;
+		Vector GetValue() const override;
 		std::string TrackerName() const override;
-
-	private:
-		int decimals;
 	};
-} // namespace scripts
\ No newline at end of file
+} // namespace scripts
@@ -84,6 +84,17 @@ namespace scripts
 		}
 	}
 
+	void VariableContainer::ApplyAssignment(const std::map<std::string, int>& assignment)
+	{
+		for (auto& pair : assignment)
+		{
+			auto it = variableMap.find(pair.first);
+			if (it == variableMap.end() || !it->second.IsRange())
+				throw std::exception("Assignment for an unknown range variable");
+			it->second.SetIndex(pair.second);
+		}
+	}
+
 	void VariableContainer::PrintState()
 	{
 		if (variableMap.size() == 0)
@@ -198,4 +209,54 @@ namespace scripts
 			throw std::exception("Unexpected variable type while starting iteration");
 		}
 	}
+
+	bool ScriptVariable::IsRange()
+	{
+		return variableType == VariableType::IntRange || variableType == VariableType::FloatRange
+		       || variableType == VariableType::AngleRange;
+	}
+
+	int ScriptVariable::GetIndexCount()
+	{
+		switch (variableType)
+		{
+		case VariableType::IntRange:
+			return data.intRange.GetIndexCount();
+		case VariableType::FloatRange:
+		case VariableType::AngleRange:
+			return data.floatRange.GetIndexCount();
+		default:
+			throw std::exception("Not a range variable");
+		}
+	}
+
+	void ScriptVariable::SetIndex(int index)
+	{
+		switch (variableType)
+		{
+		case VariableType::IntRange:
+			data.intRange.SetValueIndex(index);
+			break;
+		case VariableType::FloatRange:
+		case VariableType::AngleRange:
+			data.floatRange.SetValueIndex(index);
+			break;
+		default:
+			throw std::exception("Not a range variable");
+		}
+	}
+
+	std::string ScriptVariable::GetValueAtIndex(int index)
+	{
+		switch (variableType)
+		{
+		case VariableType::IntRange:
+			return data.intRange.GetValueAtIndex(index);
+		case VariableType::FloatRange:
+		case VariableType::AngleRange:
+			return data.floatRange.GetValueAtIndex(index);
+		default:
+			throw std::exception("Not a range variable");
+		}
+	}
 } // namespace scripts
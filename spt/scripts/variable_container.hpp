@@ -39,6 +39,12 @@ namespace scripts
 		std::string GetValue(); // Returns the actual value of the variable in a string
 		bool Iteration(SearchResult search, SearchType type);
 
+		// For the search scheduler, only valid for range variables
+		bool IsRange();
+		int GetIndexCount();
+		void SetIndex(int index);
+		std::string GetValueAtIndex(int index);
+
 	private:
 		VariableType variableType;
 		VarData data;
@@ -60,6 +66,8 @@ namespace scripts
 		void AddNewVariable(const std::string& type, const std::string& name, const std::string& value);
 		void SetResult(SearchResult result);
 		void PrintState();
+		// Sets range variables to the given indices instead of selecting them with Iteration()
+		void ApplyAssignment(const std::map<std::string, int>& assignment);
 
 	private:
 		bool Successful(SearchResult result);
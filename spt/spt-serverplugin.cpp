@@ -38,6 +38,7 @@
 #include "SDK\igamemovement.h"
 #include "interfaces.hpp"
 #include "signals.hpp"
+#include "thread_pool.hpp"
 
 #if SSDK2007
 #include "mathlib\vmatrix.h"
@@ -454,6 +455,9 @@ bool CSourcePauseTool::Load(CreateInterfaceFn interfaceFactory, CreateInterfaceF
 	ServerActivateSignal.Works = true;
 	LevelShutdownSignal.Works = true;
 	OnEdictAllocatedSignal.Works = true;
+#ifndef OE
+	OnEdictFreedSignal.Works = true;
+#endif
 	ClientPutInServerSignal.Works = true;
 	ClientDisconnectSignal.Works = true;
 	ClientSettingsChangedSignal.Works = true;
@@ -503,6 +507,7 @@ void CSourcePauseTool::Unload(void)
 	unloadMutex.lock();
 	Cvar_UnregisterSPTCvars();
 	Feature::UnloadFeatures();
+	utils::ShutdownThreadPool();
 	unloadMutex.unlock();
 	// pray that other threads have left their hooks
 	std::this_thread::sleep_for(std::chrono::milliseconds{0});
@@ -541,6 +546,11 @@ void CSourcePauseTool::OnEdictAllocated(edict_t* edict)
 {
 	OnEdictAllocatedSignal(edict);
 }
+
+void CSourcePauseTool::OnEdictFreed(const edict_t* edict)
+{
+	OnEdictFreedSignal(edict);
+}
 #endif
 
 void CSourcePauseTool::ClientPutInServer(edict_t* pEntity, char const* playername)
@@ -87,7 +87,7 @@ public:
 
 	// added with version 3 of the interface.
 	virtual void OnEdictAllocated(edict_t* edict);
-	virtual void OnEdictFreed(const edict_t* edict){};
+	virtual void OnEdictFreed(const edict_t* edict);
 #endif
 
 	/*
@@ -0,0 +1,227 @@
+#include "stdafx.hpp"
+
+#ifdef OE
+#include "mathlib.h"
+#else
+#include "mathlib/mathlib.h"
+#endif
+
+#include <intrin.h>
+#include <immintrin.h>
+
+#include "strafe_batch.hpp"
+
+// The kernels below must stay bit-exact with VectorFME(), i.e.:
+//   tmp = wishspeed_capped - (float dot product)   [double]
+//   if (tmp <= 0) keep velocity
+//   tmp = min(tmp, accelspeed)                     [double]
+//   vel += (float)(dir * tmp)                      [float]
+// All comparisons are written so that NaNs take the same branch as the scalar code.
+
+namespace Strafe
+{
+	void AccelBatch::Clear()
+	{
+		Resize(0);
+	}
+
+	void AccelBatch::Resize(size_t n)
+	{
+		velX.resize(n);
+		velY.resize(n);
+		dirX.resize(n);
+		dirY.resize(n);
+		wishspeedCapped.resize(n);
+		accelspeed.resize(n);
+		outVelX.resize(n);
+		outVelY.resize(n);
+	}
+
+	void AccelBatch::Add(const PlayerData& player,
+	                     const MovementVars& vars,
+	                     bool onground,
+	                     double wishspeed,
+	                     const Vector2D& a)
+	{
+		double accel = onground ? vars.Accelerate : vars.Airaccelerate;
+
+		velX.push_back(player.Velocity.x);
+		velY.push_back(player.Velocity.y);
+		dirX.push_back(a.x);
+		dirY.push_back(a.y);
+		wishspeedCapped.push_back(onground ? wishspeed : vars.WishspeedCap);
+		accelspeed.push_back(accel * wishspeed * vars.EntFriction * vars.Frametime);
+		outVelX.push_back(0);
+		outVelY.push_back(0);
+	}
+
+	static void RunScalar(AccelBatch& b, size_t start, size_t end)
+	{
+		for (size_t i = start; i < end; ++i)
+		{
+			const float vx = b.velX[i];
+			const float vy = b.velY[i];
+			const float dx = b.dirX[i];
+			const float dy = b.dirY[i];
+
+			double tmp = b.wishspeedCapped[i] - (vx * dx + vy * dy);
+			if (tmp <= 0.0)
+			{
+				b.outVelX[i] = vx;
+				b.outVelY[i] = vy;
+				continue;
+			}
+
+			double accelspeed = b.accelspeed[i];
+			if (accelspeed <= tmp)
+				tmp = accelspeed;
+
+			b.outVelX[i] = vx + static_cast<float>(dx * tmp);
+			b.outVelY[i] = vy + static_cast<float>(dy * tmp);
+		}
+	}
+
+	static inline __m128 Load2(const float* p)
+	{
+		return _mm_castsi128_ps(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(p)));
+	}
+
+	static inline void Store2(float* p, __m128 v)
+	{
+		_mm_storel_epi64(reinterpret_cast<__m128i*>(p), _mm_castps_si128(v));
+	}
+
+	static inline __m128 Select(__m128 mask, __m128 a, __m128 b)
+	{
+		return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b));
+	}
+
+	static void RunSSE2(AccelBatch& b, size_t& i)
+	{
+		const size_t n = b.Size();
+		for (; i + 2 <= n; i += 2)
+		{
+			const __m128 vx = Load2(&b.velX[i]);
+			const __m128 vy = Load2(&b.velY[i]);
+			const __m128 dx = Load2(&b.dirX[i]);
+			const __m128 dy = Load2(&b.dirY[i]);
+
+			const __m128 dot = _mm_add_ps(_mm_mul_ps(vx, dx), _mm_mul_ps(vy, dy));
+			__m128d tmp = _mm_sub_pd(_mm_loadu_pd(&b.wishspeedCapped[i]), _mm_cvtps_pd(dot));
+			const __m128d doAccel = _mm_cmpnle_pd(tmp, _mm_setzero_pd());
+
+			const __m128d accelspeed = _mm_loadu_pd(&b.accelspeed[i]);
+			const __m128d useAccelspeed = _mm_cmple_pd(accelspeed, tmp);
+			tmp = _mm_or_pd(_mm_and_pd(useAccelspeed, accelspeed), _mm_andnot_pd(useAccelspeed, tmp));
+
+			const __m128 newX = _mm_add_ps(vx, _mm_cvtpd_ps(_mm_mul_pd(_mm_cvtps_pd(dx), tmp)));
+			const __m128 newY = _mm_add_ps(vy, _mm_cvtpd_ps(_mm_mul_pd(_mm_cvtps_pd(dy), tmp)));
+
+			const __m128 mask =
+			    _mm_shuffle_ps(_mm_castpd_ps(doAccel), _mm_castpd_ps(doAccel), _MM_SHUFFLE(2, 0, 2, 0));
+			Store2(&b.outVelX[i], Select(mask, newX, vx));
+			Store2(&b.outVelY[i], Select(mask, newY, vy));
+		}
+	}
+
+	static void RunAVX(AccelBatch& b, size_t& i)
+	{
+		const size_t n = b.Size();
+		for (; i + 4 <= n; i += 4)
+		{
+			const __m128 vx = _mm_loadu_ps(&b.velX[i]);
+			const __m128 vy = _mm_loadu_ps(&b.velY[i]);
+			const __m128 dx = _mm_loadu_ps(&b.dirX[i]);
+			const __m128 dy = _mm_loadu_ps(&b.dirY[i]);
+
+			const __m128 dot = _mm_add_ps(_mm_mul_ps(vx, dx), _mm_mul_ps(vy, dy));
+			__m256d tmp = _mm256_sub_pd(_mm256_loadu_pd(&b.wishspeedCapped[i]), _mm256_cvtps_pd(dot));
+			const __m256d doAccel = _mm256_cmp_pd(tmp, _mm256_setzero_pd(), _CMP_NLE_UQ);
+
+			const __m256d accelspeed = _mm256_loadu_pd(&b.accelspeed[i]);
+			tmp = _mm256_blendv_pd(tmp, accelspeed, _mm256_cmp_pd(accelspeed, tmp, _CMP_LE_OQ));
+
+			const __m128 newX = _mm_add_ps(vx, _mm256_cvtpd_ps(_mm256_mul_pd(_mm256_cvtps_pd(dx), tmp)));
+			const __m128 newY = _mm_add_ps(vy, _mm256_cvtpd_ps(_mm256_mul_pd(_mm256_cvtps_pd(dy), tmp)));
+
+			const __m128 mask = _mm_shuffle_ps(_mm_castpd_ps(_mm256_castpd256_pd128(doAccel)),
+			                                   _mm_castpd_ps(_mm256_extractf128_pd(doAccel, 1)),
+			                                   _MM_SHUFFLE(2, 0, 2, 0));
+			_mm_storeu_ps(&b.outVelX[i], _mm_blendv_ps(vx, newX, mask));
+			_mm_storeu_ps(&b.outVelY[i], _mm_blendv_ps(vy, newY, mask));
+		}
+		// avoid AVX->SSE transition penalties in the caller
+		_mm256_zeroupper();
+	}
+
+	void AccelBatch::Run()
+	{
+		Run(GetBestBatchImpl());
+	}
+
+	void AccelBatch::Run(BatchImpl impl)
+	{
+		if (!IsBatchImplSupported(impl))
+			impl = BatchImpl::SCALAR;
+
+		size_t i = 0;
+		switch (impl)
+		{
+		case BatchImpl::AVX:
+			RunAVX(*this, i);
+			break;
+		case BatchImpl::SSE2:
+			RunSSE2(*this, i);
+			break;
+		default:
+			break;
+		}
+		RunScalar(*this, i, Size());
+	}
+
+	static bool CpuSupportsAVX()
+	{
+		int info[4];
+		__cpuid(info, 1);
+		const bool osxsave = (info[2] & (1 << 27)) != 0;
+		const bool avx = (info[2] & (1 << 28)) != 0;
+		if (!osxsave || !avx)
+			return false;
+		// make sure the OS saves the YMM registers
+		return (_xgetbv(0) & 0x6) == 0x6;
+	}
+
+	static bool CpuSupportsSSE2()
+	{
+		int info[4];
+		__cpuid(info, 1);
+		return (info[3] & (1 << 26)) != 0;
+	}
+
+	bool IsBatchImplSupported(BatchImpl impl)
+	{
+		static const bool sse2 = CpuSupportsSSE2();
+		static const bool avx = CpuSupportsAVX();
+
+		switch (impl)
+		{
+		case BatchImpl::SCALAR:
+			return true;
+		case BatchImpl::SSE2:
+			return sse2;
+		case BatchImpl::AVX:
+			return avx;
+		default:
+			return false;
+		}
+	}
+
+	BatchImpl GetBestBatchImpl()
+	{
+		if (IsBatchImplSupported(BatchImpl::AVX))
+			return BatchImpl::AVX;
+		else if (IsBatchImplSupported(BatchImpl::SSE2))
+			return BatchImpl::SSE2;
+		return BatchImpl::SCALAR;
+	}
+} // namespace Strafe
@@ -0,0 +1,65 @@
+#pragma once
+
+#include <vector>
+
+#include "strafestuff.hpp"
+
+namespace Strafe
+{
+	enum class BatchImpl
+	{
+		SCALAR = 0,
+		SSE2,
+		AVX,
+	};
+
+	/*
+	* A structure-of-arrays batch of acceleration candidates. Every lane is an independent VectorFME()
+	* evaluation: the lane velocity is accelerated along the (unit) lane direction. The SIMD kernels are
+	* bit-exact with VectorFME(), so this can be used in place of it in the TAS code without desyncs.
+	*
+	* Lanes can either be added one by one with Add(), or the lane arrays can be filled in directly after
+	* a call to Resize() if the caller already computes them in SIMD (e.g. the strafe HUD).
+	*/
+	class AccelBatch
+	{
+	public:
+		void Clear();
+		void Resize(size_t n);
+		size_t Size() const
+		{
+			return velX.size();
+		}
+
+		void Add(const PlayerData& player,
+		         const MovementVars& vars,
+		         bool onground,
+		         double wishspeed,
+		         const Vector2D& a);
+
+		// runs the kernel with the best instruction set available on this CPU
+		void Run();
+		void Run(BatchImpl impl);
+
+		Vector2D GetVelocity(size_t i) const
+		{
+			return Vector2D(outVelX[i], outVelY[i]);
+		}
+
+		// PlayerData lanes
+		std::vector<float> velX;
+		std::vector<float> velY;
+		// wish direction lanes
+		std::vector<float> dirX;
+		std::vector<float> dirY;
+		// MovementVars lanes, already reduced to what the acceleration step needs
+		std::vector<double> wishspeedCapped;
+		std::vector<double> accelspeed;
+		// results
+		std::vector<float> outVelX;
+		std::vector<float> outVelY;
+	};
+
+	BatchImpl GetBestBatchImpl();
+	bool IsBatchImplSupported(BatchImpl impl);
+} // namespace Strafe
@@ -0,0 +1,433 @@
+#include "stdafx.hpp"
+
+#ifdef OE
+#include "mathlib.h"
+#else
+#include "mathlib/mathlib.h"
+#endif
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+
+#include "bsp_file.hpp"
+#include "strafe_sim.hpp"
+#include "strafe_utils.hpp"
+#include "thread_pool.hpp"
+
+namespace Strafe
+{
+	// same as the engine
+	static const float DIST_EPSILON = 0.03125f;
+	// boxes wider than this don't go into the grid
+	static const float GRID_CELL_SIZE = 256.f;
+	static const float BIG_BOX_SIZE = GRID_CELL_SIZE * 16;
+	static const float WORLD_EXTENT = 65536.f;
+
+	struct ClipState
+	{
+		float fraction;
+		Vector normal;
+		bool startsolid;
+		bool allsolid;
+	};
+
+	static void GetHullExtents(HullType hull, Vector& mins, Vector& maxs)
+	{
+		if (hull == HullType::POINT)
+		{
+			mins.Init();
+			maxs.Init();
+			return;
+		}
+
+		mins.Init(-16, -16, hull == HullType::DUCKED ? 36.f : 0.f);
+		maxs.Init(16, 16, 72);
+	}
+
+	// Clips start->end against a box that has already been expanded by the hull, same logic as CM_ClipBoxToBrush
+	static void ClipToBox(const Vector& emins, const Vector& emaxs, const Vector& start, const Vector& end, ClipState& st)
+	{
+		float enterFrac = -1.f;
+		float leaveFrac = 1.f;
+		Vector normal(0, 0, 0);
+		bool getout = false;
+		bool startout = false;
+
+		for (int axis = 0; axis < 3; ++axis)
+		{
+			// side 0 is the plane facing +axis, side 1 is the plane facing -axis
+			for (int side = 0; side < 2; ++side)
+			{
+				float d1 = side == 0 ? start[axis] - emaxs[axis] : emins[axis] - start[axis];
+				float d2 = side == 0 ? end[axis] - emaxs[axis] : emins[axis] - end[axis];
+
+				if (d2 > 0)
+					getout = true;
+				if (d1 > 0)
+					startout = true;
+
+				// completely in front of this plane
+				if (d1 > 0 && (d2 >= DIST_EPSILON || d2 >= d1))
+					return;
+				if (d1 <= 0 && d2 <= 0)
+					continue;
+
+				if (d1 > d2)
+				{
+					float f = std::max((d1 - DIST_EPSILON) / (d1 - d2), 0.f);
+					if (f > enterFrac)
+					{
+						enterFrac = f;
+						normal.Init();
+						normal[axis] = side == 0 ? 1.f : -1.f;
+					}
+				}
+				else
+				{
+					float f = (d1 + DIST_EPSILON) / (d1 - d2);
+					if (f < leaveFrac)
+						leaveFrac = f;
+				}
+			}
+		}
+
+		if (!startout)
+		{
+			st.startsolid = true;
+			if (!getout)
+			{
+				st.allsolid = true;
+				st.fraction = 0;
+			}
+			return;
+		}
+
+		if (enterFrac < leaveFrac && enterFrac > -1 && enterFrac < st.fraction)
+		{
+			st.fraction = std::max(enterFrac, 0.f);
+			st.normal = normal;
+		}
+	}
+
+	static void FillTrace(trace_t& trace, const Vector& start, const Vector& end, const ClipState& st)
+	{
+		trace.startpos = start;
+		trace.endpos = start + (end - start) * st.fraction;
+		trace.fraction = st.fraction;
+		trace.plane.normal = st.normal;
+		trace.plane.dist = DotProduct(st.normal, trace.endpos);
+		trace.startsolid = st.startsolid;
+		trace.allsolid = st.allsolid;
+		trace.contents = st.fraction < 1 || st.startsolid ? CONTENTS_SOLID : 0;
+	}
+
+	void BrushWorld::Clear()
+	{
+		boxes.clear();
+		bigBoxes.clear();
+		cells.clear();
+		gridW = gridH = 0;
+	}
+
+	void BrushWorld::AddBox(const Vector& mins, const Vector& maxs)
+	{
+		boxes.push_back({mins, maxs});
+	}
+
+	void BrushWorld::AddGroundPlane(float z)
+	{
+		AddBox(Vector(-WORLD_EXTENT, -WORLD_EXTENT, -WORLD_EXTENT), Vector(WORLD_EXTENT, WORLD_EXTENT, z));
+	}
+
+	void BrushWorld::Build()
+	{
+		bigBoxes.clear();
+		cells.clear();
+		gridW = gridH = 0;
+
+		float minX = FLT_MAX, minY = FLT_MAX, maxX = -FLT_MAX, maxY = -FLT_MAX;
+		for (auto& box : boxes)
+		{
+			if (box.maxs.x - box.mins.x > BIG_BOX_SIZE || box.maxs.y - box.mins.y > BIG_BOX_SIZE)
+				continue;
+			minX = std::min(minX, box.mins.x);
+			minY = std::min(minY, box.mins.y);
+			maxX = std::max(maxX, box.maxs.x);
+			maxY = std::max(maxY, box.maxs.y);
+		}
+
+		if (minX <= maxX)
+		{
+			gridMinX = minX;
+			gridMinY = minY;
+			gridW = (int)std::ceil((maxX - minX) / GRID_CELL_SIZE) + 1;
+			gridH = (int)std::ceil((maxY - minY) / GRID_CELL_SIZE) + 1;
+			cells.resize((size_t)gridW * gridH);
+		}
+
+		for (uint32_t i = 0; i < boxes.size(); ++i)
+		{
+			auto& box = boxes[i];
+			if (box.maxs.x - box.mins.x > BIG_BOX_SIZE || box.maxs.y - box.mins.y > BIG_BOX_SIZE)
+			{
+				bigBoxes.push_back(i);
+				continue;
+			}
+			int x0 = (int)((box.mins.x - gridMinX) / GRID_CELL_SIZE);
+			int x1 = (int)((box.maxs.x - gridMinX) / GRID_CELL_SIZE);
+			int y0 = (int)((box.mins.y - gridMinY) / GRID_CELL_SIZE);
+			int y1 = (int)((box.maxs.y - gridMinY) / GRID_CELL_SIZE);
+			for (int y = y0; y <= y1; ++y)
+				for (int x = x0; x <= x1; ++x)
+					cells[(size_t)y * gridW + x].push_back(i);
+		}
+	}
+
+	void BrushWorld::TracePlayer(trace_t& trace, const Vector& start, const Vector& end, HullType hull) const
+	{
+		Vector hullMins, hullMaxs;
+		GetHullExtents(hull, hullMins, hullMaxs);
+
+		Vector sweepMins, sweepMaxs;
+		for (int i = 0; i < 3; ++i)
+		{
+			sweepMins[i] = std::min(start[i], end[i]) + hullMins[i] - 1;
+			sweepMaxs[i] = std::max(start[i], end[i]) + hullMaxs[i] + 1;
+		}
+
+		ClipState st{1.f, Vector(0, 0, 0), false, false};
+
+		auto clip = [&](uint32_t i)
+		{
+			const Box& box = boxes[i];
+			if (box.mins.x > sweepMaxs.x || box.maxs.x < sweepMins.x || box.mins.y > sweepMaxs.y
+			    || box.maxs.y < sweepMins.y || box.mins.z > sweepMaxs.z || box.maxs.z < sweepMins.z)
+			{
+				return;
+			}
+			ClipToBox(box.mins - hullMaxs, box.maxs - hullMins, start, end, st);
+		};
+
+		for (uint32_t i : bigBoxes)
+		{
+			clip(i);
+			if (st.allsolid)
+				break;
+		}
+
+		if (!st.allsolid && gridW > 0)
+		{
+			int x0 = std::clamp((int)std::floor((sweepMins.x - gridMinX) / GRID_CELL_SIZE), 0, gridW - 1);
+			int x1 = std::clamp((int)std::floor((sweepMaxs.x - gridMinX) / GRID_CELL_SIZE), 0, gridW - 1);
+			int y0 = std::clamp((int)std::floor((sweepMins.y - gridMinY) / GRID_CELL_SIZE), 0, gridH - 1);
+			int y1 = std::clamp((int)std::floor((sweepMaxs.y - gridMinY) / GRID_CELL_SIZE), 0, gridH - 1);
+			// boxes spanning several cells get clipped more than once, that doesn't change the result
+			for (int y = y0; y <= y1 && !st.allsolid; ++y)
+				for (int x = x0; x <= x1 && !st.allsolid; ++x)
+					for (uint32_t i : cells[(size_t)y * gridW + x])
+						clip(i);
+		}
+
+		FillTrace(trace, start, end, st);
+	}
+
+	bool BrushWorld::LoadFromBsp(const std::string& path, const char** err)
+	{
+		utils::BspFile bsp;
+		std::span<const dplane_t> planes;
+		std::span<const dbrush_t> brushes;
+		std::span<const dbrushside_t> brushsides;
+		if (!bsp.Open(path, err) || !bsp.GetLump(LUMP_PLANES, planes, err) || !bsp.GetLump(LUMP_BRUSHES, brushes, err)
+		    || !bsp.GetLump(LUMP_BRUSHSIDES, brushsides, err))
+		{
+			return false;
+		}
+
+		// only the brushes of the world model are reachable from the first node, entity brushes are skipped
+		std::vector<bool> worldBrush;
+		if (!bsp.GetWorldBrushes(worldBrush, err))
+			return false;
+
+		size_t skipped = 0;
+		for (size_t b = 0; b < brushes.size(); ++b)
+		{
+			const dbrush_t& brush = brushes[b];
+			if (!worldBrush[b] || (brush.contents & MASK_PLAYERSOLID_BRUSHONLY) == 0)
+				continue;
+
+			// a box brush has one axial plane per side, anything else can't be represented
+			Vector mins, maxs;
+			int sidesFound = 0;
+			bool isBox = brush.numsides == 6;
+			for (int i = 0; isBox && i < brush.numsides; ++i)
+			{
+				size_t sideIndex = brush.firstside + i;
+				if (sideIndex >= brushsides.size() || brushsides[sideIndex].planenum >= planes.size())
+				{
+					isBox = false;
+					break;
+				}
+				const dplane_t& plane = planes[brushsides[sideIndex].planenum];
+				if (plane.type > PLANE_Z)
+				{
+					isBox = false;
+					break;
+				}
+				if (plane.normal[plane.type] > 0)
+				{
+					maxs[plane.type] = plane.dist;
+					sidesFound |= 1 << (plane.type * 2);
+				}
+				else
+				{
+					mins[plane.type] = -plane.dist;
+					sidesFound |= 1 << (plane.type * 2 + 1);
+				}
+			}
+
+			if (isBox && sidesFound == 0x3f)
+				AddBox(mins, maxs);
+			else
+				skipped++;
+		}
+
+		if (skipped > 0)
+			DevMsg("Strafe sim: skipped %u non axis-aligned brushes\n", skipped);
+
+		return true;
+	}
+
+	void PlaneWorld::TracePlayer(trace_t& trace, const Vector& start, const Vector& end, HullType hull) const
+	{
+		Vector hullMins, hullMaxs;
+		GetHullExtents(hull, hullMins, hullMaxs);
+
+		ClipState st{1.f, Vector(0, 0, 0), false, false};
+		ClipToBox(Vector(-WORLD_EXTENT, -WORLD_EXTENT, -WORLD_EXTENT) - hullMaxs,
+		          Vector(WORLD_EXTENT, WORLD_EXTENT, z) - hullMins,
+		          start,
+		          end,
+		          st);
+		FillTrace(trace, start, end, st);
+	}
+
+	// What the game does with the ProcessedFrame once it's turned into a usercmd
+	static void ApplyInput(PlayerData& player, const MovementVars& vars, const ProcessedFrame& out)
+	{
+		double yaw = out.Yaw * M_DEG2RAD;
+		double fmove = out.ForwardSpeed;
+		double smove = out.SideSpeed;
+		if (vars.ReduceWishspeed)
+		{
+			fmove *= 0.33333333f;
+			smove *= 0.33333333f;
+		}
+
+		double wishX = std::cos(yaw) * fmove + std::sin(yaw) * smove;
+		double wishY = std::sin(yaw) * fmove - std::cos(yaw) * smove;
+		double wishspeed = std::sqrt(wishX * wishX + wishY * wishY);
+		if (wishspeed == 0)
+			return;
+
+		Vector2D wishdir(static_cast<float>(wishX / wishspeed), static_cast<float>(wishY / wishspeed));
+		wishspeed = std::min(wishspeed, static_cast<double>(vars.Maxspeed));
+		VectorFME(player, vars, vars.OnGround, wishspeed, wishdir);
+	}
+
+	SimResult Simulate(const SimSetup& setup, const SimParams& params)
+	{
+		const TraceBackend* oldBackend = GetThreadTraceBackend();
+		SetThreadTraceBackend(setup.world);
+
+		SimResult result;
+		result.end = setup.start;
+		result.endYaw = setup.startYaw;
+		result.maxSpeed = setup.start.Velocity.Length2D();
+		result.groundTicks = 0;
+		result.goalTick = -1;
+
+		PlayerData& player = result.end;
+		MovementVars vars = setup.vars;
+		const float jumpSpeed = std::sqrt(2 * vars.Gravity * setup.jumpHeight);
+		const float goalRadiusSqr = setup.goalRadius * setup.goalRadius;
+
+		// same order of operations as TASFeature::Strafe() followed by the game's movement code
+		for (int tick = 0; tick < params.ticks; ++tick)
+		{
+			auto hull = player.Ducking ? HullType::DUCKED : HullType::NORMAL;
+			vars.OnGround = GetPositionType(player, hull) == PositionType::GROUND;
+			bool jumped = false;
+
+			if (vars.OnGround)
+			{
+				result.groundTicks++;
+				if (!vars.CantJump && (params.autojump || (params.lgagst && LgagstJump(player, vars))))
+				{
+					player.Velocity[2] = jumpSpeed;
+					vars.OnGround = false;
+					jumped = true;
+				}
+			}
+
+			Friction(player, vars.OnGround, vars);
+
+			// Strafe() writes its own prediction of the new velocity into the player, the input is applied below
+			PlayerData predicted = player;
+			ProcessedFrame out;
+			if (params.input.Vectorial)
+			{
+				StrafeVectorial(predicted,
+				                vars,
+				                params.input,
+				                jumped,
+				                params.type,
+				                params.dir,
+				                result.endYaw,
+				                out,
+				                false);
+			}
+			else
+			{
+				Strafe(predicted,
+				       vars,
+				       params.input,
+				       jumped,
+				       params.type,
+				       params.dir,
+				       result.endYaw,
+				       out,
+				       params.buttons,
+				       params.useGivenButtons);
+			}
+
+			if (out.Processed)
+			{
+				result.endYaw = out.Yaw;
+				ApplyInput(player, vars, out);
+			}
+
+			Move(player, vars);
+
+			result.maxSpeed = std::max(result.maxSpeed, player.Velocity.Length2D());
+			if (setup.goalRadius > 0 && (player.UnduckedOrigin - setup.goal).LengthSqr() <= goalRadiusSqr)
+			{
+				result.goalTick = tick + 1;
+				break;
+			}
+		}
+
+		SetThreadTraceBackend(oldBackend);
+		return result;
+	}
+
+	void SimulateMany(const SimSetup& setup, const std::vector<SimParams>& params, std::vector<SimResult>& results)
+	{
+		results.resize(params.size());
+		// the parameter sets are independent and similarly sized, small chunks keep the workers busy
+		utils::GetThreadPool().ParallelFor(
+		    params.size(),
+		    [&](size_t i) { results[i] = Simulate(setup, params[i]); },
+		    4);
+	}
+} // namespace Strafe
@@ -0,0 +1,102 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "strafestuff.hpp"
+
+// Offline movement simulation: runs the Strafe:: movement code against a simple collision world instead of
+// the game, so that many strafe parameter sets can be tried in parallel without playing them back.
+
+namespace Strafe
+{
+	// Solid world made of axis-aligned boxes, either added by hand or loaded from the box brushes of a bsp
+	class BrushWorld : public TraceBackend
+	{
+	public:
+		void Clear();
+		void AddBox(const Vector& mins, const Vector& maxs);
+		// a solid slab that covers the whole map with its top at z
+		void AddGroundPlane(float z);
+		// adds every axis-aligned player solid brush of the world, other brushes are ignored
+		bool LoadFromBsp(const std::string& path, const char** err);
+		// builds the broadphase grid, must be called after adding boxes and before tracing
+		void Build();
+
+		size_t GetBoxCount() const
+		{
+			return boxes.size();
+		}
+
+		virtual void TracePlayer(trace_t& trace, const Vector& start, const Vector& end, HullType hull) const override;
+
+	private:
+		struct Box
+		{
+			Vector mins;
+			Vector maxs;
+		};
+
+		std::vector<Box> boxes;
+		// boxes too big for the grid (e.g. ground planes), always tested
+		std::vector<uint32_t> bigBoxes;
+		// xy grid of box indices
+		std::vector<std::vector<uint32_t>> cells;
+		float gridMinX = 0, gridMinY = 0;
+		int gridW = 0, gridH = 0;
+	};
+
+	// Infinite flat floor at the given height, the simplest possible world
+	class PlaneWorld : public TraceBackend
+	{
+	public:
+		explicit PlaneWorld(float z = 0) : z(z) {}
+
+		virtual void TracePlayer(trace_t& trace, const Vector& start, const Vector& end, HullType hull) const override;
+
+	private:
+		float z;
+	};
+
+	// Everything that is shared between the parameter sets of one search
+	struct SimSetup
+	{
+		const TraceBackend* world = nullptr;
+		PlayerData start;
+		MovementVars vars;
+		double startYaw = 0;
+		// jump velocity is sqrt(2 * gravity * jumpHeight) like in the game
+		float jumpHeight = 21;
+		// stop as soon as the player gets within goalRadius of goal, disabled if the radius is <= 0
+		Vector goal;
+		float goalRadius = 0;
+	};
+
+	// One set of tas_strafe_* parameters to try
+	struct SimParams
+	{
+		StrafeInput input;
+		StrafeType type = StrafeType::MAXACCEL;
+		StrafeDir dir = StrafeDir::YAW;
+		StrafeButtons buttons;
+		bool useGivenButtons = false;
+		bool autojump = true;
+		bool lgagst = false;
+		int ticks = 0;
+	};
+
+	struct SimResult
+	{
+		PlayerData end;
+		double endYaw;
+		float maxSpeed;
+		int groundTicks;
+		// first tick in the goal radius, -1 if it was never reached
+		int goalTick;
+	};
+
+	SimResult Simulate(const SimSetup& setup, const SimParams& params);
+
+	// Simulates every parameter set on the shared thread pool, results are in the same order as params
+	void SimulateMany(const SimSetup& setup, const std::vector<SimParams>& params, std::vector<SimResult>& results);
+} // namespace Strafe
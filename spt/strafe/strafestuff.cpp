@@ -12,6 +12,7 @@
 #include "const.h"
 #include "strafe_utils.hpp"
 #include "strafestuff.hpp"
+#include "strafe_batch.hpp"
 #include "ent_utils.hpp"
 #include "game_detection.hpp"
 #include "math.hpp"
@@ -81,8 +82,26 @@ namespace Strafe
 		*mv = oldmv;
 	}
 
+	static thread_local const TraceBackend* threadTraceBackend = nullptr;
+
+	void SetThreadTraceBackend(const TraceBackend* backend)
+	{
+		threadTraceBackend = backend;
+	}
+
+	const TraceBackend* GetThreadTraceBackend()
+	{
+		return threadTraceBackend;
+	}
+
 	void TracePlayer(trace_t& trace, const Vector& start, const Vector& end, HullType hull)
 	{
+		if (threadTraceBackend)
+		{
+			threadTraceBackend->TracePlayer(trace, start, end, hull);
+			return;
+		}
+
 #ifndef OE
 		if (!CanTrace())
 			return;
@@ -186,6 +205,23 @@ namespace Strafe
 	{
 		// TODO: Check water. If we're under water, return here.
 		// Check ground.
+		if (threadTraceBackend)
+		{
+			if (player.Velocity[2] > 140.f)
+				return PositionType::AIR;
+
+			trace_t tr;
+			Vector point = player.UnduckedOrigin;
+			point[2] -= 2;
+
+			TracePlayer(tr, player.UnduckedOrigin, point, hull);
+			if (tr.fraction == 1.0f || tr.plane.normal[2] < 0.7 || tr.startsolid)
+				return PositionType::AIR;
+
+			VecCopy<Vector, 3>(tr.endpos, player.UnduckedOrigin);
+			return PositionType::GROUND;
+		}
+
 		int strafe_version = tas_strafe_version.GetInt();
 
 		if (!tas_strafe_use_tracing.GetBool() || strafe_version == 0 || !CanTrace()
@@ -745,6 +781,25 @@ namespace Strafe
 			return Button::BACK;
 	}
 
+	static Button GetSideStrafeButton(const StrafeButtons& strafeButtons,
+	                                  bool useGivenButtons,
+	                                  bool onground,
+	                                  double theta,
+	                                  bool right)
+	{
+		if (useGivenButtons)
+		{
+			if (!onground)
+				return right ? strafeButtons.AirRight : strafeButtons.AirLeft;
+			else
+				return right ? strafeButtons.GroundRight : strafeButtons.GroundLeft;
+		}
+		else
+		{
+			return GetBestButtons(theta, right);
+		}
+	}
+
 	void SideStrafeGeneral(const PlayerData& player,
 	                       const MovementVars& vars,
 	                       bool onground,
@@ -758,27 +813,7 @@ namespace Strafe
 	                       Vector2D& velocity,
 	                       double& yaw)
 	{
-		if (useGivenButtons)
-		{
-			if (!onground)
-			{
-				if (right)
-					usedButton = strafeButtons.AirRight;
-				else
-					usedButton = strafeButtons.AirLeft;
-			}
-			else
-			{
-				if (right)
-					usedButton = strafeButtons.GroundRight;
-				else
-					usedButton = strafeButtons.GroundLeft;
-			}
-		}
-		else
-		{
-			usedButton = GetBestButtons(theta, right);
-		}
+		usedButton = GetSideStrafeButton(strafeButtons, useGivenButtons, onground, theta, right);
 		double phi = ButtonsPhi(usedButton);
 		theta = right ? -theta : theta;
 
@@ -793,6 +828,44 @@ namespace Strafe
 		velocity = pl.Velocity.AsVector2D();
 	}
 
+	void SideStrafeBatch(const PlayerData& player,
+	                     const MovementVars& vars,
+	                     bool onground,
+	                     double wishspeed,
+	                     const StrafeButtons& strafeButtons,
+	                     bool useGivenButtons,
+	                     double vel_yaw,
+	                     const double* thetas,
+	                     size_t count,
+	                     bool right,
+	                     Button* usedButtons,
+	                     Vector2D* velocities,
+	                     double* yaws)
+	{
+		// reused between calls to avoid allocating, the strafe simulator calls this from worker threads
+		static thread_local AccelBatch batch;
+		batch.Clear();
+
+		if (!player.Velocity.AsVector2D().IsZero(0))
+			vel_yaw = Atan2(player.Velocity.y, player.Velocity.x);
+
+		for (size_t i = 0; i < count; ++i)
+		{
+			usedButtons[i] = GetSideStrafeButton(strafeButtons, useGivenButtons, onground, thetas[i], right);
+			double phi = ButtonsPhi(usedButtons[i]);
+			double theta = right ? -thetas[i] : thetas[i];
+			yaws[i] = NormalizeRad(vel_yaw - phi + theta);
+
+			Vector2D avec(std::cos(yaws[i] + phi), std::sin(yaws[i] + phi));
+			batch.Add(player, vars, onground, wishspeed, avec);
+		}
+
+		batch.Run();
+
+		for (size_t i = 0; i < count; ++i)
+			velocities[i] = batch.GetVelocity(i);
+	}
+
 	double YawStrafeMaxAccel(PlayerData& player,
 	                         const MovementVars& vars,
 	                         bool onground,
@@ -870,24 +943,10 @@ namespace Strafe
 
 		Vector2D newvel;
 		double resulting_yaw;
-		SideStrafeGeneral(player,
-		                  vars,
-		                  onground,
-		                  wishspeed,
-		                  strafeButtons,
-		                  useGivenButtons,
-		                  usedButton,
-		                  vel_yaw,
-		                  theta,
-		                  (NormalizeRad(yaw - vel_yaw) < 0),
-		                  newvel,
-		                  resulting_yaw);
+		bool right = (NormalizeRad(yaw - vel_yaw) < 0);
 
-		if (safeguard_yaw)
+		if (!safeguard_yaw)
 		{
-			Vector2D test_vel1, test_vel2;
-			double test_yaw1, test_yaw2;
-
 			SideStrafeGeneral(player,
 			                  vars,
 			                  onground,
@@ -896,22 +955,43 @@ namespace Strafe
 			                  useGivenButtons,
 			                  usedButton,
 			                  vel_yaw,
-			                  std::min(theta - SAFEGUARD_THETA_DIFFERENCE_RAD, 0.0),
-			                  (NormalizeRad(yaw - vel_yaw) < 0),
-			                  test_vel1,
-			                  test_yaw1);
-			SideStrafeGeneral(player,
-			                  vars,
-			                  onground,
-			                  wishspeed,
-			                  strafeButtons,
-			                  useGivenButtons,
-			                  usedButton,
-			                  vel_yaw,
-			                  std::max(theta + SAFEGUARD_THETA_DIFFERENCE_RAD, 0.0),
-			                  (NormalizeRad(yaw - vel_yaw) < 0),
-			                  test_vel2,
-			                  test_yaw2);
+			                  theta,
+			                  right,
+			                  newvel,
+			                  resulting_yaw);
+			//DevMsg("theta = %.08f, yaw = %.08f, vel_yaw = %.08f, speed = %.08f\n", theta, yaw, vel_yaw, player.Velocity.Length2D());
+		}
+		else
+		{
+			const double thetas[] = {
+			    theta,
+			    std::min(theta - SAFEGUARD_THETA_DIFFERENCE_RAD, 0.0),
+			    std::max(theta + SAFEGUARD_THETA_DIFFERENCE_RAD, 0.0),
+			};
+			Button usedButtons[ARRAYSIZE(thetas)];
+			Vector2D vels[ARRAYSIZE(thetas)];
+			double yaws[ARRAYSIZE(thetas)];
+
+			SideStrafeBatch(player,
+			                vars,
+			                onground,
+			                wishspeed,
+			                strafeButtons,
+			                useGivenButtons,
+			                vel_yaw,
+			                thetas,
+			                ARRAYSIZE(thetas),
+			                right,
+			                usedButtons,
+			                vels,
+			                yaws);
+
+			newvel = vels[0];
+			resulting_yaw = yaws[0];
+			Vector2D test_vel1 = vels[1], test_vel2 = vels[2];
+			double test_yaw1 = yaws[1], test_yaw2 = yaws[2];
+			// the candidates used to be evaluated one after another, keep the button of the last one
+			usedButton = usedButtons[2];
 
 			double cos_test1 = test_vel1.Dot(player.Velocity.AsVector2D())
 			                   / (player.Velocity.Length2D() * test_vel1.Length());
@@ -944,10 +1024,6 @@ namespace Strafe
 				cos_newvel = cos_test2;
 			}
 		}
-		else
-		{
-			//DevMsg("theta = %.08f, yaw = %.08f, vel_yaw = %.08f, speed = %.08f\n", theta, yaw, vel_yaw, player.Velocity.Length2D());
-		}
 
 		player.Velocity.AsVector2D() = newvel;
 		return resulting_yaw;
@@ -155,6 +155,22 @@ namespace Strafe
 		POINT = 2
 	};
 
+	/*
+	* Collision backend for running the movement code outside of the game (see strafe_sim.hpp). When a
+	* backend is set on a thread, TracePlayer() and GetPositionType() on that thread only use the backend
+	* and never touch the game.
+	*/
+	class TraceBackend
+	{
+	public:
+		virtual ~TraceBackend() = default;
+		virtual void TracePlayer(trace_t& trace, const Vector& start, const Vector& end, HullType hull) const = 0;
+	};
+
+	// nullptr goes back to tracing in the game
+	void SetThreadTraceBackend(const TraceBackend* backend);
+	const TraceBackend* GetThreadTraceBackend();
+
 	void TracePlayer(trace_t& trace, const Vector& start, const Vector& end, HullType hull);
 	void Trace(trace_t& trace, const Vector& start, const Vector& end);
 
@@ -205,6 +221,21 @@ namespace Strafe
 	                       Vector2D& velocity,
 	                       double& yaw);
 
+	// Same as calling SideStrafeGeneral for every theta, but the acceleration is done in one SIMD batch.
+	void SideStrafeBatch(const PlayerData& player,
+	                     const MovementVars& vars,
+	                     bool onground,
+	                     double wishspeed,
+	                     const StrafeButtons& strafeButtons,
+	                     bool useGivenButtons,
+	                     double vel_yaw,
+	                     const double* thetas,
+	                     size_t count,
+	                     bool right,
+	                     Button* usedButtons,
+	                     Vector2D* velocities,
+	                     double* yaws);
+
 	double YawStrafeMaxAccel(PlayerData& player,
 	                         const MovementVars& vars,
 	                         bool onground,
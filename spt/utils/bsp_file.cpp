@@ -0,0 +1,123 @@
+#include "stdafx.hpp"
+
+#include "bsp_file.hpp"
+
+#include <stack>
+
+#include "game_detection.hpp"
+
+namespace utils
+{
+	BspFile::~BspFile()
+	{
+		if (view)
+			UnmapViewOfFile(view);
+		if (mapping)
+			CloseHandle(mapping);
+		if (file != INVALID_HANDLE_VALUE)
+			CloseHandle(file);
+	}
+
+	bool BspFile::Open(const std::string& path, const char** err)
+	{
+		file = CreateFileA(path.c_str(),
+		                   GENERIC_READ,
+		                   FILE_SHARE_READ,
+		                   NULL,
+		                   OPEN_EXISTING,
+		                   FILE_ATTRIBUTE_NORMAL | FILE_FLAG_RANDOM_ACCESS,
+		                   NULL);
+		if (file == INVALID_HANDLE_VALUE)
+		{
+			*err = "Cannot open file.";
+			return false;
+		}
+		LARGE_INTEGER fileSize;
+		if (!GetFileSizeEx(file, &fileSize) || fileSize.QuadPart < (LONGLONG)sizeof(dheader_t)
+		    || fileSize.QuadPart > INT32_MAX)
+		{
+			*err = "Unexpected EOF.";
+			return false;
+		}
+		mapping = CreateFileMappingW(file, NULL, PAGE_READONLY, 0, 0, NULL);
+		if (mapping)
+			view = (const std::byte*)MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+		if (!view)
+		{
+			*err = "Cannot map file.";
+			return false;
+		}
+		viewSize = (size_t)fileSize.QuadPart;
+
+		header = (const dheader_t*)view;
+		if (header->ident != IDBSPHEADER)
+		{
+			*err = "Not a bsp file.";
+			return false;
+		}
+
+		if (header->version != 20 && header->version != 19
+		    && !(utils::DoesGameLookLikeDMoMM() && (header->version >> 16) != 20))
+		{
+			*err = "Unsupported bsp version.";
+			return false;
+		}
+		return true;
+	}
+
+	bool BspFile::GetWorldBrushes(std::vector<bool>& out, const char** err) const
+	{
+		std::span<const dnode_t> nodes;
+		std::span<const dleaf_version_0_t> leaves_v0;
+		std::span<const dleaf_t> leaves;
+		std::span<const uint16_t> leafbrushes;
+		std::span<const dbrush_t> brushes;
+		if (!GetLump(LUMP_NODES, nodes, err) || !GetLump(LUMP_LEAFBRUSHES, leafbrushes, err)
+		    || !GetLump(LUMP_BRUSHES, brushes, err))
+		{
+			return false;
+		}
+		if (GetVersion() < 20 ? !GetLump(LUMP_LEAFS, leaves_v0, err) : !GetLump(LUMP_LEAFS, leaves, err))
+			return false;
+		if (nodes.empty())
+		{
+			*err = "Map has no nodes.";
+			return false;
+		}
+
+		out.assign(brushes.size(), false);
+		std::vector<bool> visited(nodes.size());
+		std::stack<int, std::vector<int>> s;
+		s.push(0);
+		while (!s.empty())
+		{
+			int curr = s.top();
+			s.pop();
+			if (curr >= 0)
+			{
+				// a broken file could have cycles in the tree
+				if ((size_t)curr >= nodes.size() || visited[curr])
+					continue;
+				visited[curr] = true;
+				s.push(nodes[curr].children[0]);
+				s.push(nodes[curr].children[1]);
+				continue;
+			}
+
+			size_t leafIndex = -1 - curr;
+			if (leafIndex >= std::max(leaves.size(), leaves_v0.size()))
+				continue;
+			int firstleafbrush =
+			    GetVersion() < 20 ? leaves_v0[leafIndex].firstleafbrush : leaves[leafIndex].firstleafbrush;
+			int numleafbrushes =
+			    GetVersion() < 20 ? leaves_v0[leafIndex].numleafbrushes : leaves[leafIndex].numleafbrushes;
+			for (int i = 0; i < numleafbrushes && (size_t)(firstleafbrush + i) < leafbrushes.size(); i++)
+			{
+				uint16_t brushIndex = leafbrushes[firstleafbrush + i];
+				if (brushIndex < out.size())
+					out[brushIndex] = true;
+			}
+		}
+		return true;
+	}
+} // namespace utils
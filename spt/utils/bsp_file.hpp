@@ -0,0 +1,55 @@
+#pragma once
+
+#include <span>
+#include <string>
+#include <vector>
+
+#include "bspfile.h"
+
+namespace utils
+{
+	/*
+	* A read-only view of a bsp file. The file is mapped instead of read so lumps are used in place without
+	* copying and only the lumps that are actually looked at get paged in.
+	*/
+	class BspFile
+	{
+	public:
+		BspFile() = default;
+		~BspFile();
+		BspFile(const BspFile&) = delete;
+		BspFile& operator=(const BspFile&) = delete;
+
+		// maps the file and checks the header, on failure err is set and nothing else should be called
+		bool Open(const std::string& path, const char** err);
+
+		int GetVersion() const
+		{
+			return header->version;
+		}
+
+		// the lump as an array of T, false if it doesn't fit in the file
+		template<typename T>
+		bool GetLump(int lump, std::span<const T>& out, const char** err) const
+		{
+			const lump_t& info = header->lumps[lump];
+			if (info.fileofs < 0 || info.filelen < 0 || (size_t)info.fileofs + (size_t)info.filelen > viewSize)
+			{
+				*err = "Unexpected EOF.";
+				return false;
+			}
+			out = {(const T*)(view + info.fileofs), info.filelen / sizeof(T)};
+			return true;
+		}
+
+		// which brushes are reachable from the world's head node, brush entities are not included
+		bool GetWorldBrushes(std::vector<bool>& out, const char** err) const;
+
+	private:
+		HANDLE file = INVALID_HANDLE_VALUE;
+		HANDLE mapping = NULL;
+		const std::byte* view = nullptr;
+		size_t viewSize = 0;
+		const dheader_t* header = nullptr;
+	};
+} // namespace utils
@@ -1,5 +1,7 @@
 #include "stdafx.hpp"
 
+#include <algorithm>
+
 #include "convar.hpp"
 #include "file.hpp"
 
@@ -53,8 +55,8 @@ std::pair<std::string, std::string> AutoCompleteList::SplitPartial(const char* p
 	return {s.substr(0, pos), s.substr(pos)};
 }
 
-FileAutoCompleteList::FileAutoCompleteList(const char* subDirectory, const char* extension)
-    : AutoCompleteList(), subDirectory(subDirectory), extension(extension)
+FileAutoCompleteList::FileAutoCompleteList(const char* subDirectory, std::vector<std::string> extensions)
+    : AutoCompleteList(), subDirectory(subDirectory), extensions(std::move(extensions))
 {
 }
 
@@ -99,10 +101,16 @@ int FileAutoCompleteList::AutoCompletionFunc(AUTOCOMPLETION_FUNCTION_PARAMS)
 			{
 				// don't use extension() & stem() to support extensions with multiple dots
 				std::string filename = p.path().filename().string();
-				if (filename.size() > extension.size() && filename.ends_with(extension))
+				for (auto& extension : extensions)
 				{
-					std::string stem = filename.substr(0, filename.size() - extension.size());
-					completions.push_back(completionPath + stem);
+					if (filename.size() > extension.size() && filename.ends_with(extension))
+					{
+						std::string stem = completionPath + filename.substr(0, filename.size() - extension.size());
+						// the same name can exist with several of the extensions
+						if (std::find(completions.begin(), completions.end(), stem) == completions.end())
+							completions.push_back(std::move(stem));
+						break;
+					}
 				}
 			}
 		}
@@ -145,12 +145,13 @@ protected:
 class FileAutoCompleteList : public AutoCompleteList
 {
 public:
-	FileAutoCompleteList(const char* subDirectory, const char* extension);
+	// files with any of the extensions are listed, with the extension cut off
+	FileAutoCompleteList(const char* subDirectory, std::vector<std::string> extensions);
 	int AutoCompletionFunc(AUTOCOMPLETION_FUNCTION_PARAMS);
 
 private:
 	const char* subDirectory;
-	std::string extension;
+	std::vector<std::string> extensions;
 	std::filesystem::path prevPath;
 };
 
@@ -221,15 +222,15 @@ struct ArgsWrapper
 
 #define AUTOCOMPLETION_FUNCTION(command) command##_CompletionFunc
 
-#define DEFINE_AUTOCOMPLETIONFILE_FUNCTION(command, subdirectory, extension) \
-	static FileAutoCompleteList command##Complete(subdirectory, extension); \
+#define DEFINE_AUTOCOMPLETIONFILE_FUNCTION(command, subdirectory, ...) \
+	static FileAutoCompleteList command##Complete(subdirectory, {__VA_ARGS__}); \
 	static int AUTOCOMPLETION_FUNCTION(command)(AUTOCOMPLETION_FUNCTION_PARAMS) \
 	{ \
 		return command##Complete.AutoCompletionFunc(partial, commands); \
 	}
 
-#define CON_COMMAND_AUTOCOMPLETEFILE(name, description, flags, subdirectory, extension) \
-	DEFINE_AUTOCOMPLETIONFILE_FUNCTION(name, subdirectory, extension) \
+#define CON_COMMAND_AUTOCOMPLETEFILE(name, description, flags, subdirectory, ...) \
+	DEFINE_AUTOCOMPLETIONFILE_FUNCTION(name, subdirectory, __VA_ARGS__) \
 	CON_COMMAND_F_COMPLETION(name, description, flags, AUTOCOMPLETION_FUNCTION(name))
 
 #define DEFINE_AUTOCOMPLETION_FUNCTION(command, completion) \
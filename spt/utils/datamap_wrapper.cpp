@@ -32,6 +32,13 @@ namespace utils
 			return INVALID_DATAMAP_OFFSET;
 	}
 
+	const std::unordered_map<std::string, int>& DatamapWrapper::GetOffsets(bool server)
+	{
+		if (!offsetsCached)
+			CacheOffsets();
+		return server ? serverOffsets : clientOffsets;
+	}
+
 	void DatamapWrapper::ExploreOffsets()
 	{
 		for (int i = 0; i < 2; i++)
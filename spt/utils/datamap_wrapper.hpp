@@ -16,6 +16,8 @@ namespace utils
 		DatamapWrapper();
 		int GetClientOffset(const std::string& key);
 		int GetServerOffset(const std::string& key);
+		// all fields of the server or client map, embedded fields are named parentField.childField
+		const std::unordered_map<std::string, int>& GetOffsets(bool server);
 		void ExploreOffsets();
 
 	private:
@@ -7,6 +7,8 @@
 #include "icliententity.h"
 #include "basehandle.h"
 
+struct edict_t;
+
 namespace utils
 {
 	struct PortalInfo
@@ -40,10 +42,14 @@ namespace utils
 
 	/*
 	* A server/client entity list abstraction. Stores an internal list for all entities which is
-	* rebuilt every tick/frame for server/client. Also does the same for portals. All portal info
+	* updated every tick/frame for server/client. Also does the same for portals. All portal info
 	* is returned by POINTERS which should NOT be stored inside a feature. All pointers are invalid
 	* on the next tick/frame. If required, portal info can be copied and stored by value, but this
 	* should not be necessary for most features.
+	*
+	* The client list is rebuilt from scratch every frame. The server list is only rescanned fully
+	* on level init or when it looks out of sync with the engine, otherwise just the slots that the
+	* edict allocated/freed callbacks reported are looked at again.
 	*/
 	template<bool SERVER>
 	class SptEntList
@@ -55,7 +61,25 @@ namespace utils
 		std::vector<PortalInfo> _portalList;
 		int lastUpdatedAt = -666;
 
+		// server only, the slot of every entity in _entList (both sorted by slot)
+		std::vector<int> _entSlots;
+		// server only, per slot state so that entities don't have to be looked up again every tick
+		std::vector<ent_type> slotEnts;
+		std::vector<int> slotClassIds; // ServerClass::m_ClassID, -1 if the slot is empty
+		std::vector<bool> slotDirty;
+		std::vector<int> dirtySlots;
+		std::vector<int> portalSlots; // sorted
+		int portalClassId = -1;
+		bool needFullScan = true;
+		bool listeningToEdicts = false;
+
 		void FillPortalInfo(ent_type ent, PortalInfo& info);
+		void FullScan();
+		void UpdateSlot(int index);
+		void MarkSlotDirty(const edict_t* ed);
+		void OnEdictAllocated(edict_t* ed);
+		void OnEdictFreed(const edict_t* ed);
+		void OnLevelInit(const char* mapName);
 
 		SptEntList() = default;
 		SptEntList(SptEntList&) = delete;
@@ -3,6 +3,7 @@
 #include "ent_list.hpp"
 #include "spt\features\ent_props.hpp"
 #include "interfaces.hpp"
+#include "signals.hpp"
 
 #include "server_class.h"
 
@@ -15,23 +16,151 @@ void utils::SptEntListServer::CheckRebuildLists(bool force)
 	if (newTick == lastUpdatedAt && !force)
 		return;
 	lastUpdatedAt = newTick;
-	_entList.clear();
-	_portalList.clear();
+
+	if (!listeningToEdicts)
+	{
+		listeningToEdicts = true;
+		OnEdictAllocatedSignal.Connect(this, &SptEntList::OnEdictAllocated);
+		OnEdictFreedSignal.Connect(this, &SptEntList::OnEdictFreed);
+		LevelInitSignal.Connect(this, &SptEntList::OnLevelInit);
+		slotEnts.assign(MAX_EDICTS, nullptr);
+		slotClassIds.assign(MAX_EDICTS, -1);
+		slotDirty.assign(MAX_EDICTS, false);
+	}
+
 	if (!Valid())
+	{
+		_entList.clear();
+		_entSlots.clear();
+		_portalList.clear();
+		portalSlots.clear();
+		needFullScan = true;
 		return;
+	}
+
+	// without the edict callbacks (OE) there's no way to tell what changed
+	if (force || !OnEdictAllocatedSignal.Works || !OnEdictFreedSignal.Works)
+		needFullScan = true;
+
+	if (!needFullScan)
+	{
+		for (int index : dirtySlots)
+			UpdateSlot(index);
+		// missed a callback somewhere, e.g. if the plugin was loaded in the middle of a map
+		if ((int)_entList.size() != interfaces::engine_server->GetEntityCount())
+			needFullScan = true;
+	}
+	for (int index : dirtySlots)
+		slotDirty[index] = false;
+	dirtySlots.clear();
+
+	if (needFullScan)
+		FullScan();
+
+	// portals move around, so their info is refreshed every tick
+	_portalList.resize(portalSlots.size());
+	for (size_t i = 0; i < portalSlots.size(); i++)
+		FillPortalInfo(slotEnts[portalSlots[i]], _portalList[i]);
+}
+
+template<>
+void utils::SptEntListServer::FullScan()
+{
+	needFullScan = false;
+	_entList.clear();
+	_entSlots.clear();
+	portalSlots.clear();
+	portalClassId = -1;
+	std::fill(slotEnts.begin(), slotEnts.end(), nullptr);
+	std::fill(slotClassIds.begin(), slotClassIds.end(), -1);
+
 	int maxNEnts = interfaces::engine_server->GetEntityCount();
 	for (int i = 0; (int)_entList.size() < maxNEnts && i < MAX_EDICTS; i++)
 	{
 		IServerEntity* ent = GetEnt(i);
-		if (!ent)
-			continue;
-		_entList.push_back(ent);
-		if (EntIsPortal(ent))
+		if (ent)
+			UpdateSlot(i);
+	}
+}
+
+template<>
+void utils::SptEntListServer::UpdateSlot(int index)
+{
+	IServerEntity* ent = GetEnt(index);
+	auto slotIt = std::lower_bound(_entSlots.begin(), _entSlots.end(), index);
+	auto entIt = _entList.begin() + (slotIt - _entSlots.begin());
+	bool present = slotIt != _entSlots.end() && *slotIt == index;
+	auto portalIt = std::lower_bound(portalSlots.begin(), portalSlots.end(), index);
+	bool wasPortal = portalIt != portalSlots.end() && *portalIt == index;
+
+	slotEnts[index] = ent;
+	if (!ent)
+	{
+		if (present)
 		{
-			_portalList.emplace_back();
-			FillPortalInfo(ent, _portalList.back());
+			_entSlots.erase(slotIt);
+			_entList.erase(entIt);
 		}
+		if (wasPortal)
+			portalSlots.erase(portalIt);
+		slotClassIds[index] = -1;
+		return;
 	}
+
+	if (present)
+	{
+		*entIt = ent;
+	}
+	else
+	{
+		_entSlots.insert(slotIt, index);
+		_entList.insert(entIt, ent);
+	}
+
+	constexpr int fOff = -(int)sizeof(CBaseHandle);
+	static CachedField<ServerClass*, "CBaseEntity", "m_Network.m_hParent", true, fOff> fClass;
+	ServerClass* serverClass = fClass.Exists() ? *fClass.GetPtr(ent) : nullptr;
+	int classId = serverClass ? serverClass->m_ClassID : -1;
+	slotClassIds[index] = classId;
+
+	// only compare names until the first portal shows up, after that the class id is enough
+	if (portalClassId == -1 && classId != -1 && EntIsPortal(ent))
+		portalClassId = classId;
+	bool isPortal = classId != -1 && classId == portalClassId;
+	if (isPortal && !wasPortal)
+		portalSlots.insert(portalIt, index);
+	else if (!isPortal && wasPortal)
+		portalSlots.erase(portalIt);
+}
+
+template<>
+void utils::SptEntListServer::MarkSlotDirty(const edict_t* ed)
+{
+	if (!ed || !interfaces::engine_server || slotDirty.empty())
+		return;
+	int index = interfaces::engine_server->IndexOfEdict(ed);
+	if (index < 0 || index >= MAX_EDICTS || slotDirty[index])
+		return;
+	slotDirty[index] = true;
+	dirtySlots.push_back(index);
+}
+
+template<>
+void utils::SptEntListServer::OnEdictAllocated(edict_t* ed)
+{
+	MarkSlotDirty(ed);
+}
+
+template<>
+void utils::SptEntListServer::OnEdictFreed(const edict_t* ed)
+{
+	MarkSlotDirty(ed);
+}
+
+template<>
+void utils::SptEntListServer::OnLevelInit(const char*)
+{
+	needFullScan = true;
 }
 
 template<>
@@ -0,0 +1,110 @@
+#include "stdafx.hpp"
+
+#include "field_table.hpp"
+#include "datamap_wrapper.hpp"
+
+#include <algorithm>
+#include <unordered_map>
+
+namespace utils
+{
+	// keys per bucket & empty slots, more of either makes building faster and the tables bigger
+	constexpr size_t KEYS_PER_BUCKET = 4;
+	constexpr size_t SLOTS_PER_KEY_NUM = 5, SLOTS_PER_KEY_DEN = 4;
+
+	void FieldTable::AddField(FieldKey key, int offset, bool server)
+	{
+		// only used while building
+		slots.clear();
+		entries.push_back({key.hash, server ? offset : INVALID_DATAMAP_OFFSET, server ? INVALID_DATAMAP_OFFSET : offset});
+	}
+
+	uint32_t FieldTable::GetSlot(uint64_t hash, uint32_t seed, size_t nSlots)
+	{
+		// murmur3 finalizer
+		uint64_t h = hash ^ (seed * 0x9E3779B97F4A7C15ull);
+		h ^= h >> 33;
+		h *= 0xFF51AFD7ED558CCDull;
+		h ^= h >> 33;
+		return (uint32_t)(h % nSlots);
+	}
+
+	void FieldTable::Build()
+	{
+		// merge the server & client offsets of the same keys
+		std::ranges::stable_sort(entries, {}, &Entry::hash);
+		size_t nUnique = 0;
+		for (size_t i = 0; i < entries.size(); i++)
+		{
+			if (nUnique > 0 && entries[nUnique - 1].hash == entries[i].hash)
+			{
+				Entry& merged = entries[nUnique - 1];
+				if (entries[i].serverOffset != INVALID_DATAMAP_OFFSET)
+					merged.serverOffset = entries[i].serverOffset;
+				if (entries[i].clientOffset != INVALID_DATAMAP_OFFSET)
+					merged.clientOffset = entries[i].clientOffset;
+			}
+			else
+			{
+				entries[nUnique++] = entries[i];
+			}
+		}
+		entries.resize(nUnique);
+
+		size_t nSlots = std::max<size_t>(entries.size() * SLOTS_PER_KEY_NUM / SLOTS_PER_KEY_DEN, 1);
+		seeds.assign(std::max<size_t>(entries.size() / KEYS_PER_BUCKET, 1), 0);
+		slots.assign(nSlots, UINT32_MAX);
+
+		std::vector<std::vector<uint32_t>> buckets(seeds.size());
+		for (uint32_t i = 0; i < entries.size(); i++)
+			buckets[GetBucket(entries[i].hash)].push_back(i);
+
+		// place the biggest buckets first while there's still lots of room
+		std::vector<uint32_t> bucketOrder(buckets.size());
+		for (uint32_t i = 0; i < bucketOrder.size(); i++)
+			bucketOrder[i] = i;
+		std::ranges::stable_sort(bucketOrder, std::greater{}, [&](uint32_t b) { return buckets[b].size(); });
+
+		std::vector<uint32_t> bucketSlots;
+		for (uint32_t b : bucketOrder)
+		{
+			if (buckets[b].empty())
+				break;
+			for (uint32_t seed = 0;; seed++)
+			{
+				bucketSlots.clear();
+				for (uint32_t idx : buckets[b])
+				{
+					uint32_t slot = GetSlot(entries[idx].hash, seed, nSlots);
+					if (slots[slot] != UINT32_MAX || std::ranges::find(bucketSlots, slot) != bucketSlots.end())
+						break;
+					bucketSlots.push_back(slot);
+				}
+				if (bucketSlots.size() == buckets[b].size())
+				{
+					seeds[b] = seed;
+					for (size_t i = 0; i < bucketSlots.size(); i++)
+						slots[bucketSlots[i]] = buckets[b][i];
+					break;
+				}
+			}
+		}
+	}
+
+	void FieldTable::Clear()
+	{
+		entries.clear();
+		seeds.clear();
+		slots.clear();
+	}
+
+	FieldHandle FieldTable::Find(FieldKey key) const
+	{
+		if (slots.empty())
+			return {};
+		uint32_t idx = slots[GetSlot(key.hash, seeds[GetBucket(key.hash)], slots.size())];
+		if (idx == UINT32_MAX || entries[idx].hash != key.hash)
+			return {};
+		return {idx};
+	}
+} // namespace utils
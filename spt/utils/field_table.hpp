@@ -0,0 +1,86 @@
+#pragma once
+
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+namespace utils
+{
+	// fnv-1a of the datamap name and the field name, constexpr so that keys made from literals are free
+	struct FieldKey
+	{
+		uint64_t hash;
+
+		constexpr FieldKey(std::string_view map, std::string_view field) : hash(HashStr(HashStr(FNV_BASIS, map), field))
+		{
+		}
+
+	private:
+		static constexpr uint64_t FNV_BASIS = 0xCBF29CE484222325ull;
+		static constexpr uint64_t FNV_PRIME = 0x100000001B3ull;
+
+		static constexpr uint64_t HashStr(uint64_t h, std::string_view str)
+		{
+			for (char c : str)
+				h = (h ^ (uint8_t)c) * FNV_PRIME;
+			// separator so that "ab" + "c" and "a" + "bc" are different keys
+			return (h ^ 0xFF) * FNV_PRIME;
+		}
+	};
+
+	struct FieldHandle
+	{
+		uint32_t idx = UINT32_MAX;
+
+		bool Valid() const
+		{
+			return idx != UINT32_MAX;
+		}
+	};
+
+	/*
+	* The fields of all datamaps flattened into one table with a perfect hash (hash and displace), so a lookup is
+	* two multiplies and two array reads. Resolve a FieldHandle once and the offsets are a plain array index from
+	* then on. Keys are only compared by their 64 bit hash, no strings are kept around.
+	*/
+	class FieldTable
+	{
+	public:
+		// add all fields before calling Build(), the server & client offset of the same key are merged
+		void AddField(FieldKey key, int offset, bool server);
+		void Build();
+		void Clear();
+
+		FieldHandle Find(FieldKey key) const;
+
+		int GetOffset(FieldHandle handle, bool server) const
+		{
+			auto& entry = entries[handle.idx];
+			return server ? entry.serverOffset : entry.clientOffset;
+		}
+
+		size_t GetFieldCount() const
+		{
+			return entries.size();
+		}
+
+	private:
+		struct Entry
+		{
+			uint64_t hash;
+			int serverOffset;
+			int clientOffset;
+		};
+
+		static uint32_t GetSlot(uint64_t hash, uint32_t seed, size_t nSlots);
+
+		size_t GetBucket(uint64_t hash) const
+		{
+			return (hash >> 32) % seeds.size();
+		}
+
+		std::vector<Entry> entries;
+		std::vector<uint32_t> seeds; // one per bucket
+		std::vector<uint32_t> slots; // index into entries or UINT32_MAX
+	};
+} // namespace utils
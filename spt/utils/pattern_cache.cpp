@@ -0,0 +1,143 @@
+#include "stdafx.hpp"
+
+#include "pattern_cache.hpp"
+
+#include <filesystem>
+#include <fstream>
+
+#include "file.hpp"
+#include "thirdparty\md5.hpp"
+
+#define PATTERN_CACHE_FILE_NAME "spt_pattern_cache.json"
+#define PATTERN_CACHE_VERSION 2
+
+namespace utils
+{
+	std::string PatternCache::GetModuleDigest(void* moduleHandle)
+	{
+		wchar_t path[MAX_PATH];
+		DWORD len = GetModuleFileNameW((HMODULE)moduleHandle, path, ARRAYSIZE(path));
+		if (len == 0 || len == ARRAYSIZE(path))
+			return "";
+
+		std::ifstream ifs(std::filesystem::path{path}, std::ios::binary);
+		if (!ifs.is_open())
+			return "";
+
+		MD5 md5;
+		std::vector<char> buf(1 << 20);
+		while (ifs.read(buf.data(), buf.size()) || ifs.gcount() > 0)
+			md5.update(buf.data(), (MD5::size_type)ifs.gcount());
+		if (ifs.bad())
+			return "";
+		return md5.finalize().hexdigest();
+	}
+
+	std::string PatternCache::GetPath() const
+	{
+		std::string gameDir = GetGameDir();
+		return gameDir.empty() ? "" : gameDir + "\\" PATTERN_CACHE_FILE_NAME;
+	}
+
+	void PatternCache::Load()
+	{
+		loaded = true;
+		std::string path = GetPath();
+		if (path.empty())
+			return;
+		std::ifstream ifs(path);
+		if (!ifs.is_open())
+			return;
+
+		try
+		{
+			nlohmann::json root = nlohmann::json::parse(ifs);
+			if (root.at("version").get<int>() != PATTERN_CACHE_VERSION)
+				return;
+
+			for (auto& [digest, jModule] : root.at("modules").items())
+			{
+				ModuleEntry entry;
+				entry.moduleName = jModule.at("name").get<std::string>();
+				entry.moduleSize = jModule.at("size").get<uint32_t>();
+				for (auto& [name, jFound] : jModule.at("hooks").items())
+					entry.hooks[name] = {jFound.at(0).get<int>(), jFound.at(1).get<uint32_t>()};
+				for (auto& [name, jMatches] : jModule.at("match_alls").items())
+				{
+					auto& matches = entry.matchAlls[name];
+					for (auto& jFound : jMatches)
+						matches.push_back({jFound.at(0).get<int>(), jFound.at(1).get<uint32_t>()});
+				}
+				entries[digest] = std::move(entry);
+			}
+		}
+		catch (const nlohmann::json::exception& ex)
+		{
+			DevWarning("Ignoring the pattern cache, failed to parse %s: %s\n", path.c_str(), ex.what());
+			entries.clear();
+		}
+	}
+
+	void PatternCache::Save()
+	{
+		if (!dirty)
+			return;
+		dirty = false;
+		std::string path = GetPath();
+		if (path.empty())
+			return;
+
+		nlohmann::json root;
+		root["version"] = PATTERN_CACHE_VERSION;
+		nlohmann::json& jModules = root["modules"] = nlohmann::json::object();
+		for (auto& [digest, entry] : entries)
+		{
+			nlohmann::json& jModule = jModules[digest];
+			jModule["name"] = entry.moduleName;
+			jModule["size"] = entry.moduleSize;
+			nlohmann::json& jHooks = jModule["hooks"] = nlohmann::json::object();
+			for (auto& [name, found] : entry.hooks)
+				jHooks[name] = {found.ptnIndex, found.offset};
+			nlohmann::json& jMatchAlls = jModule["match_alls"] = nlohmann::json::object();
+			for (auto& [name, matches] : entry.matchAlls)
+			{
+				nlohmann::json& jMatches = jMatchAlls[name] = nlohmann::json::array();
+				for (auto& found : matches)
+					jMatches.push_back({found.ptnIndex, found.offset});
+			}
+		}
+
+		std::ofstream ofs(path);
+		if (!ofs.is_open() || !(ofs << root.dump()).good())
+			DevWarning("Failed to write the pattern cache to %s\n", path.c_str());
+	}
+
+	const PatternCache::ModuleEntry* PatternCache::Find(const std::string& digest)
+	{
+		if (!loaded)
+			Load();
+		auto it = entries.find(digest);
+		return it == entries.end() ? nullptr : &it->second;
+	}
+
+	void PatternCache::Store(const std::string& digest, ModuleEntry entry)
+	{
+		if (!loaded)
+			Load();
+		// only keep the newest build of each module around
+		std::erase_if(entries, [&](auto& pair) { return pair.second.moduleName == entry.moduleName; });
+		entries[digest] = std::move(entry);
+		dirty = true;
+	}
+
+	void PatternCache::Invalidate(const std::string& digest)
+	{
+		dirty |= entries.erase(digest) > 0;
+	}
+
+	PatternCache& GetPatternCache()
+	{
+		static PatternCache cache;
+		return cache;
+	}
+} // namespace utils
@@ -0,0 +1,55 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace utils
+{
+	/*
+	* Remembers where the hook patterns were found in each module so that reloading the plugin or restarting
+	* the game doesn't have to scan the modules again. Entries are keyed by the md5 of the module's file on
+	* disk followed by the md5 of the patterns it's scanned for, and store the offsets from the module base, so
+	* a new game build or a new set of patterns just gets a new entry. The cache is kept in the game dir; the
+	* caller is expected to verify the bytes at every cached offset and fall back to scanning (and replace the
+	* entry) if anything doesn't line up.
+	*/
+	class PatternCache
+	{
+	public:
+		struct Found
+		{
+			int ptnIndex; // -1 if none of the patterns were found
+			uint32_t offset;
+		};
+
+		struct ModuleEntry
+		{
+			std::string moduleName;
+			uint32_t moduleSize = 0;
+			std::unordered_map<std::string, Found> hooks;
+			std::unordered_map<std::string, std::vector<Found>> matchAlls;
+		};
+
+		// hashes the module's file, returns an empty string if the file can't be read
+		static std::string GetModuleDigest(void* moduleHandle);
+
+		// returns null on a miss, the cache file is loaded on the first call
+		const ModuleEntry* Find(const std::string& digest);
+		void Store(const std::string& digest, ModuleEntry entry);
+		void Invalidate(const std::string& digest);
+		// writes the cache file if anything changed
+		void Save();
+
+	private:
+		std::string GetPath() const;
+		void Load();
+
+		bool loaded = false;
+		bool dirty = false;
+		std::unordered_map<std::string, ModuleEntry> entries;
+	};
+
+	PatternCache& GetPatternCache();
+} // namespace utils
@@ -0,0 +1,269 @@
+#include "stdafx.hpp"
+
+#include "pattern_scanner.hpp"
+
+#include <algorithm>
+#include <climits>
+#include <cstring>
+
+#include "thread_pool.hpp"
+
+namespace utils
+{
+	// bytes that show up everywhere in x86 code (padding, prologues, mov, call, small immediates)
+	static int GetByteCommonness(uint8_t b)
+	{
+		switch (b)
+		{
+		case 0x00:
+		case 0xFF:
+		case 0xCC:
+		case 0x8B:
+			return 4;
+		case 0x55:
+		case 0xEC:
+		case 0x89:
+		case 0xE8:
+		case 0x83:
+		case 0xC4:
+		case 0x04:
+		case 0x08:
+		case 0x0C:
+		case 0x10:
+		case 0x01:
+		case 0x8D:
+		case 0x85:
+		case 0x74:
+		case 0x75:
+		case 0xC3:
+		case 0x0F:
+			return 2;
+		case 0x50:
+		case 0x51:
+		case 0x52:
+		case 0x53:
+		case 0x56:
+		case 0x57:
+		case 0x5D:
+		case 0x5E:
+		case 0x5F:
+		case 0x6A:
+			return 1;
+		default:
+			return 0;
+		}
+	}
+
+	static uint32_t LoadWord(const uint8_t* p)
+	{
+		uint32_t w;
+		memcpy(&w, p, sizeof w);
+		return w;
+	}
+
+	uint32_t PatternScanner::AddPattern(std::span<const uint8_t> bytes, std::span<const uint8_t> mask)
+	{
+		if (bytes.empty() || bytes.size() != mask.size())
+			return UINT32_MAX;
+
+		Pattern& pattern = patterns.emplace_back();
+		pattern.bytes.assign(bytes.begin(), bytes.end());
+		pattern.mask.resize(mask.size());
+		for (size_t i = 0; i < mask.size(); i++)
+		{
+			pattern.mask[i] = mask[i] ? 0xFF : 0;
+			pattern.bytes[i] &= pattern.mask[i];
+		}
+
+		// pick the 4 fixed byte window with the least common looking bytes
+		pattern.anchorOff = SIZE_MAX;
+		int bestScore = INT_MAX;
+		for (size_t i = 0; i + ANCHOR_LEN <= bytes.size(); i++)
+		{
+			int score = 0;
+			for (size_t j = i; j < i + ANCHOR_LEN && score != INT_MAX; j++)
+				score = pattern.mask[j] ? score + GetByteCommonness(pattern.bytes[j]) : INT_MAX;
+			if (score < bestScore)
+			{
+				bestScore = score;
+				pattern.anchorOff = i;
+			}
+		}
+
+		compiled = false;
+		return patterns.size() - 1;
+	}
+
+	uint32_t PatternScanner::AddPattern(const char* str)
+	{
+		std::vector<uint8_t> bytes, mask;
+		while (*str)
+		{
+			if (*str == ' ')
+			{
+				str++;
+				continue;
+			}
+			if (*str == '?')
+			{
+				bytes.push_back(0);
+				mask.push_back(0);
+				str += str[1] == '?' ? 2 : 1;
+				continue;
+			}
+			char* end;
+			char hex[3] = {str[0], str[1], '\0'};
+			unsigned long b = strtoul(hex, &end, 16);
+			if (end != hex + 2)
+				return UINT32_MAX;
+			bytes.push_back((uint8_t)b);
+			mask.push_back(0xFF);
+			str += 2;
+		}
+		return AddPattern(bytes, mask);
+	}
+
+	void PatternScanner::Compile()
+	{
+		constexpr size_t nBuckets = 1 << BUCKET_BITS;
+
+		entries.clear();
+		unanchoredIdxs.clear();
+		for (uint32_t i = 0; i < patterns.size(); i++)
+		{
+			const Pattern& pattern = patterns[i];
+			if (pattern.anchorOff == SIZE_MAX)
+			{
+				unanchoredIdxs.push_back(i);
+			}
+			else
+			{
+				entries.push_back({
+				    .anchor = LoadWord(pattern.bytes.data() + pattern.anchorOff),
+				    .patternIdx = i,
+				    .anchorOff = (uint32_t)pattern.anchorOff,
+				});
+			}
+		}
+		std::ranges::stable_sort(entries, {}, [](const AnchorEntry& e) { return HashAnchor(e.anchor); });
+
+		bitmap.assign(nBuckets / 64, 0);
+		bucketStarts.assign(nBuckets + 1, 0);
+		for (const AnchorEntry& e : entries)
+		{
+			uint32_t h = HashAnchor(e.anchor);
+			bitmap[h / 64] |= 1ull << (h % 64);
+			bucketStarts[h + 1]++;
+		}
+		for (size_t i = 0; i < nBuckets; i++)
+			bucketStarts[i + 1] += bucketStarts[i];
+
+		compiled = true;
+	}
+
+	bool PatternScanner::MatchAt(const Pattern& pattern, const uint8_t* p) const
+	{
+		for (size_t i = 0; i < pattern.bytes.size(); i++)
+			if ((p[i] & pattern.mask[i]) != pattern.bytes[i])
+				return false;
+		return true;
+	}
+
+	void PatternScanner::ScanRange(std::span<const uint8_t> data,
+	                               size_t start,
+	                               size_t end,
+	                               std::vector<Match>& out) const
+	{
+		if (data.size() < ANCHOR_LEN)
+			return;
+		end = std::min(end, data.size() - ANCHOR_LEN + 1);
+
+		const uint8_t* base = data.data();
+		for (size_t pos = start; pos < end; pos++)
+		{
+			uint32_t anchor = LoadWord(base + pos);
+			uint32_t h = HashAnchor(anchor);
+			if (!(bitmap[h / 64] & (1ull << (h % 64))))
+				continue;
+
+			for (uint32_t i = bucketStarts[h]; i < bucketStarts[h + 1]; i++)
+			{
+				const AnchorEntry& e = entries[i];
+				if (e.anchor != anchor || pos < e.anchorOff)
+					continue;
+				const Pattern& pattern = patterns[e.patternIdx];
+				size_t matchOff = pos - e.anchorOff;
+				if (matchOff + pattern.bytes.size() <= data.size() && MatchAt(pattern, base + matchOff))
+					out.push_back({e.patternIdx, matchOff});
+			}
+		}
+	}
+
+	void PatternScanner::ScanUnanchored(std::span<const uint8_t> data,
+	                                    uint32_t patternIdx,
+	                                    std::vector<Match>& out) const
+	{
+		const Pattern& pattern = patterns[patternIdx];
+		if (pattern.bytes.size() > data.size())
+			return;
+		size_t lastOff = data.size() - pattern.bytes.size();
+
+		auto firstFixed = std::ranges::find(pattern.mask, 0xFF);
+		if (firstFixed == pattern.mask.end())
+		{
+			// all wildcards
+			for (size_t off = 0; off <= lastOff; off++)
+				out.push_back({patternIdx, off});
+			return;
+		}
+
+		size_t fixedOff = firstFixed - pattern.mask.begin();
+		const uint8_t* p = data.data() + fixedOff;
+		const uint8_t* end = data.data() + lastOff + fixedOff + 1;
+		while ((p = (const uint8_t*)memchr(p, pattern.bytes[fixedOff], end - p)) != nullptr)
+		{
+			size_t off = p - data.data() - fixedOff;
+			if (MatchAt(pattern, data.data() + off))
+				out.push_back({patternIdx, off});
+			p++;
+		}
+	}
+
+	std::vector<PatternScanner::Match> PatternScanner::Scan(std::span<const uint8_t> data)
+	{
+		if (!compiled)
+			Compile();
+
+		constexpr size_t chunkSize = 1 << 20;
+		size_t nChunks = (data.size() + chunkSize - 1) / chunkSize;
+		// one extra list for the unanchored patterns
+		std::vector<std::vector<Match>> chunkMatches(nChunks + 1);
+
+		auto scanChunk = [&](size_t i)
+		{
+			if (i == nChunks)
+			{
+				for (uint32_t patternIdx : unanchoredIdxs)
+					ScanUnanchored(data, patternIdx, chunkMatches[i]);
+			}
+			else
+			{
+				ScanRange(data, i * chunkSize, (i + 1) * chunkSize, chunkMatches[i]);
+			}
+		};
+
+		GetThreadPool().ParallelFor(nChunks + 1, scanChunk);
+
+		std::vector<Match> matches;
+		size_t nMatches = 0;
+		for (auto& vec : chunkMatches)
+			nMatches += vec.size();
+		matches.reserve(nMatches);
+		for (auto& vec : chunkMatches)
+			matches.insert(matches.end(), vec.begin(), vec.end());
+
+		// chunks are in order so this keeps the matches of each pattern sorted by offset
+		std::ranges::stable_sort(matches, {}, &Match::patternIdx);
+		return matches;
+	}
+} // namespace utils
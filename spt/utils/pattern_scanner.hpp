@@ -0,0 +1,82 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+namespace utils
+{
+	/*
+	* Finds all matches of many wildcard patterns in one sweep over a buffer. The old way of hooking launched a
+	* separate scan over the whole module for every pattern, so the load time scaled with the number of
+	* patterns. Here every pattern gets an anchor: the least common looking run of 4 non-wildcard bytes in it.
+	* The anchors are hashed into a small bitmap that stays in L1, so most positions in the buffer are rejected
+	* with a single load + bit test and only the positions that hit an anchor are compared to the full patterns.
+	* The buffer is split into chunks that are scanned on the shared thread pool.
+	*
+	* Patterns without 4 consecutive fixed bytes can't be anchored, those are scanned separately (there should
+	* be very few of them).
+	*/
+	class PatternScanner
+	{
+	public:
+		struct Match
+		{
+			uint32_t patternIdx;
+			size_t offset;
+		};
+
+		// mask must be the same length as bytes, 0 for a wildcard byte and anything else for a byte that must match
+		uint32_t AddPattern(std::span<const uint8_t> bytes, std::span<const uint8_t> mask);
+		// parses "55 8B EC ?? ?? 8B" style patterns, returns UINT32_MAX if the pattern is invalid
+		uint32_t AddPattern(const char* str);
+
+		size_t GetPatternCount() const
+		{
+			return patterns.size();
+		}
+
+		/*
+		* Returns the matches of all patterns sorted by pattern index, the matches of each pattern are sorted by
+		* offset. Patterns can overlap and the same position can match multiple patterns.
+		*/
+		std::vector<Match> Scan(std::span<const uint8_t> data);
+
+	private:
+		static constexpr size_t ANCHOR_LEN = 4;
+		static constexpr int BUCKET_BITS = 16;
+
+		struct Pattern
+		{
+			std::vector<uint8_t> bytes, mask;
+			size_t anchorOff; // SIZE_MAX if there isn't a long enough run of fixed bytes
+		};
+
+		struct AnchorEntry
+		{
+			uint32_t anchor;
+			uint32_t patternIdx;
+			uint32_t anchorOff;
+		};
+
+		std::vector<Pattern> patterns;
+
+		// rebuilt by Compile() when patterns are added
+		bool compiled = false;
+		std::vector<uint64_t> bitmap;         // 1 bit per bucket
+		std::vector<uint32_t> bucketStarts;   // index into entries, 1 + the number of buckets
+		std::vector<AnchorEntry> entries;     // sorted by bucket
+		std::vector<uint32_t> unanchoredIdxs; // patterns that need a slow scan
+
+		static uint32_t HashAnchor(uint32_t anchor)
+		{
+			return (anchor * 0x9E3779B1u) >> (32 - BUCKET_BITS);
+		}
+
+		void Compile();
+		bool MatchAt(const Pattern& pattern, const uint8_t* p) const;
+		void ScanRange(std::span<const uint8_t> data, size_t start, size_t end, std::vector<Match>& out) const;
+		void ScanUnanchored(std::span<const uint8_t> data, uint32_t patternIdx, std::vector<Match>& out) const;
+	};
+} // namespace utils
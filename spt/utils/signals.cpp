@@ -25,6 +25,7 @@ Gallant::Signal1<char const*> LevelInitSignal;
 Gallant::Signal3<edict_t*, int, int> ServerActivateSignal;
 Gallant::Signal0<void> LevelShutdownSignal;
 Gallant::Signal1<edict_t*> OnEdictAllocatedSignal;
+Gallant::Signal1<const edict_t*> OnEdictFreedSignal;
 Gallant::Signal2<edict_t*, char const*> ClientPutInServerSignal;
 Gallant::Signal1<edict_t*> ClientActiveSignal;
 Gallant::Signal1<edict_t*> ClientDisconnectSignal;
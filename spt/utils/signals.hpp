@@ -29,6 +29,7 @@ extern Gallant::Signal1<char const*> LevelInitSignal;
 extern Gallant::Signal3<edict_t*, int, int> ServerActivateSignal;
 extern Gallant::Signal0<void> LevelShutdownSignal;
 extern Gallant::Signal1<edict_t*> OnEdictAllocatedSignal;
+extern Gallant::Signal1<const edict_t*> OnEdictFreedSignal;
 extern Gallant::Signal2<edict_t*, char const*> ClientPutInServerSignal;
 extern Gallant::Signal1<edict_t*> ClientActiveSignal;
 extern Gallant::Signal1<edict_t*> ClientDisconnectSignal;
@@ -0,0 +1,59 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <type_traits>
+
+namespace utils
+{
+	/*
+	* A fixed size ring buffer for exactly one producer thread and one consumer thread. Neither side ever takes a
+	* lock or waits on the other, pushing into a full ring just fails and it's up to the producer what to do with
+	* the element. N has to be a power of two so the indices can wrap on their own.
+	*/
+	template<typename T, size_t N>
+	class SpscRing
+	{
+		static_assert(N > 0 && (N & (N - 1)) == 0, "ring size must be a power of two");
+		static_assert(std::is_trivially_copyable_v<T>);
+
+	public:
+		// producer only, false if the consumer hasn't caught up
+		bool TryPush(const T& value)
+		{
+			size_t w = writeIdx.load(std::memory_order_relaxed);
+			if (w - readIdx.load(std::memory_order_acquire) == N)
+				return false;
+			buf[w % N] = value;
+			writeIdx.store(w + 1, std::memory_order_release);
+			return true;
+		}
+
+		// consumer only, copies up to maxCount elements to out and returns how many there were
+		size_t PopMany(T* out, size_t maxCount)
+		{
+			size_t r = readIdx.load(std::memory_order_relaxed);
+			size_t count = writeIdx.load(std::memory_order_acquire) - r;
+			if (count > maxCount)
+				count = maxCount;
+			for (size_t i = 0; i < count; i++)
+				out[i] = buf[(r + i) % N];
+			readIdx.store(r + count, std::memory_order_release);
+			return count;
+		}
+
+		// only safe when neither side is using the ring
+		void Reset()
+		{
+			readIdx.store(0, std::memory_order_relaxed);
+			writeIdx.store(0, std::memory_order_relaxed);
+		}
+
+	private:
+		std::array<T, N> buf;
+		// on separate cache lines so the two threads don't keep stealing the line from each other
+		alignas(64) std::atomic_size_t writeIdx = 0;
+		alignas(64) std::atomic_size_t readIdx = 0;
+	};
+} // namespace utils
@@ -0,0 +1,186 @@
+#include "stdafx.hpp"
+
+#include "thread_pool.hpp"
+
+namespace utils
+{
+	static thread_local const ThreadPool* tlsPool = nullptr;
+	static thread_local int tlsWorkerIndex = -1;
+
+	ThreadPool::ThreadPool(size_t numThreads)
+	{
+		if (numThreads == 0)
+		{
+			unsigned int cores = std::thread::hardware_concurrency();
+			numThreads = cores > 1 ? cores - 1 : 1;
+		}
+
+		workers.reserve(numThreads);
+		for (size_t i = 0; i < numThreads; ++i)
+			workers.push_back(std::make_unique<Worker>());
+		// start the threads only after the worker vector won't move anymore
+		for (size_t i = 0; i < numThreads; ++i)
+			workers[i]->thread = std::thread(&ThreadPool::WorkerMain, this, (int)i);
+	}
+
+	ThreadPool::~ThreadPool()
+	{
+		{
+			std::lock_guard<std::mutex> lk(sleepLock);
+			stopping = true;
+		}
+		wake.notify_all();
+		for (auto& worker : workers)
+		{
+			if (worker->thread.joinable())
+				worker->thread.join();
+		}
+	}
+
+	int ThreadPool::GetCurrentWorkerIndex() const
+	{
+		return tlsPool == this ? tlsWorkerIndex : -1;
+	}
+
+	void ThreadPool::Submit(Job job)
+	{
+		int self = GetCurrentWorkerIndex();
+		size_t queue = self >= 0 ? (size_t)self : nextQueue++ % workers.size();
+		{
+			std::lock_guard<std::mutex> lk(workers[queue]->lock);
+			workers[queue]->jobs.push_back(std::move(job));
+		}
+		pending++;
+		{
+			// makes sure a worker that just checked pending doesn't miss the wakeup
+			std::lock_guard<std::mutex> lk(sleepLock);
+		}
+		wake.notify_one();
+	}
+
+	bool ThreadPool::TryRunOne(int self)
+	{
+		const size_t n = workers.size();
+		const size_t start = self >= 0 ? (size_t)self : 0;
+		for (size_t k = 0; k < n; ++k)
+		{
+			size_t idx = (start + k) % n;
+			Worker& worker = *workers[idx];
+			Job job;
+			{
+				std::lock_guard<std::mutex> lk(worker.lock);
+				if (worker.jobs.empty())
+					continue;
+				if ((int)idx == self)
+				{
+					job = std::move(worker.jobs.back());
+					worker.jobs.pop_back();
+				}
+				else
+				{
+					job = std::move(worker.jobs.front());
+					worker.jobs.pop_front();
+				}
+			}
+			pending--;
+			job();
+			return true;
+		}
+		return false;
+	}
+
+	void ThreadPool::WorkerMain(int index)
+	{
+		tlsPool = this;
+		tlsWorkerIndex = index;
+
+		while (true)
+		{
+			if (TryRunOne(index))
+				continue;
+
+			std::unique_lock<std::mutex> lk(sleepLock);
+			wake.wait(lk, [this] { return stopping || pending.load() > 0; });
+			if (stopping && pending.load() == 0)
+				return;
+		}
+	}
+
+	void ThreadPool::ParallelFor(size_t count, const std::function<void(size_t)>& fn, size_t grain)
+	{
+		ParallelForRange(
+		    count,
+		    [&fn](size_t start, size_t end)
+		    {
+			    for (size_t i = start; i < end; ++i)
+				    fn(i);
+		    },
+		    grain);
+	}
+
+	void ThreadPool::ParallelForRange(size_t count, const std::function<void(size_t, size_t)>& fn, size_t grain)
+	{
+		if (count == 0)
+			return;
+		if (grain == 0)
+			grain = 1;
+
+		const size_t chunks = (count + grain - 1) / grain;
+		if (chunks == 1 || workers.empty())
+		{
+			fn(0, count);
+			return;
+		}
+
+		struct
+		{
+			std::mutex lock;
+			std::condition_variable done;
+			size_t remaining;
+		} state;
+		state.remaining = chunks;
+
+		for (size_t c = 0; c < chunks; ++c)
+		{
+			size_t start = c * grain;
+			size_t end = std::min(start + grain, count);
+			Submit(
+			    [&fn, &state, start, end]()
+			    {
+				    fn(start, end);
+				    std::lock_guard<std::mutex> lk(state.lock);
+				    if (--state.remaining == 0)
+					    state.done.notify_all();
+			    });
+		}
+
+		// help out instead of sleeping, this also picks up jobs submitted by nested calls
+		const int self = GetCurrentWorkerIndex();
+		while (true)
+		{
+			if (TryRunOne(self))
+				continue;
+			std::unique_lock<std::mutex> lk(state.lock);
+			if (state.remaining == 0)
+				break;
+			state.done.wait_for(lk, std::chrono::milliseconds(1));
+		}
+	}
+
+	static std::mutex sharedPoolLock;
+	static std::unique_ptr<ThreadPool> sharedPool;
+
+	ThreadPool& GetThreadPool()
+	{
+		std::lock_guard<std::mutex> lk(sharedPoolLock);
+		if (!sharedPool)
+			sharedPool = std::make_unique<ThreadPool>();
+		return *sharedPool;
+	}
+
+	void ShutdownThreadPool()
+	{
+		std::lock_guard<std::mutex> lk(sharedPoolLock);
+		sharedPool.reset();
+	}
+} // namespace utils
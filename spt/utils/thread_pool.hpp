@@ -0,0 +1,73 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace utils
+{
+	/*
+	* A small work-stealing thread pool. Every worker has its own job deque: a worker pops from the back of
+	* its own deque and steals from the front of the others when it runs out of work. Jobs submitted from
+	* inside a worker go to that worker's deque, so nested ParallelFor calls don't deadlock and mostly stay
+	* on the same thread.
+	*
+	* The thread calling ParallelFor() also runs jobs until its range is done, so the pool can have one
+	* thread less than the number of cores.
+	*/
+	class ThreadPool
+	{
+	public:
+		using Job = std::function<void()>;
+
+		// 0 threads means one per core (minus the calling thread)
+		explicit ThreadPool(size_t numThreads = 0);
+		~ThreadPool();
+
+		ThreadPool(const ThreadPool&) = delete;
+		ThreadPool& operator=(const ThreadPool&) = delete;
+
+		size_t GetThreadCount() const
+		{
+			return workers.size();
+		}
+
+		// calls fn(i) for every i in [0, count), in chunks of grain indices, and blocks until all are done
+		void ParallelFor(size_t count, const std::function<void(size_t)>& fn, size_t grain = 1);
+
+		// same as ParallelFor but fn gets the [start, end) range of the chunk
+		void ParallelForRange(size_t count, const std::function<void(size_t, size_t)>& fn, size_t grain = 1);
+
+		// the index of the worker the current thread belongs to, or -1 if it's not a worker of this pool
+		int GetCurrentWorkerIndex() const;
+
+	private:
+		struct Worker
+		{
+			std::mutex lock;
+			std::deque<Job> jobs;
+			std::thread thread;
+		};
+
+		void Submit(Job job);
+		bool TryRunOne(int self);
+		void WorkerMain(int index);
+
+		std::vector<std::unique_ptr<Worker>> workers;
+		std::atomic<size_t> pending{0};
+		std::atomic<size_t> nextQueue{0};
+		std::mutex sleepLock;
+		std::condition_variable wake;
+		bool stopping = false;
+	};
+
+	// Shared pool used by SPT features, created on first use
+	ThreadPool& GetThreadPool();
+	// Joins the shared pool's threads, must be called before the plugin is unloaded
+	void ShutdownThreadPool();
+} // namespace utils
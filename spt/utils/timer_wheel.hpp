@@ -0,0 +1,110 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <vector>
+
+namespace utils
+{
+	/*
+	* A hashed timing wheel for the afterframes/afterticks queues. Entries store the absolute time at which they
+	* are due and go into the slot of that time, so adding is O(1) and advancing the clock only looks at the
+	* slots it passes over instead of every queued entry. Entries that are due more than a full turn of the wheel
+	* away just stay in their slot until the clock gets there.
+	*
+	* Pausing or delaying a queue means not advancing its clock, nothing has to be rewritten.
+	*/
+	template<typename T>
+	class TimerWheel
+	{
+	public:
+		struct Due
+		{
+			T value;
+			long long lateBy; // > 0 if the clock went past the due time in one step
+		};
+
+		// due after the clock advanced by delay, right on the next Advance() if delay <= 0
+		void Add(long long delay, T value)
+		{
+			Entry entry{now + delay, nextSeq++, std::move(value)};
+			if (delay <= 0)
+				overdue.push_back(std::move(entry));
+			else
+				slots[entry.due % N_SLOTS].push_back(std::move(entry));
+			size++;
+		}
+
+		// moves the clock forward, appends everything that became due in the order it was added
+		void Advance(long long ticks, std::vector<Due>& out)
+		{
+			long long target = now + std::max(ticks, 0ll);
+			if (size == 0)
+			{
+				now = target;
+				return;
+			}
+
+			fired.clear();
+			std::swap(fired, overdue);
+
+			// a whole turn of the wheel visits every slot once
+			long long nVisit = std::min<long long>(target - now, N_SLOTS);
+			for (long long t = now + 1; t <= now + nVisit; t++)
+			{
+				auto& slot = slots[t % N_SLOTS];
+				for (size_t i = 0; i < slot.size();)
+				{
+					if (slot[i].due <= target)
+					{
+						fired.push_back(std::move(slot[i]));
+						slot[i] = std::move(slot.back());
+						slot.pop_back();
+					}
+					else
+					{
+						i++;
+					}
+				}
+			}
+			now = target;
+
+			std::ranges::sort(fired, {}, &Entry::seq);
+			for (auto& entry : fired)
+				out.push_back({std::move(entry.value), now - entry.due});
+			size -= fired.size();
+			fired.clear();
+		}
+
+		void Clear()
+		{
+			for (auto& slot : slots)
+				slot.clear();
+			overdue.clear();
+			size = 0;
+		}
+
+		size_t Size() const
+		{
+			return size;
+		}
+
+	private:
+		static constexpr size_t N_SLOTS = 1024;
+
+		struct Entry
+		{
+			long long due;
+			uint64_t seq;
+			T value;
+		};
+
+		std::array<std::vector<Entry>, N_SLOTS> slots;
+		std::vector<Entry> overdue;
+		std::vector<Entry> fired;
+		long long now = 0;
+		uint64_t nextSeq = 0;
+		size_t size = 0;
+	};
+} // namespace utils